@@ -0,0 +1,149 @@
+/*
+ *  This file (arena.c) holds the memory arenas for the linked list demo (see arena.h).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "arena.h"
+
+/* How big a chunk is unless arena_new is told otherwise */
+#define ARENA_DEFAULT_CHUNK (64 * 1024)
+/* Everything handed out is lined up on this many bytes, so any type can go there */
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+/* arena_round(): size parameter, return it rounded up to a multiple of ARENA_ALIGN */
+static size_t arena_round(size_t size){
+    return (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+}
+
+/* arena_new(): chunk size parameter, return a pointer to a new empty arena, or NULL */
+arena_t *arena_new(size_t chunk_size){
+    arena_t *a = malloc(sizeof(arena_t));
+    if(a == NULL){
+        return NULL;
+    }
+    a->chunk = NULL;
+    a->first = NULL;
+    a->spare = NULL;
+    a->chunk_size = chunk_size > 0 ? chunk_size : ARENA_DEFAULT_CHUNK;
+    a->chunks = 0;
+    return a;
+}
+
+/* arena_free(): arena * parameter, no return value; free every chunk and the arena */
+void arena_free(arena_t *a){
+    if(a == NULL){
+        return;
+    }
+    arena_reset(a);
+    arena_trim(a);
+    free(a);
+}
+
+/* arena_trim(): arena * parameter, no return value; free every spare chunk */
+void arena_trim(arena_t *a){
+    if(a == NULL){
+        return;
+    }
+    while(a->spare != NULL){
+        arena_chunk_t *c = a->spare;
+        a->spare = c->prev;
+        free(c);
+        a->chunks--;
+    }
+}
+
+/* arena_add_chunk(): size and arena * parameters, return true if the arena now has a chunk with
+   room for that many bytes to allocate from. The newest spare is used if it's big enough */
+static bool arena_add_chunk(size_t size, arena_t *a){
+    arena_chunk_t *c;
+    if(a->spare != NULL && a->spare->size >= size){
+        c = a->spare;
+        a->spare = c->prev;
+    }else{
+        size_t data = size > a->chunk_size ? size : a->chunk_size;
+        c = malloc(sizeof(arena_chunk_t) + data);
+        if(c == NULL){
+            return false;
+        }
+        c->size = data;
+        a->chunks++;
+    }
+    c->used = 0;
+    c->prev = a->chunk;
+    if(a->chunk == NULL){
+        a->first = c;
+    }
+    a->chunk = c;
+    return true;
+}
+
+/* arena_alloc(): size and arena * parameters, return a pointer to that many bytes, or NULL. This
+   is the whole point of an arena: usually it's one comparison and one addition */
+void *arena_alloc(size_t size, arena_t *a){
+    if(a == NULL){
+        return NULL;
+    }
+    size = arena_round(size > 0 ? size : 1);
+    if(a->chunk == NULL || a->chunk->size - a->chunk->used < size){
+        if(!arena_add_chunk(size, a)){
+            return NULL;
+        }
+    }
+    void *p = a->chunk->data + a->chunk->used;
+    a->chunk->used += size;
+    return p;
+}
+
+/* arena_mark(): arena * parameter, return a mark for the arena's current position */
+arena_mark_t arena_mark(arena_t *a){
+    arena_mark_t m = { NULL, 0 };
+    if(a != NULL){
+        m.chunk = a->chunk;
+        m.used = a->chunk != NULL ? a->chunk->used : 0;
+    }
+    return m;
+}
+
+/* arena_rewind(): mark and arena * parameters, no return value; move the chunks started after the
+   mark onto the spares, and go back to where the mark's chunk was filled to */
+void arena_rewind(arena_mark_t m, arena_t *a){
+    if(a == NULL){
+        return;
+    }
+    if(m.chunk == NULL){
+        arena_reset(a);
+        return;
+    }
+    while(a->chunk != m.chunk){
+        arena_chunk_t *c = a->chunk;
+        a->chunk = c->prev;
+        c->prev = a->spare;
+        a->spare = c;
+    }
+    a->chunk->used = m.used;
+}
+
+/* arena_reset(): arena * parameter, no return value; every chunk in use becomes a spare. They're
+   already chained together from newest to oldest, so the whole chain goes on top of the spares
+   at once */
+void arena_reset(arena_t *a){
+    if(a == NULL || a->chunk == NULL){
+        return;
+    }
+    a->first->prev = a->spare;
+    a->spare = a->chunk;
+    a->chunk = NULL;
+    a->first = NULL;
+}
+
+/* arena_used(): arena * parameter, return how many bytes have been handed out */
+size_t arena_used(arena_t *a){
+    size_t used = 0;
+    for(arena_chunk_t *c = a != NULL ? a->chunk : NULL; c != NULL; c = c->prev){
+        used += c->used;
+    }
+    return used;
+}
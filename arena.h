@@ -0,0 +1,84 @@
+/*
+ *  This file (arena.h) is the header file for the memory arenas in the linked list demo.
+ *
+ *  An arena hands out memory by "bumping" a pointer through big chunks it got from malloc, and
+ *  never frees any single piece of it. Instead, everything handed out after some point is given
+ *  back at once: arena_mark remembers a point, arena_rewind goes back to it, and arena_reset goes
+ *  back to the very beginning. That makes a lot of small allocations (like a list's nodes and
+ *  strings, see list_new_in_arena) cheap to make and even cheaper to throw away.
+ *
+ *  Contents:
+ *      - arena_chunk_t, arena_t and arena_mark_t structs
+ *      - function prototypes for arenas
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* DEFINITION OF ARENA_CHUNK_T STRUCT */
+/* One block of memory from malloc; 'used' bytes of 'data' have been handed out. Each chunk points
+   to the one filled before it */
+typedef struct ARENA_CHUNK{
+    struct ARENA_CHUNK *prev;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) char data[];
+} arena_chunk_t;
+
+/* DEFINITION OF ARENA_T STRUCT */
+/* 'chunk' is the one memory comes from right now, and 'first' the oldest one in use. Chunks given
+   back by a rewind aren't freed but kept in 'spare' (chained through 'prev' as well), so the next
+   allocations can reuse them without calling malloc, and a reset never calls free at all */
+typedef struct ARENA{
+    arena_chunk_t *chunk;
+    arena_chunk_t *first;
+    arena_chunk_t *spare;
+    size_t chunk_size;      /* how big new chunks are (bigger if one allocation needs it) */
+    size_t chunks;          /* how many chunks it holds right now, spares included */
+} arena_t;
+
+/* DEFINITION OF ARENA_MARK_T STRUCT */
+/* A point in an arena's life to rewind to */
+typedef struct{
+    arena_chunk_t *chunk;
+    size_t used;
+} arena_mark_t;
+
+/* FUNCTION PROTOTYPES FOR ARENAS */
+
+/* arena_new(): chunk size parameter (0 for the default), return a pointer to a new empty arena,
+   or NULL if space can't be allocated */
+arena_t *arena_new(size_t);
+
+/* arena_free(): arena * parameter, no return value; give all of the arena's memory back to the
+   system, and free the arena itself */
+void arena_free(arena_t *);
+
+/* arena_alloc(): size and arena * parameters, return a pointer to that many bytes (aligned for any
+   type), or NULL if space can't be allocated. There's no way to free it by itself */
+void *arena_alloc(size_t, arena_t *);
+
+/* arena_mark(): arena * parameter, return a mark for the arena's current position */
+arena_mark_t arena_mark(arena_t *);
+
+/* arena_rewind(): mark and arena * parameters, no return value; give back everything allocated
+   since the mark was made (to the arena, to be handed out again). Marks made after it are no good
+   anymore */
+void arena_rewind(arena_mark_t, arena_t *);
+
+/* arena_reset(): arena * parameter, no return value; give back everything ever allocated from the
+   arena, which stays ready for more. Takes the same time however much was allocated */
+void arena_reset(arena_t *);
+
+/* arena_trim(): arena * parameter, no return value; free the spare chunks that rewinds and resets
+   kept around, giving their memory back to the system */
+void arena_trim(arena_t *);
+
+/* arena_used(): arena * parameter, return how many bytes have been handed out (alignment padding
+   included) */
+size_t arena_used(arena_t *);
+
+#endif /* ARENA_H */
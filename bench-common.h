@@ -0,0 +1,22 @@
+/*
+ *  This file (bench-common.h) holds the little helpers every bench-*.c program shares, so each
+ *  benchmark times things the same way.
+ *
+ *  Contents:
+ *      - now_ns()
+ *
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <time.h>
+
+/* now_ns(): no parameters, return a monotonic timestamp in nanoseconds */
+static inline double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#endif /* BENCH_COMMON_H */
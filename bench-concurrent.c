@@ -0,0 +1,258 @@
+/*
+ *  This file (bench-concurrent.c) checks and measures the concurrent list (clist.c).
+ *
+ *  It runs in two parts:
+ *      - a stress test: several threads push, append, pop and remove_last at random on one
+ *        clist_t, hovering around an empty list (where the two ends meet and the locking is the
+ *        trickiest). Every value carries a unique number, and at the end each one must have come
+ *        out exactly once.
+ *      - a throughput benchmark: 1, 2, ... N threads, half working on the front of the list and
+ *        half on the back, compared with an ordinary list_t behind a single mutex.
+ *
+ *  Build and run it with 'make bench-concurrent'. The first argument is the largest thread count
+ *  (default 8) and the second the number of operations per thread (default 1000000).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench-common.h"
+#include "clist.h"
+
+/* STRESS TEST */
+
+#define STRESS_OPS 200000
+
+typedef struct{
+    clist_t *l;
+    int id;
+    int threads;
+    unsigned char *seen;    /* one counter per value number, shared by all threads */
+    long long produced;
+    long long consumed;
+    bool failed;
+} stress_arg_t;
+
+/* stress_check(): arg * and popped value/type parameters, no return value; record that a value
+   came out of the list (and complain if it was garbled or came out twice) */
+static void stress_check(stress_arg_t *a, value_t v, value_type_t t){
+    int number;
+    if(t == VAL_STR){
+        number = atoi(v.sval);
+        free(v.sval);
+    }else if(t == VAL_INT){
+        number = v.ival;
+    }else{
+        a->failed = true;
+        return;
+    }
+    if(number < 0 || number >= a->threads * STRESS_OPS){
+        a->failed = true;
+        return;
+    }
+    /* each number is pushed once, so exactly one thread ever counts it */
+    if(__atomic_add_fetch(&a->seen[number], 1, __ATOMIC_RELAXED) != 1){
+        a->failed = true;
+    }
+    a->consumed++;
+}
+
+/* stress_thread(): arg * parameter, return NULL; mix random operations on both ends */
+static void *stress_thread(void *arg){
+    stress_arg_t *a = arg;
+    unsigned int seed = 12345u + a->id;
+    int next = a->id * STRESS_OPS;      /* this thread's own block of value numbers */
+    int last = next + STRESS_OPS;
+    while(next < last){
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = seed >> 16;
+        value_t v;
+        value_type_t t;
+        char buf[16];
+        switch(r % 4){
+            case 0:
+            case 1:
+                /* every 8th value is a string, so string ownership gets a workout too */
+                if(r % 8 < 2){
+                    snprintf(buf, sizeof(buf), "%d", next);
+                    v.sval = buf;
+                    t = VAL_STR;
+                }else{
+                    v.ival = next;
+                    t = VAL_INT;
+                }
+                if(!(r % 4 == 0 ? clist_push(v, t, a->l) : clist_append(v, t, a->l))){
+                    a->failed = true;
+                    return NULL;
+                }
+                next++;
+                a->produced++;
+                break;
+            case 2:
+                if(clist_pop(a->l, &v, &t)){
+                    stress_check(a, v, t);
+                }
+                break;
+            default:
+                if(clist_remove_last(a->l, &v, &t)){
+                    stress_check(a, v, t);
+                }
+                break;
+        }
+    }
+    return NULL;
+}
+
+/* stress(): thread count parameter, return true if the run checked out */
+static bool stress(int threads){
+    clist_t *l = clist_new();
+    unsigned char *seen = calloc((size_t) threads * STRESS_OPS, 1);
+    stress_arg_t *args = calloc(threads, sizeof(stress_arg_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    if(l == NULL || seen == NULL || args == NULL || tids == NULL){
+        printf("stress: out of memory\n");
+        return false;
+    }
+    for(int i = 0; i < threads; i++){
+        args[i] = (stress_arg_t){ l, i, threads, seen, 0, 0, false };
+        pthread_create(&tids[i], NULL, stress_thread, &args[i]);
+    }
+    long long produced = 0, consumed = 0;
+    bool ok = true;
+    for(int i = 0; i < threads; i++){
+        pthread_join(tids[i], NULL);
+        produced += args[i].produced;
+        consumed += args[i].consumed;
+        ok = ok && !args[i].failed;
+    }
+    int left = clist_size(l);
+
+    /* drain what's left with a single thread, which must find exactly 'left' values */
+    stress_arg_t drain = { l, 0, threads, seen, 0, 0, false };
+    value_t v;
+    value_type_t t;
+    while(clist_pop(l, &v, &t)){
+        stress_check(&drain, v, t);
+    }
+    ok = ok && !drain.failed && drain.consumed == left && clist_size(l) == 0;
+    for(long long i = 0; i < (long long) threads * STRESS_OPS; i++){
+        ok = ok && seen[i] == 1;
+    }
+    ok = ok && produced == (long long) threads * STRESS_OPS && consumed + left == produced;
+
+    printf("stress %2d threads: %lld values, %lld taken while running, %d left  %s\n",
+           threads, produced, consumed, left, ok ? "ok" : "!!! FAILED !!!");
+    clist_free(l);
+    free(seen);
+    free(args);
+    free(tids);
+    return ok;
+}
+
+/* THROUGHPUT */
+
+/* the baseline: an ordinary list behind one lock */
+typedef struct{
+    list_t *l;
+    pthread_mutex_t lock;
+} locked_list_t;
+
+typedef struct{
+    clist_t *cl;
+    locked_list_t *ll;
+    bool back;      /* work on the back end instead of the front */
+    long ops;
+} bench_arg_t;
+
+/* bench_clist_thread(): arg * parameter, return NULL; add and remove a value at one end, over and
+   over */
+static void *bench_clist_thread(void *arg){
+    bench_arg_t *a = arg;
+    value_t v;
+    v.ival = 1;
+    for(long i = 0; i < a->ops; i += 2){
+        if(a->back){
+            clist_append(v, VAL_INT, a->cl);
+            clist_remove_last(a->cl, &v, NULL);
+        }else{
+            clist_push(v, VAL_INT, a->cl);
+            clist_pop(a->cl, &v, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* bench_locked_thread(): the same, on the mutex-wrapped list_t */
+static void *bench_locked_thread(void *arg){
+    bench_arg_t *a = arg;
+    value_t v;
+    v.ival = 1;
+    for(long i = 0; i < a->ops; i += 2){
+        pthread_mutex_lock(&a->ll->lock);
+        a->back ? list_append(v, VAL_INT, a->ll->l) : list_push(v, VAL_INT, a->ll->l);
+        pthread_mutex_unlock(&a->ll->lock);
+        pthread_mutex_lock(&a->ll->lock);
+        v = a->back ? list_remove_last(a->ll->l) : list_pop(a->ll->l);
+        pthread_mutex_unlock(&a->ll->lock);
+    }
+    return NULL;
+}
+
+/* bench_run(): thread count, ops per thread, and which list to use, return millions of
+   operations per second for the whole run */
+static double bench_run(int threads, long ops, bool concurrent){
+    clist_t *cl = clist_new();
+    locked_list_t ll;
+    ll.l = list_new();
+    pthread_mutex_init(&ll.lock, NULL);
+
+    /* start with some values in the list, so the two ends are normally far apart */
+    value_t v;
+    v.ival = 0;
+    for(int i = 0; i < 1000; i++){
+        clist_append(v, VAL_INT, cl);
+        list_append(v, VAL_INT, ll.l);
+    }
+
+    bench_arg_t *args = malloc(threads * sizeof(bench_arg_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    double start = now_ns();
+    for(int i = 0; i < threads; i++){
+        args[i] = (bench_arg_t){ cl, &ll, i % 2 == 1, ops };
+        pthread_create(&tids[i], NULL, concurrent ? bench_clist_thread : bench_locked_thread,
+                       &args[i]);
+    }
+    for(int i = 0; i < threads; i++){
+        pthread_join(tids[i], NULL);
+    }
+    double ns = now_ns() - start;
+
+    clist_free(cl);
+    list_free(ll.l);
+    pthread_mutex_destroy(&ll.lock);
+    free(args);
+    free(tids);
+    return (double) threads * ops / ns * 1e3;
+}
+
+int main(int argc, char **argv){
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    long ops = argc > 2 ? atol(argv[2]) : 1000000;
+    if(max_threads < 1){
+        max_threads = 1;
+    }
+
+    bool ok = true;
+    for(int threads = 1; threads <= max_threads; threads *= 2){
+        ok = stress(threads) && ok;
+    }
+
+    printf("\n%7s %14s %14s\n", "threads", "clist Mops/s", "locked Mops/s");
+    for(int threads = 1; threads <= max_threads; threads++){
+        printf("%7d %14.2f %14.2f\n", threads, bench_run(threads, ops, true),
+               bench_run(threads, ops, false));
+    }
+    return ok ? 0 : 1;
+}
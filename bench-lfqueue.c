@@ -0,0 +1,212 @@
+/*
+ *  This file (bench-lfqueue.c) checks and measures the lock-free queue (lfqueue.c).
+ *
+ *  It runs in two parts:
+ *      - a stress test: producers enqueue numbered values (some of them strings) while consumers
+ *        dequeue. Every value must come out exactly once, and the values of any one producer must
+ *        come out in the order that producer put them in.
+ *      - a throughput benchmark: 2, 4, ... N threads, half producers and half consumers, handing
+ *        off values through the lfqueue_t and through an ordinary list_t (list_append plus
+ *        list_pop) behind a single mutex.
+ *
+ *  Build and run it with 'make bench-lfqueue'. The first argument is the largest thread count
+ *  (default 8) and the second the number of values per producer (default 1000000).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "bench-common.h"
+#include "lfqueue.h"
+
+/* the baseline: an ordinary list behind one lock */
+typedef struct{
+    list_t *l;
+    pthread_mutex_t lock;
+} locked_list_t;
+
+/* Everything a producer or consumer thread needs. A value's number is producer * per_producer +
+   its position, so a consumer can tell who made it and in what order */
+typedef struct{
+    lfqueue_t *q;           /* NULL means use 'll' instead */
+    locked_list_t *ll;
+    int id;                 /* producer number (consumers don't use it) */
+    int producers;
+    long per_producer;
+    bool strings;           /* make every 8th value a string (stress test only) */
+    atomic_long *taken;     /* values dequeued so far, by everyone */
+    unsigned char *seen;    /* stress test only: one counter per value number */
+    bool failed;
+} handoff_arg_t;
+
+/* handoff_put(): arg * and value parameters, no return value; add a value to whichever queue */
+static void handoff_put(handoff_arg_t *a, value_t v, value_type_t t){
+    if(a->q != NULL){
+        while(!lfq_enqueue(v, t, a->q)){
+        }
+        return;
+    }
+    pthread_mutex_lock(&a->ll->lock);
+    list_append(v, t, a->ll->l);
+    pthread_mutex_unlock(&a->ll->lock);
+}
+
+/* handoff_take(): arg *, value * and value type * parameters, return false if the queue was empty.
+   Strings from the list_t are copied, since the list keeps the ones it pops */
+static bool handoff_take(handoff_arg_t *a, value_t *v, value_type_t *t){
+    if(a->q != NULL){
+        return lfq_dequeue(a->q, v, t);
+    }
+    bool found = false;
+    pthread_mutex_lock(&a->ll->lock);
+    if(list_size(a->ll->l) > 0){
+        *t = list_get_type(0, a->ll->l);
+        *v = list_pop(a->ll->l);
+        if(*t == VAL_STR){
+            v->sval = strdup(v->sval);
+        }
+        found = true;
+    }
+    pthread_mutex_unlock(&a->ll->lock);
+    return found;
+}
+
+/* producer(): arg * parameter, return NULL; put this producer's values in, in order */
+static void *producer(void *arg){
+    handoff_arg_t *a = arg;
+    long base = a->id * a->per_producer;
+    for(long i = 0; i < a->per_producer; i++){
+        value_t v;
+        char buf[24];
+        if(a->strings && i % 8 == 7){
+            snprintf(buf, sizeof(buf), "%ld", base + i);
+            v.sval = buf;
+            handoff_put(a, v, VAL_STR);
+        }else{
+            v.ival = (int) (base + i);
+            handoff_put(a, v, VAL_INT);
+        }
+    }
+    return NULL;
+}
+
+/* consumer(): arg * parameter, return NULL; take values out until every producer's values are
+   accounted for, checking them if this is the stress test */
+static void *consumer(void *arg){
+    handoff_arg_t *a = arg;
+    long total = a->producers * a->per_producer;
+    long *last_from = malloc(a->producers * sizeof(long));   /* newest number seen per producer */
+    for(int p = 0; p < a->producers; p++){
+        last_from[p] = -1;
+    }
+    while(atomic_load(a->taken) < total){
+        value_t v;
+        value_type_t t;
+        if(!handoff_take(a, &v, &t)){
+            sched_yield();      /* nothing there yet: give a producer the CPU */
+            continue;
+        }
+        atomic_fetch_add(a->taken, 1);
+        long number = t == VAL_STR ? atol(v.sval) : v.ival;
+        if(t == VAL_STR){
+            free(v.sval);
+        }
+        if(a->seen == NULL){
+            continue;
+        }
+        if(number < 0 || number >= total){
+            a->failed = true;
+            continue;
+        }
+        int from = (int) (number / a->per_producer);
+        if(number <= last_from[from]){
+            a->failed = true;       /* out of order for that producer */
+        }
+        last_from[from] = number;
+        if(__atomic_add_fetch(&a->seen[number], 1, __ATOMIC_RELAXED) != 1){
+            a->failed = true;
+        }
+    }
+    free(last_from);
+    return NULL;
+}
+
+/* handoff(): queue (or NULL), list, producer and consumer counts, values per producer, and whether
+   to check the values, return the time taken in ns (or a negative number if a check failed) */
+static double handoff(lfqueue_t *q, locked_list_t *ll, int producers, int consumers,
+                      long per_producer, bool check){
+    long total = producers * per_producer;
+    atomic_long taken;
+    atomic_init(&taken, 0);
+    unsigned char *seen = check ? calloc(total, 1) : NULL;
+    int threads = producers + consumers;
+    handoff_arg_t *args = malloc(threads * sizeof(handoff_arg_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+
+    double start = now_ns();
+    for(int i = 0; i < threads; i++){
+        args[i] = (handoff_arg_t){ q, ll, i, producers, per_producer, check, &taken, seen, false };
+        pthread_create(&tids[i], NULL, i < producers ? producer : consumer, &args[i]);
+    }
+    bool ok = true;
+    for(int i = 0; i < threads; i++){
+        pthread_join(tids[i], NULL);
+        ok = ok && !args[i].failed;
+    }
+    double ns = now_ns() - start;
+
+    if(check){
+        for(long i = 0; i < total; i++){
+            ok = ok && seen[i] == 1;
+        }
+        value_t v;
+        ok = ok && !lfq_dequeue(q, &v, NULL);   /* nothing may be left over */
+    }
+    free(seen);
+    free(args);
+    free(tids);
+    return ok ? ns : -1;
+}
+
+int main(int argc, char **argv){
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    long per_producer = argc > 2 ? atol(argv[2]) : 1000000;
+    if(max_threads < 2){
+        max_threads = 2;
+    }
+
+    bool ok = true;
+    for(int producers = 1; producers <= max_threads / 2; producers *= 2){
+        for(int consumers = 1; consumers <= max_threads / 2; consumers *= 2){
+            lfqueue_t *q = lfq_new();
+            bool passed = handoff(q, NULL, producers, consumers, 100000, true) >= 0;
+            printf("stress %2d producers, %2d consumers: %s\n", producers, consumers,
+                   passed ? "ok" : "!!! FAILED !!!");
+            ok = ok && passed;
+            lfq_free(q);
+        }
+    }
+
+    printf("\n%7s %15s %15s\n", "threads", "lfqueue Mops/s", "locked Mops/s");
+    for(int threads = 2; threads <= max_threads; threads += 2){
+        lfqueue_t *q = lfq_new();
+        double lf_ns = handoff(q, NULL, threads / 2, threads / 2, per_producer, false);
+        lfq_free(q);
+
+        locked_list_t ll;
+        ll.l = list_new();
+        pthread_mutex_init(&ll.lock, NULL);
+        double locked_ns = handoff(NULL, &ll, threads / 2, threads / 2, per_producer, false);
+        list_free(ll.l);
+        pthread_mutex_destroy(&ll.lock);
+
+        /* each value is one enqueue and one dequeue */
+        double ops = 2.0 * (threads / 2) * per_producer;
+        printf("%7d %15.2f %15.2f\n", threads, ops / lf_ns * 1e3, ops / locked_ns * 1e3);
+    }
+    return ok ? 0 : 1;
+}
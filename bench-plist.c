@@ -0,0 +1,343 @@
+/*
+ *  This file (bench-plist.c) checks and measures the persistent list (plist.c).
+ *
+ *  It runs in three parts:
+ *      - checks on one thread: old versions must keep their values while newer ones grow (across
+ *        several levels of the tree), appending to an old version must not disturb the newer
+ *        ones made from it, and pushes, gets and plist_to_list must agree.
+ *      - a stress test: one writer keeps appending (and now and then pushing) and publishes each
+ *        version through a plist_share_t, while reader threads take snapshots and check that
+ *        each one is a complete, consistent list of everything written up to some point.
+ *      - a benchmark at growing sizes: appending, taking a snapshot and reading a random index,
+ *        against what a list_t needs for the same (appending, a full copy, and list_get on a
+ *        LIST_RING list, the quickest list_get there is).
+ *
+ *  Build and run it with 'make bench-plist'. The first argument is the largest size (default
+ *  1000000) and the second the number of reader threads in the stress test (default 4).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench-common.h"
+#include "plist.h"
+
+/* CHECKING A VERSION */
+/* Every list here is built the same way: appended values count up from 0 (every 8th one is a
+   string holding the number), and pushed values count down from -1. So a correct version is
+   -j, ..., -2, -1 followed by 0, 1, ..., k-1 */
+
+typedef struct{
+    long appended;      /* appended values seen so far */
+    long last_neg;      /* the last pushed value seen, or 0 */
+    bool ok;
+} check_t;
+
+/* make_value(): number and value * parameters, return the type of the value for that number,
+   storing it (strings in 'buf', which must hold 24 characters) */
+static value_type_t make_value(long number, value_t *v, char *buf){
+    if(number >= 0 && number % 8 == 7){
+        snprintf(buf, 24, "%ld", number);
+        v->sval = buf;
+        return VAL_STR;
+    }
+    v->ival = (int) number;
+    return VAL_INT;
+}
+
+/* check_visit(): visit callback that checks each value against what should come next */
+static bool check_visit(value_t v, value_type_t t, void *arg){
+    check_t *c = arg;
+    if(t == VAL_INT && v.ival < 0){
+        if(c->appended > 0 || (c->last_neg != 0 && v.ival != c->last_neg + 1)){
+            c->ok = false;
+        }
+        c->last_neg = v.ival;
+        return c->ok;
+    }
+    bool string = c->appended % 8 == 7;
+    long number = t == VAL_STR ? atol(v.sval) : v.ival;
+    if(number != c->appended || string != (t == VAL_STR)){
+        c->ok = false;
+    }
+    c->appended++;
+    return c->ok;
+}
+
+/* check_version(): plist * and expected count parameters, return true if the version holds
+   exactly 'pushes' pushed and 'appends' appended values (negative counts mean any number) in
+   the right order, and plist_get agrees with plist_foreach at a few indexes */
+static bool check_version(const plist_t *p, long pushes, long appends){
+    check_t c = { 0, 0, true };
+    int visited = plist_foreach(check_visit, &c, p);
+    bool ok = c.ok && visited == plist_size(p) && (c.last_neg == 0 || c.last_neg == -1);
+    long pushed = visited - c.appended;
+    ok = ok && (pushes < 0 || pushed == pushes) && (appends < 0 || c.appended == appends);
+    /* index i holds i - pushed, whichever part it's in */
+    for(int i = 0; ok && i < visited; i += 1 + visited / 7){
+        value_t v = plist_get(i, p);
+        value_type_t t = plist_get_type(i, p);
+        ok = (t == VAL_STR ? atol(v.sval) : v.ival) == i - pushed;
+    }
+    return ok && plist_get_type(visited, p) == VAL_NONE && plist_get(-1, p).sval == NULL;
+}
+
+/* CHECKS ON ONE THREAD */
+
+#define CHECK_SIZE 40000    /* past 32 * 32 * 32, so the tree reaches four levels */
+#define CHECK_EVERY 997
+
+/* single_thread_checks(): no parameters, return true if everything checked out */
+static bool single_thread_checks(void){
+    bool ok = true;
+    char buf[24];
+    value_t v;
+
+    /* grow one list, keeping every CHECK_EVERY'th version; they must all stay as they were */
+    plist_t *kept[CHECK_SIZE / CHECK_EVERY + 1];
+    int nkept = 0;
+    plist_t *cur = plist_new();
+    for(long i = 0; i < CHECK_SIZE; i++){
+        if(i % CHECK_EVERY == 0){
+            kept[nkept++] = plist_snapshot(cur);
+        }
+        value_type_t t = make_value(i, &v, buf);
+        plist_t *next = plist_append(v, t, cur);
+        plist_release(cur);
+        cur = next;
+    }
+    ok = ok && check_version(cur, 0, CHECK_SIZE);
+    for(int k = 0; k < nkept; k++){
+        ok = ok && check_version(kept[k], 0, (long) k * CHECK_EVERY);
+    }
+
+    /* branch off an old version (its tail is half full, and a newer version has used the rest):
+       the branch gets its own leaf, and neither the old version nor the newer one notices */
+    plist_t *old = kept[1];
+    v.ival = -1000;
+    plist_t *branch = plist_append(v, VAL_INT, old);
+    ok = ok && plist_size(branch) == CHECK_EVERY + 1;
+    ok = ok && plist_get(CHECK_EVERY, branch).ival == -1000;
+    ok = ok && check_version(old, 0, CHECK_EVERY) && check_version(kept[2], 0, 2 * CHECK_EVERY);
+    ok = ok && check_version(cur, 0, CHECK_SIZE);
+    plist_release(branch);
+    for(int k = 0; k < nkept; k++){
+        plist_release(kept[k]);
+    }
+
+    /* pushes in front of the appended values; an old version keeps its shorter front */
+    plist_t *before = plist_snapshot(cur);
+    for(long i = 1; i <= 100; i++){
+        value_type_t t = make_value(-i, &v, buf);
+        plist_t *next = plist_push(v, t, cur);
+        plist_release(cur);
+        cur = next;
+    }
+    ok = ok && check_version(cur, 100, CHECK_SIZE) && check_version(before, 0, CHECK_SIZE);
+    ok = ok && plist_get(0, cur).ival == -100 && plist_get(100, cur).ival == 0;
+
+    /* plist_to_list copies the values in order */
+    list_t *l = plist_to_list(cur);
+    ok = ok && l != NULL && list_size(l) == plist_size(cur) && list_get(0, l).ival == -100;
+    ok = ok && list_get_type(107, l) == VAL_STR && strcmp(list_get(107, l).sval, "7") == 0;
+    list_free(l);
+
+    /* values without a real type are turned away, rather than stored with a made-up tag */
+    v.ival = 1;
+    ok = ok && plist_append(v, VAL_NONE, cur) == NULL;
+    ok = ok && plist_push(v, (value_type_t) 9, cur) == NULL;
+
+    /* a version made only of pushes, and the empty version */
+    plist_t *empty = plist_new();
+    v.ival = -1;
+    plist_t *one = plist_push(v, VAL_INT, empty);
+    ok = ok && check_version(empty, 0, 0) && check_version(one, 1, 0);
+    plist_release(one);
+    plist_release(empty);
+    plist_release(before);
+    plist_release(cur);
+    return ok;
+}
+
+/* STRESS TEST */
+
+#define STRESS_OPS 300000
+
+typedef struct{
+    plist_share_t *share;
+    atomic_bool *done;
+    long snapshots;
+    bool failed;
+} reader_arg_t;
+
+/* reader(): arg * parameter, return NULL; keep checking snapshots until the writer is done. Sizes
+   must never go backwards, since each snapshot is at least as new as the last */
+static void *reader(void *arg){
+    reader_arg_t *a = arg;
+    int last_size = 0;
+    while(!atomic_load(a->done)){
+        plist_t *p = plist_share_get(a->share);
+        if(plist_size(p) < last_size || !check_version(p, -1, -1)){
+            a->failed = true;
+        }
+        last_size = plist_size(p);
+        plist_release(p);
+        a->snapshots++;
+    }
+    return NULL;
+}
+
+/* stress(): number of readers parameter, return true if every snapshot checked out */
+static bool stress(int readers){
+    plist_t *cur = plist_new();
+    plist_share_t share;
+    plist_share_init(&share, cur);
+    atomic_bool done;
+    atomic_init(&done, false);
+    reader_arg_t *args = malloc(readers * sizeof(reader_arg_t));
+    pthread_t *tids = malloc(readers * sizeof(pthread_t));
+    for(int i = 0; i < readers; i++){
+        args[i] = (reader_arg_t){ &share, &done, 0, false };
+        pthread_create(&tids[i], NULL, reader, &args[i]);
+    }
+
+    long appended = 0, pushed = 0;
+    char buf[24];
+    for(long i = 0; i < STRESS_OPS; i++){
+        value_t v;
+        plist_t *next;
+        if(i % 64 == 63){
+            value_type_t t = make_value(-(++pushed), &v, buf);
+            next = plist_push(v, t, cur);
+        }else{
+            value_type_t t = make_value(appended++, &v, buf);
+            next = plist_append(v, t, cur);
+        }
+        plist_release(cur);
+        cur = next;
+        plist_share_set(&share, cur);
+    }
+    atomic_store(&done, true);
+
+    bool ok = check_version(cur, pushed, appended);
+    long snapshots = 0;
+    for(int i = 0; i < readers; i++){
+        pthread_join(tids[i], NULL);
+        ok = ok && !args[i].failed;
+        snapshots += args[i].snapshots;
+    }
+    printf("stress 1 writer, %d readers: %ld snapshots checked: %s\n", readers, snapshots,
+           ok ? "ok" : "!!! FAILED !!!");
+    plist_share_destroy(&share);
+    plist_release(cur);
+    free(args);
+    free(tids);
+    return ok;
+}
+
+/* BENCHMARK */
+
+/* copy_list(): list * parameter, return a full copy of the list (what taking a snapshot of a
+   list_t costs today) */
+static list_t *copy_list(list_t *l){
+    list_t *copy = list_new();
+    for(list_cursor_t c = list_cursor_begin(l); list_cursor_valid(&c); list_cursor_next(&c)){
+        list_append(list_cursor_get(&c), list_cursor_type(&c), copy);
+    }
+    return copy;
+}
+
+/* sum_visit(): visit callback that adds up int values */
+static bool sum_visit(value_t v, value_type_t t, void *arg){
+    if(t == VAL_INT){
+        *(long *) arg += v.ival;
+    }
+    return true;
+}
+
+/* bench(): size parameter, no return value; print one row of the table */
+static void bench(long n){
+    char buf[24];
+    value_t v;
+
+    double start = now_ns();
+    plist_t *p = plist_new();
+    for(long i = 0; i < n; i++){
+        value_type_t t = make_value(i, &v, buf);
+        plist_t *next = plist_append(v, t, p);
+        plist_release(p);
+        p = next;
+    }
+    double p_append = (now_ns() - start) / n;
+
+    start = now_ns();
+    list_t *l = list_new_mode(LIST_RING);
+    for(long i = 0; i < n; i++){
+        value_type_t t = make_value(i, &v, buf);
+        list_append(v, t, l);
+    }
+    double l_append = (now_ns() - start) / n;
+
+    int reps = 1000000;
+    start = now_ns();
+    for(int r = 0; r < reps; r++){
+        plist_release(plist_snapshot(p));
+    }
+    double p_snap = (now_ns() - start) / reps;
+
+    reps = n >= 1000000 ? 3 : (int) (10000000 / n);
+    start = now_ns();
+    for(int r = 0; r < reps; r++){
+        list_free(copy_list(l));
+    }
+    double l_snap = (now_ns() - start) / reps;
+
+    reps = 1000000;
+    unsigned int seed = 12345;
+    volatile long sink = 0;     /* keeps the compiler from skipping the reads */
+    start = now_ns();
+    for(int r = 0; r < reps; r++){
+        seed = seed * 1103515245 + 12345;
+        sink += plist_get_type((int) (seed % n), p);
+    }
+    double p_get = (now_ns() - start) / reps;
+    start = now_ns();
+    for(int r = 0; r < reps; r++){
+        seed = seed * 1103515245 + 12345;
+        sink += list_get_type((int) (seed % n), l);
+    }
+    double l_get = (now_ns() - start) / reps;
+
+    start = now_ns();
+    long sum = 0;
+    plist_foreach(sum_visit, &sum, p);
+    sink += sum;
+    double p_scan = (now_ns() - start) / n;
+
+    printf("%9ld %10.1f %10.1f %10.1f %12.1f %10.1f %10.1f %10.2f\n", n, p_append, l_append,
+           p_snap, l_snap / 1000, p_get, l_get, p_scan);
+    plist_release(p);
+    list_free(l);
+}
+
+int main(int argc, char **argv){
+    long max = argc > 1 ? atol(argv[1]) : 1000000;
+    int readers = argc > 2 ? atoi(argv[2]) : 4;
+    if(readers < 1){
+        readers = 1;
+    }
+
+    bool ok = single_thread_checks();
+    printf("single thread checks: %s\n", ok ? "ok" : "!!! FAILED !!!");
+    ok = stress(readers) && ok;
+
+    /* ns per operation, except the list_t copy, which is in microseconds */
+    printf("\n%9s %10s %10s %10s %12s %10s %10s %10s\n", "size", "p_append", "l_append",
+           "p_snapshot", "l_copy(us)", "p_get", "l_get", "p_scan");
+    for(long n = 1000; n <= max; n *= 10){
+        bench(n);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+/*
+ *  This file (bench-simd.c) compares the search kernels in list-simd.c with a plain scan.
+ *
+ *  For a few list sizes it builds the same list (mostly ints, with a char every 8 values) and
+ *  times list_count_type, list_find_int and list_find_char, which each have to look at every
+ *  value since what they look for isn't there (or, for the count, is everywhere):
+ *      - "chain" is the classic layout, where every value means following one more pointer
+ *      - "scalar", "sse2" and "avx2" are LIST_UNROLLED, with each kind of kernel the CPU has
+ *
+ *  Build and run it with 'make bench-simd'.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bench-common.h"
+#include "list-internal.h"  /* list_simd_use() and the LIST_SIMD_* levels */
+
+/* build(): list mode and size parameters, return a new list of n values, or NULL */
+static list_t *build(list_mode_t mode, int n){
+    list_t *l = list_new_mode(mode);
+    if(l == NULL){
+        return NULL;
+    }
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = 0;
+        if(i % 8 == 0){
+            v.cval = 'a' + i % 26;
+            list_append(v, VAL_CHAR, l);
+        }else{
+            v.ival = i;
+            list_append(v, VAL_INT, l);
+        }
+    }
+    return l;
+}
+
+/* bench_list(): list *, its name and a size, no return value; time each search and print one
+   line of results, in nanoseconds per value looked at */
+static void bench_list(list_t *l, const char *name, int n){
+    /* search a few times so small sizes still take long enough to measure */
+    int rounds = n < 100000 ? 200 : 10;
+    long long check = 0;
+
+    double start = now_ns();
+    for(int r = 0; r < rounds; r++){
+        check += list_count_type(VAL_INT, l);
+    }
+    double count_ns = (now_ns() - start) / ((double) rounds * n);
+
+    start = now_ns();
+    for(int r = 0; r < rounds; r++){
+        check += list_find_int(-1, 0, l);
+    }
+    double int_ns = (now_ns() - start) / ((double) rounds * n);
+
+    start = now_ns();
+    for(int r = 0; r < rounds; r++){
+        check += list_find_char('!', 0, l);
+    }
+    double char_ns = (now_ns() - start) / ((double) rounds * n);
+
+    printf("%-7s %9d %10.3f %10.3f %10.3f   (checksum %lld)\n",
+           name, n, count_ns, int_ns, char_ns, check);
+}
+
+int main(){
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    printf("%-7s %9s %10s %10s %10s\n", "scan", "n", "count_type", "find_int", "find_char");
+    for(int n = 1000; n <= 1000000; n *= 10){
+        list_t *l = build(LIST_CHAIN, n);
+        if(l == NULL){
+            printf("%-7s %9d  list_new_mode() failed\n", "chain", n);
+            continue;
+        }
+        bench_list(l, "chain", n);
+        list_free(l);
+
+        l = build(LIST_UNROLLED, n);
+        if(l == NULL){
+            printf("%-7s %9d  list_new_mode() failed\n", "unroll", n);
+            continue;
+        }
+        for(int level = LIST_SIMD_SCALAR; level <= LIST_SIMD_AVX2; level++){
+            if(list_simd_use(level) == level){
+                bench_list(l, names[level], n);
+            }else{
+                printf("%-7s %9d  (this CPU can't)\n", names[level], n);
+            }
+        }
+        list_free(l);
+    }
+    return 0;
+}
@@ -0,0 +1,778 @@
+/*
+ *  This file (bench-suite.c) is the benchmark suite for the linked list, run with 'make bench'.
+ *
+ *  Every benchmark case runs once per list mode and list size, in its own child process (so the
+ *  peak memory we report belongs to that case alone). Each run prints one CSV line:
+ *
+ *      case,mode,n,ops,ns_per_op,allocs_per_op,peak_rss_kb
+ *
+ *  Allocations are counted by wrapping malloc/calloc/realloc at link time (see the Makefile), and
+ *  only the timed part of a case counts. Sizes go from 1e3 up to 1e7 by default; pass a smaller
+ *  maximum as the first argument (or BENCH_MAX=... to make) for a quicker run, and a case name
+ *  as the second argument to run just that case.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "bench-common.h"
+#include "list.h"
+
+/* ALLOCATION COUNTING */
+/* The linker sends every malloc call in our own code to __wrap_malloc, and __real_malloc is the
+   actual C library function */
+void *__real_malloc(size_t);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+
+static long long alloc_count = 0;
+
+void *__wrap_malloc(size_t size){
+    alloc_count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size){
+    alloc_count++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *p, size_t size){
+    alloc_count++;
+    return __real_realloc(p, size);
+}
+
+/* TIMING */
+
+/* A case fills one of these in: how many operations it timed, and the time/allocs they took */
+typedef struct{
+    long long ops;
+    double ns;
+    long long allocs;
+} bench_result_t;
+
+/* Cases bracket the part they want measured with these two */
+static double timer_start;
+static long long allocs_start;
+
+static void measure_begin(void){
+    allocs_start = alloc_count;
+    timer_start = now_ns();
+}
+
+static void measure_end(bench_result_t *r, long long ops){
+    r->ns = now_ns() - timer_start;
+    r->allocs = alloc_count - allocs_start;
+    r->ops = ops;
+}
+
+/* VALUES */
+/* Strings that do and don't fit inside a node (see LIST_SSO_SIZE) */
+static char short_str[] = "short";
+static char long_str[] = "a string that is much too long to live inside a node";
+
+/* The value kinds a case can fill a list with */
+typedef enum{
+    FILL_INT,       /* all ints */
+    FILL_MIXED,     /* char, int, bool, short string, in turn */
+    FILL_SHORT_STR, /* all short strings */
+    FILL_LONG_STR   /* all long strings */
+} fill_t;
+
+/* value_for(): fill kind, index and value_type_t * parameters, return the i'th value of that
+   fill kind and put its type in *t */
+static value_t value_for(fill_t fill, int i, value_type_t *t){
+    value_t v;
+    switch(fill){
+        case FILL_MIXED:
+            switch(i % 4){
+                case 0: v.cval = 'a' + i % 26; *t = VAL_CHAR; return v;
+                case 1: v.ival = i; *t = VAL_INT; return v;
+                case 2: v.bval = i & 1; *t = VAL_BOOL; return v;
+                default: v.sval = short_str; *t = VAL_STR; return v;
+            }
+        case FILL_SHORT_STR:
+            v.sval = short_str;
+            *t = VAL_STR;
+            return v;
+        case FILL_LONG_STR:
+            v.sval = long_str;
+            *t = VAL_STR;
+            return v;
+        default:
+            v.ival = i;
+            *t = VAL_INT;
+            return v;
+    }
+}
+
+/* build(): mode, size and fill kind parameters, return a list of n values (not timed) */
+static list_t *build(list_mode_t mode, int n, fill_t fill){
+    list_t *l = list_new_mode(mode);
+    for(int i = 0; i < n; i++){
+        value_type_t t;
+        value_t v = value_for(fill, i, &t);
+        list_append(v, t, l);
+    }
+    return l;
+}
+
+/* CASES */
+
+static void case_append(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = list_new_mode(mode);
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = i;
+        list_append(v, VAL_INT, l);
+    }
+    measure_end(r, n);
+    list_free(l);
+}
+
+static void case_append_bulk(list_mode_t mode, int n, bench_result_t *r){
+    value_t *vals = malloc(n * sizeof(value_t));
+    for(int i = 0; i < n; i++){
+        vals[i].ival = i;
+    }
+    list_t *l = list_new_mode(mode);
+    measure_begin();
+    list_append_array_type(vals, VAL_INT, n, l);
+    measure_end(r, n);
+    list_free(l);
+    free(vals);
+}
+
+static void case_push(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = list_new_mode(mode);
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = i;
+        list_push(v, VAL_INT, l);
+    }
+    measure_end(r, n);
+    list_free(l);
+}
+
+static void case_pop(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    long long sum = 0;
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        sum += list_pop(l).ival;
+    }
+    measure_end(r, n);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+static void case_remove_last(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    long long sum = 0;
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        sum += list_remove_last(l).ival;
+    }
+    measure_end(r, n);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+static void case_get_seq(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    long long sum = 0;
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        sum += list_get(i, l).ival;
+    }
+    measure_end(r, n);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+static void case_get_rand(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    /* a random index costs O(n), so keep the total work about the same for every size */
+    long long ops = 200000000LL / n;
+    if(ops > n){
+        ops = n;
+    }
+    if(ops < 10){
+        ops = 10;
+    }
+    unsigned int seed = 429;
+    long long sum = 0;
+    measure_begin();
+    for(long long i = 0; i < ops; i++){
+        seed = seed * 1103515245u + 12345u;
+        sum += list_get((int) (seed % (unsigned int) n), l).ival;
+    }
+    measure_end(r, ops);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+/* the same random reads with a skip layer (only a chain can have one; the other modes are read
+   as in case_get_rand), then inserts and removals at random indices */
+static void case_get_rand_skip(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    bool skip = list_use_skip(l);
+    long long ops = skip ? n : 200000000LL / n;
+    if(ops > n){
+        ops = n;
+    }
+    if(ops < 10){
+        ops = 10;
+    }
+    unsigned int seed = 429;
+    long long sum = 0;
+    measure_begin();
+    for(long long i = 0; i < ops; i++){
+        seed = seed * 1103515245u + 12345u;
+        sum += list_get((int) (seed % (unsigned int) n), l).ival;
+    }
+    measure_end(r, ops);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+static void case_insert_rand_skip(list_mode_t mode, int n, bench_result_t *r){
+    /* list_insert_at doesn't work in the middle of an unrolled list, so that runs the chain again.
+       A ring list shifts up to half its values each time, so it gets fewer operations */
+    if(mode == LIST_UNROLLED){
+        mode = LIST_CHAIN;
+    }
+    list_t *l = build(mode, n, FILL_INT);
+    list_use_skip(l);
+    list_get(n / 2, l);         /* builds the layer before the clock starts */
+    long long ops = mode == LIST_RING ? 200000000LL / n : n;
+    if(ops > n){
+        ops = n;
+    }
+    if(ops < 10){
+        ops = 10;
+    }
+    unsigned int seed = 429;
+    value_t v;
+    v.ival = 1;
+    measure_begin();
+    for(long long i = 0; i < ops; i++){
+        seed = seed * 1103515245u + 12345u;
+        int at = (int) (seed % (unsigned int) list_size(l));
+        if(i & 1){
+            list_remove_at(at, l);
+        }else{
+            list_insert_at(at, v, VAL_INT, l);
+        }
+    }
+    measure_end(r, ops);
+    list_free(l);
+}
+
+/* the mix most of our lists see: values come and go at both ends, with a list_get now and then.
+   The list keeps about n values throughout */
+static void case_deque_mix(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    unsigned int seed = 429;
+    long long sum = 0;
+    value_t v;
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        seed = seed * 1103515245u + 12345u;
+        v.ival = i;
+        switch(i & 7){
+            case 0: list_push(v, VAL_INT, l); break;
+            case 1: list_append(v, VAL_INT, l); break;
+            case 2: case 5: sum += list_pop(l).ival; break;
+            case 3: list_append(v, VAL_INT, l); break;
+            case 4: sum += list_remove_last(l).ival; break;
+            case 6: list_push(v, VAL_INT, l); break;
+            default: sum += list_get((int) (seed % (unsigned int) list_size(l)), l).ival; break;
+        }
+    }
+    measure_end(r, n);
+    if(sum < 0){
+        printf("# impossible checksum %lld\n", sum);
+    }
+    list_free(l);
+}
+
+/* reduce_sum(): adds one int to the running total (for case_reduce) */
+static value_t reduce_sum(value_t total, value_t v, value_type_t t, void *arg){
+    (void) t;
+    (void) arg;
+    total.ival += v.ival;
+    return total;
+}
+
+static value_t reduce_add(value_t a, value_t b, void *arg){
+    (void) arg;
+    a.ival += b.ival;
+    return a;
+}
+
+/* the same sum as case_get_seq, with list_reduce instead of a list_get loop */
+static void case_reduce(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_INT);
+    value_t zero;
+    zero.ival = 0;
+    measure_begin();
+    value_t sum = list_reduce(reduce_sum, reduce_add, zero, LIST_TYPE_BIT(VAL_INT), NULL, l);
+    measure_end(r, n);
+    if(sum.ival == -1){
+        printf("# impossible checksum %d\n", sum.ival);
+    }
+    list_free(l);
+}
+
+static void case_free(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_LONG_STR);
+    measure_begin();
+    list_free(l);
+    measure_end(r, n);
+}
+
+/* the same list as case_free, built in an arena: tearing it down is one arena_reset. Arena lists
+   are always LIST_CHAIN, so every mode runs the same thing */
+static void case_free_arena(list_mode_t mode, int n, bench_result_t *r){
+    (void) mode;
+    arena_t *arena = arena_new(0);
+    list_t *l = list_new_in_arena(arena);
+    for(int i = 0; i < n; i++){
+        value_type_t t;
+        value_t v = value_for(FILL_LONG_STR, i, &t);
+        list_append(v, t, l);
+    }
+    measure_begin();
+    list_free(l);
+    arena_reset(arena);
+    measure_end(r, n);
+    arena_free(arena);
+}
+
+/* churn(): mode, size, fill kind and result parameters, no return value; append n values of the
+   given kind and pop them all again */
+static void churn(list_mode_t mode, int n, fill_t fill, bench_result_t *r){
+    list_t *l = list_new_mode(mode);
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        value_type_t t;
+        value_t v = value_for(fill, i, &t);
+        list_append(v, t, l);
+    }
+    for(int i = 0; i < n; i++){
+        list_pop(l);
+    }
+    measure_end(r, 2LL * n);
+    list_free(l);
+}
+
+static void case_churn_int(list_mode_t mode, int n, bench_result_t *r){
+    churn(mode, n, FILL_INT, r);
+}
+
+static void case_churn_mixed(list_mode_t mode, int n, bench_result_t *r){
+    churn(mode, n, FILL_MIXED, r);
+}
+
+static void case_churn_short_str(list_mode_t mode, int n, bench_result_t *r){
+    churn(mode, n, FILL_SHORT_STR, r);
+}
+
+static void case_churn_long_str(list_mode_t mode, int n, bench_result_t *r){
+    churn(mode, n, FILL_LONG_STR, r);
+}
+
+/* scan_types(): mode, size, fill kind and result parameters, no return value; time walking the
+   whole list and reading every value's type */
+static void scan_types(list_mode_t mode, int n, fill_t fill, bench_result_t *r){
+    list_t *l = build(mode, n, fill);
+    long long found = 0;
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        found += list_get_type(i, l) == VAL_INT;
+    }
+    measure_end(r, n);
+    if(found < 0){
+        printf("# impossible count %lld\n", found);
+    }
+    list_free(l);
+}
+
+static void case_scan_int(list_mode_t mode, int n, bench_result_t *r){
+    scan_types(mode, n, FILL_INT, r);
+}
+
+static void case_scan_mixed(list_mode_t mode, int n, bench_result_t *r){
+    scan_types(mode, n, FILL_MIXED, r);
+}
+
+/* REPEATED STRINGS */
+/* Both cases append n long strings picked from only 100 different ones; the second keeps them in
+   a string table. Compare their peak_rss_kb as well as their speed */
+
+/* dup_strings(): mode, size, whether to use a string table, and result parameters */
+static void dup_strings(list_mode_t mode, int n, bool intern, bench_result_t *r){
+    static char words[100][64];
+    for(int i = 0; i < 100; i++){
+        snprintf(words[i], sizeof(words[i]), "%s #%d", long_str, i);
+    }
+    list_t *l = list_new_mode(mode);
+    if(intern){
+        list_use_intern(NULL, l);
+    }
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.sval = words[i % 100];
+        list_append(v, VAL_STR, l);
+    }
+    measure_end(r, n);
+    list_free(l);
+}
+
+static void case_dup_str(list_mode_t mode, int n, bench_result_t *r){
+    dup_strings(mode, n, false, r);
+}
+
+static void case_dup_str_intern(list_mode_t mode, int n, bench_result_t *r){
+    dup_strings(mode, n, true, r);
+}
+
+/* SAVING AND LOADING */
+/* These use a file of mixed values in /tmp, which save_mixed() writes (untimed, except for
+   case_save itself) and each case removes when it's done */
+
+static char bench_path[] = "/tmp/bench-suite-list-XXXXXX";
+
+/* save_mixed(): mode, size and result parameters, return true if a mixed list of n values was
+   saved to bench_path; the save is timed if r isn't NULL */
+static bool save_mixed(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_MIXED);
+    int fd = mkstemp(bench_path);
+    if(fd < 0){
+        list_free(l);
+        return false;
+    }
+    if(r != NULL){
+        measure_begin();
+    }
+    bool ok = list_save(fd, l);
+    if(r != NULL){
+        measure_end(r, n);
+    }
+    close(fd);
+    list_free(l);
+    return ok;
+}
+
+static void case_save(list_mode_t mode, int n, bench_result_t *r){
+    if(!save_mixed(mode, n, r)){
+        printf("# list_save() failed\n");
+    }
+    unlink(bench_path);
+}
+
+static void case_load(list_mode_t mode, int n, bench_result_t *r){
+    save_mixed(mode, n, NULL);
+    measure_begin();
+    list_t *l = list_load(bench_path);
+    measure_end(r, n);
+    if(l == NULL){
+        printf("# list_load() failed\n");
+    }
+    list_free(l);
+    unlink(bench_path);
+}
+
+/* open a view and read every value: no list gets built at all */
+static void case_view(list_mode_t mode, int n, bench_result_t *r){
+    save_mixed(mode, n, NULL);
+    long long sum = 0;
+    measure_begin();
+    list_view_t *view = list_view_open(bench_path);
+    for(int i = 0; i < n; i++){
+        if(list_view_get_type(i, view) == VAL_INT){
+            sum += list_view_get(i, view).ival;
+        }
+    }
+    measure_end(r, n);
+    if(view == NULL || sum < 0){
+        printf("# list_view_open() failed\n");
+    }
+    list_view_close(view);
+    unlink(bench_path);
+}
+
+/* FORMATTING */
+/* Both cases write a mixed list's text to /dev/null, so only making the text gets timed */
+
+static bool file_sink(const char *s, size_t len, void *out){
+    return fwrite(s, 1, len, out) == len;
+}
+
+static void case_format(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_MIXED);
+    FILE *out = fopen("/dev/null", "w");
+    measure_begin();
+    bool ok = out != NULL && list_write(file_sink, out, l);
+    measure_end(r, n);
+    if(!ok){
+        printf("# list_write() failed\n");
+    }
+    if(out != NULL){
+        fclose(out);
+    }
+    list_free(l);
+}
+
+/* the same text, made the way list_print used to: a couple of fprintf calls per value */
+static void case_format_printf(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build(mode, n, FILL_MIXED);
+    FILE *out = fopen("/dev/null", "w");
+    if(out == NULL){
+        printf("# can't open /dev/null\n");
+        list_free(l);
+        return;
+    }
+    measure_begin();
+    fprintf(out, "[");
+    for(int i = 0; i < n; i++){
+        if(i > 0){
+            fprintf(out, "|");
+        }
+        value_t v = list_get(i, l);
+        switch(list_get_type(i, l)){
+            case VAL_CHAR: fprintf(out, " (char) %c ", v.cval); break;
+            case VAL_INT: fprintf(out, " (int) %d ", v.ival); break;
+            case VAL_BOOL: fprintf(out, " (bool) %d ", v.bval); break;
+            default: fprintf(out, " (char *) %s ", v.sval); break;
+        }
+    }
+    fprintf(out, "]");
+    measure_end(r, n);
+    fclose(out);
+    list_free(l);
+}
+
+/* SORTING */
+/* Both cases sort the same shuffled list of ints and strings */
+
+/* build_shuffled(): mode and size parameters, return a list of n values in a scrambled order:
+   mostly ints, with every eighth a short string (not timed) */
+static list_t *build_shuffled(list_mode_t mode, int n){
+    static char *words[] = { "pear", "fig", "apple", "kiwi", "plum", "lime", "date", "yuzu" };
+    list_t *l = list_new_mode(mode);
+    unsigned int x = 12345;
+    for(int i = 0; i < n; i++){
+        x = x * 1103515245u + 12345u;
+        value_t v;
+        if(i % 8 == 7){
+            v.sval = words[(x >> 16) % 8];
+            list_append(v, VAL_STR, l);
+        }else{
+            v.ival = (int) (x >> 1);
+            list_append(v, VAL_INT, l);
+        }
+    }
+    return l;
+}
+
+static void case_sort(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build_shuffled(mode, n);
+    measure_begin();
+    bool ok = list_sort(NULL, NULL, l);
+    measure_end(r, n);
+    if(!ok){
+        printf("# list_sort() failed\n");
+    }
+    list_free(l);
+}
+
+/* what we had to do before list_sort: copy every value out with list_get, qsort the copies and
+   build a new list with list_append (copying every string again) */
+typedef struct{
+    value_t val;
+    value_type_t type;
+} sort_item_t;
+
+static int sort_item_cmp(const void *a, const void *b){
+    const sort_item_t *x = a;
+    const sort_item_t *y = b;
+    return list_cmp_value(x->val, x->type, y->val, y->type, NULL);
+}
+
+static void case_sort_rebuild(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = build_shuffled(mode, n);
+    sort_item_t *items = malloc((size_t) n * sizeof(sort_item_t));
+    measure_begin();
+    for(int i = 0; i < n; i++){
+        items[i].val = list_get(i, l);
+        items[i].type = list_get_type(i, l);
+    }
+    qsort(items, (size_t) n, sizeof(sort_item_t), sort_item_cmp);
+    list_t *sorted = list_new_mode(mode);
+    for(int i = 0; i < n; i++){
+        list_append(items[i].val, items[i].type, sorted);
+    }
+    list_free(l);
+    measure_end(r, n);
+    free(items);
+    list_free(sorted);
+}
+
+/* LOOKUPS */
+/* Both cases look for ints that are in the list (every other one of them) and ints that aren't */
+
+static void lookups(list_t *l, int n, int lookups, bench_result_t *r){
+    int found = 0;
+    unsigned int x = 777;
+    measure_begin();
+    for(int i = 0; i < lookups; i++){
+        x = x * 1103515245u + 12345u;
+        value_t v;
+        v.ival = (int) ((x >> 8) % (unsigned int) n) * 2 + (i & 1);
+        found += list_contains(v, VAL_INT, l);
+    }
+    measure_end(r, lookups);
+    if(found != lookups / 2){
+        printf("# list_contains() found %d of %d\n", found, lookups / 2);
+    }
+}
+
+static void case_contains(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = list_new_mode(mode);
+    list_use_index(l);      /* fails for unrolled and ring lists, which are then scanned */
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = 2 * i;
+        list_append(v, VAL_INT, l);
+    }
+    /* a scan takes O(n) per lookup, so those get fewer of them */
+    lookups(l, n, l->index != NULL ? n : 1000, r);
+    list_free(l);
+}
+
+static void case_contains_scan(list_mode_t mode, int n, bench_result_t *r){
+    list_t *l = list_new_mode(mode);
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = 2 * i;
+        list_append(v, VAL_INT, l);
+    }
+    lookups(l, n, 1000, r);
+    list_free(l);
+}
+
+/* THE CASE TABLE */
+
+typedef struct{
+    const char *name;
+    void (*run)(list_mode_t, int, bench_result_t *);
+} bench_case_t;
+
+static const bench_case_t cases[] = {
+    { "append",          case_append },
+    { "append_bulk",     case_append_bulk },
+    { "push",            case_push },
+    { "pop",             case_pop },
+    { "remove_last",     case_remove_last },
+    { "get_seq",         case_get_seq },
+    { "get_rand",        case_get_rand },
+    { "get_rand_skip",   case_get_rand_skip },
+    { "insert_rand_skip", case_insert_rand_skip },
+    { "deque_mix",       case_deque_mix },
+    { "reduce",          case_reduce },
+    { "free",            case_free },
+    { "free_arena",      case_free_arena },
+    { "churn_int",       case_churn_int },
+    { "churn_mixed",     case_churn_mixed },
+    { "churn_short_str", case_churn_short_str },
+    { "churn_long_str",  case_churn_long_str },
+    { "scan_int",        case_scan_int },
+    { "scan_mixed",      case_scan_mixed },
+    { "dup_str",         case_dup_str },
+    { "dup_str_intern",  case_dup_str_intern },
+    { "save",            case_save },
+    { "load",            case_load },
+    { "view",            case_view },
+    { "format",          case_format },
+    { "format_printf",   case_format_printf },
+    { "sort",            case_sort },
+    { "sort_rebuild",    case_sort_rebuild },
+    { "contains",        case_contains },
+    { "contains_scan",   case_contains_scan },
+};
+
+static const struct{
+    list_mode_t mode;
+    const char *name;
+} modes[] = {
+    { LIST_CHAIN,    "chain" },
+    { LIST_UNROLLED, "unrolled" },
+    { LIST_RING,     "ring" },
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+/* run_isolated(): case, mode index and size parameters, no return value; run the case in a child
+   process and let the child print its CSV line */
+static void run_isolated(const bench_case_t *c, size_t m, int n){
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0){
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0){
+        bench_result_t r;
+        c->run(modes[m].mode, n, &r);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("%s,%s,%d,%lld,%.2f,%.3f,%ld\n", c->name, modes[m].name, n, r.ops,
+               r.ns / r.ops, (double) r.allocs / r.ops, usage.ru_maxrss);
+        fflush(stdout);
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        printf("# %s,%s,%d did not finish\n", c->name, modes[m].name, n);
+    }
+}
+
+int main(int argc, char **argv){
+    long max_n = argc > 1 ? atol(argv[1]) : 10000000;
+    const char *only = argc > 2 ? argv[2] : NULL;
+
+    printf("case,mode,n,ops,ns_per_op,allocs_per_op,peak_rss_kb\n");
+    for(size_t c = 0; c < COUNT_OF(cases); c++){
+        if(only != NULL && strcmp(only, cases[c].name) != 0){
+            continue;
+        }
+        for(long n = 1000; n <= max_n; n *= 10){
+            for(size_t m = 0; m < COUNT_OF(modes); m++){
+                run_isolated(&cases[c], m, (int) n);
+            }
+        }
+    }
+    return 0;
+}
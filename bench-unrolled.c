@@ -0,0 +1,78 @@
+/*
+ *  This file (bench-unrolled.c) compares the classic LIST_CHAIN layout with LIST_UNROLLED.
+ *
+ *  For a few list sizes it builds the same list of ints both ways and reports:
+ *      - how many bytes of heap the list holds (measured with glibc's mallinfo2)
+ *      - how long it takes to walk the list with list_get, in order
+ *      - how long it takes to push and pop every value
+ *
+ *  Build and run it with 'make bench-unrolled'.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <malloc.h>     /* mallinfo2(), glibc only */
+
+#include "bench-common.h"
+#include "list.h"
+
+/* heap_in_use(): no parameters, return the number of heap bytes currently handed out (big
+   blocks come straight from mmap, and mallinfo2 counts those separately) */
+static size_t heap_in_use(void){
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+/* bench_mode(): list mode, its name and a size, no return value; run every measurement for one
+   list layout and print one line of results */
+static void bench_mode(list_mode_t mode, const char *name, int n){
+    size_t before = heap_in_use();
+    list_t *l = list_new_mode(mode);
+    if(l == NULL){
+        printf("%-9s %9d  list_new_mode() failed\n", name, n);
+        return;
+    }
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = i;
+        list_append(v, VAL_INT, l);
+    }
+    size_t bytes = heap_in_use() - before;
+
+    /* walk the list a few times so small sizes still take long enough to measure */
+    int rounds = n < 100000 ? 100 : 5;
+    long long sum = 0;
+    double start = now_ns();
+    for(int r = 0; r < rounds; r++){
+        for(int i = 0; i < n; i++){
+            sum += list_get(i, l).ival;
+        }
+    }
+    double iter_ns = (now_ns() - start) / ((double) rounds * n);
+
+    start = now_ns();
+    for(int i = 0; i < n; i++){
+        sum += list_pop(l).ival;
+    }
+    for(int i = 0; i < n; i++){
+        value_t v;
+        v.ival = i;
+        list_push(v, VAL_INT, l);
+    }
+    double churn_ns = (now_ns() - start) / (2.0 * n);
+
+    printf("%-9s %9d %12zu %10.1f %10.2f %10.2f   (checksum %lld)\n",
+           name, n, bytes, (double) bytes / n, iter_ns, churn_ns, sum);
+    list_free(l);
+}
+
+int main(){
+    printf("%-9s %9s %12s %10s %10s %10s\n",
+           "mode", "n", "heap bytes", "bytes/val", "get ns/op", "pop+push");
+    for(int n = 1000; n <= 1000000; n *= 10){
+        bench_mode(LIST_CHAIN, "chain", n);
+        bench_mode(LIST_UNROLLED, "unrolled", n);
+    }
+    return 0;
+}
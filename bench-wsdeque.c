@@ -0,0 +1,342 @@
+/*
+ *  This file (bench-wsdeque.c) checks and measures the work-stealing deque and thread pool
+ *  (wsdeque.c).
+ *
+ *  It runs in three parts:
+ *      - a stress test of the deque alone: one owner pushes and pops numbered values while
+ *        several thieves steal; every value must come out exactly once.
+ *      - a "tree" workload: one value is submitted, and its callback submits two smaller ones,
+ *        and so on, like a recursive Fibonacci. Almost all the work appears inside the pool.
+ *      - an "uneven" workload: lots of values are submitted from outside, and a few of them take
+ *        far longer to run than the rest.
+ *  Both workloads also run on a simple pool where every thread takes values from one shared list_t
+ *  behind a mutex. For each thread count we print the time and how evenly the work was spread
+ *  (the busiest thread's share compared to a perfectly even share; 1.00 is perfect).
+ *
+ *  Build and run it with 'make bench-wsdeque'. The first argument is the largest thread count
+ *  (default 8).
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sched.h>
+
+#include "bench-common.h"
+#include "wsdeque.h"
+
+/* DEQUE STRESS TEST */
+
+#define STRESS_VALUES 1000000
+
+typedef struct{
+    wsdeque_t *d;
+    unsigned char *seen;
+    atomic_bool *owner_done;
+    bool failed;
+} stress_arg_t;
+
+/* stress_record(): arg * and value parameters, no return value; count a value that came out */
+static void stress_record(stress_arg_t *a, value_t v, value_type_t t){
+    if(t != VAL_INT || v.ival < 0 || v.ival >= STRESS_VALUES
+            || __atomic_add_fetch(&a->seen[v.ival], 1, __ATOMIC_RELAXED) != 1){
+        a->failed = true;
+    }
+}
+
+/* stress_owner(): arg * parameter, return NULL; push every value, popping some back off now and
+   then, and pop whatever the thieves leave at the end */
+static void *stress_owner(void *arg){
+    stress_arg_t *a = arg;
+    value_t v;
+    value_type_t t;
+    for(int i = 0; i < STRESS_VALUES; i++){
+        v.ival = i;
+        if(!wsd_push(v, VAL_INT, a->d)){
+            a->failed = true;
+        }
+        if(i % 3 == 0 && wsd_pop(a->d, &v, &t)){
+            stress_record(a, v, t);
+        }
+    }
+    while(wsd_pop(a->d, &v, &t)){
+        stress_record(a, v, t);
+    }
+    atomic_store(a->owner_done, true);
+    return NULL;
+}
+
+/* stress_thief(): arg * parameter, return NULL; steal until the owner is done */
+static void *stress_thief(void *arg){
+    stress_arg_t *a = arg;
+    value_t v;
+    value_type_t t;
+    while(!atomic_load(a->owner_done)){
+        if(wsd_remove_last(a->d, &v, &t)){
+            stress_record(a, v, t);
+        }else{
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* stress(): thread count parameter (one owner, the rest thieves), return true if it checked out */
+static bool stress(int threads){
+    wsdeque_t *d = wsd_new();
+    unsigned char *seen = calloc(STRESS_VALUES, 1);
+    atomic_bool owner_done;
+    atomic_init(&owner_done, false);
+    stress_arg_t *args = malloc(threads * sizeof(stress_arg_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    for(int i = 0; i < threads; i++){
+        args[i] = (stress_arg_t){ d, seen, &owner_done, false };
+        pthread_create(&tids[i], NULL, i == 0 ? stress_owner : stress_thief, &args[i]);
+    }
+    bool ok = true;
+    for(int i = 0; i < threads; i++){
+        pthread_join(tids[i], NULL);
+        ok = ok && !args[i].failed;
+    }
+    for(int i = 0; i < STRESS_VALUES; i++){
+        ok = ok && seen[i] == 1;
+    }
+    printf("stress 1 owner, %2d thieves: %s\n", threads - 1, ok ? "ok" : "!!! FAILED !!!");
+    wsd_free(d);
+    free(seen);
+    free(args);
+    free(tids);
+    return ok;
+}
+
+/* WORKLOADS */
+
+/* The simple pool everything is compared with: one list_t, one lock, every thread takes the value
+   at the front */
+typedef struct{
+    list_t *l;
+    pthread_mutex_t lock;
+    atomic_long pending;
+} shared_pool_t;
+
+/* Which pool a workload is running on (exactly one of these is non-NULL), and its results */
+typedef struct{
+    wpool_t *wpool;
+    shared_pool_t *shared;
+    atomic_long leaves;
+    atomic_long checksum;
+} work_ctx_t;
+
+/* spawn(): work context, value and value type parameters, no return value; submit more work to
+   whichever pool we're running on */
+static void spawn(work_ctx_t *ctx, value_t v, value_type_t t){
+    if(ctx->wpool != NULL){
+        wpool_submit(v, t, ctx->wpool);
+        return;
+    }
+    atomic_fetch_add(&ctx->shared->pending, 1);
+    pthread_mutex_lock(&ctx->shared->lock);
+    list_append(v, t, ctx->shared->l);
+    pthread_mutex_unlock(&ctx->shared->lock);
+}
+
+/* busy_work(): iteration count parameter, return a number that depends on every iteration, so the
+   compiler can't skip the loop */
+static long busy_work(int iterations){
+    unsigned int x = (unsigned int) iterations;
+    for(int i = 0; i < iterations; i++){
+        x = x * 1103515245u + 12345u;
+    }
+    return x & 0xff;
+}
+
+/* tree_task(): a value n above 1 spawns n-1 and n-2; 0 and 1 are leaves that do a little work */
+static void tree_task(value_t v, value_type_t t, wpool_t *p, void *arg){
+    (void) t;
+    (void) p;
+    work_ctx_t *ctx = arg;
+    if(v.ival < 2){
+        atomic_fetch_add_explicit(&ctx->checksum, busy_work(200), memory_order_relaxed);
+        atomic_fetch_add_explicit(&ctx->leaves, 1, memory_order_relaxed);
+        return;
+    }
+    value_t child;
+    child.ival = v.ival - 1;
+    spawn(ctx, child, VAL_INT);
+    child.ival = v.ival - 2;
+    spawn(ctx, child, VAL_INT);
+}
+
+/* uneven_task(): every 100th value is 400 times as much work as the others */
+static void uneven_task(value_t v, value_type_t t, wpool_t *p, void *arg){
+    (void) t;
+    (void) p;
+    work_ctx_t *ctx = arg;
+    int iterations = v.ival % 100 == 0 ? 200000 : 500;
+    atomic_fetch_add_explicit(&ctx->checksum, busy_work(iterations), memory_order_relaxed);
+    atomic_fetch_add_explicit(&ctx->leaves, 1, memory_order_relaxed);
+}
+
+#define TREE_ROOT 25            /* fib(26) = 121393 leaves */
+#define TREE_LEAVES 121393
+#define UNEVEN_VALUES 20000
+
+typedef struct{
+    const char *name;
+    wpool_fn fn;
+    long expected_leaves;
+} workload_t;
+
+static const workload_t workloads[] = {
+    { "tree",   tree_task,   TREE_LEAVES },
+    { "uneven", uneven_task, UNEVEN_VALUES },
+};
+
+/* submit_roots(): workload and context parameters, no return value; submit the starting values */
+static void submit_roots(const workload_t *w, work_ctx_t *ctx){
+    value_t v;
+    if(w->fn == tree_task){
+        v.ival = TREE_ROOT;
+        spawn(ctx, v, VAL_INT);
+        return;
+    }
+    for(int i = 0; i < UNEVEN_VALUES; i++){
+        v.ival = i;
+        spawn(ctx, v, VAL_INT);
+    }
+}
+
+/* imbalance(): per-thread counts and thread count parameters, return the busiest thread's count
+   divided by the average */
+static double imbalance(const long *ran, int threads){
+    long most = 0, total = 0;
+    for(int i = 0; i < threads; i++){
+        total += ran[i];
+        most = ran[i] > most ? ran[i] : most;
+    }
+    return total > 0 ? (double) most * threads / total : 0;
+}
+
+typedef struct{
+    const workload_t *w;
+    work_ctx_t *ctx;
+    long ran;
+} shared_arg_t;
+
+/* shared_worker(): arg * parameter, return NULL; take values off the shared list until nothing is
+   pending anywhere */
+static void *shared_worker(void *arg){
+    shared_arg_t *a = arg;
+    shared_pool_t *s = a->ctx->shared;
+    while(atomic_load(&s->pending) > 0){
+        value_t v;
+        value_type_t t = VAL_NONE;
+        pthread_mutex_lock(&s->lock);
+        if(list_size(s->l) > 0){
+            t = list_get_type(0, s->l);
+            v = list_pop(s->l);
+        }
+        pthread_mutex_unlock(&s->lock);
+        if(t == VAL_NONE){
+            sched_yield();
+            continue;
+        }
+        a->w->fn(v, t, NULL, a->ctx);
+        a->ran++;
+        atomic_fetch_sub(&s->pending, 1);
+    }
+    return NULL;
+}
+
+/* run_shared(): workload, thread count, and the results to fill in, return the time taken in ns */
+static double run_shared(const workload_t *w, int threads, work_ctx_t *ctx, double *balance){
+    shared_pool_t s;
+    s.l = list_new();
+    pthread_mutex_init(&s.lock, NULL);
+    atomic_init(&s.pending, 0);
+    ctx->wpool = NULL;
+    ctx->shared = &s;
+    shared_arg_t *args = malloc(threads * sizeof(shared_arg_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    long *ran = malloc(threads * sizeof(long));
+
+    double start = now_ns();
+    submit_roots(w, ctx);
+    for(int i = 0; i < threads; i++){
+        args[i] = (shared_arg_t){ w, ctx, 0 };
+        pthread_create(&tids[i], NULL, shared_worker, &args[i]);
+    }
+    for(int i = 0; i < threads; i++){
+        pthread_join(tids[i], NULL);
+        ran[i] = args[i].ran;
+    }
+    double ns = now_ns() - start;
+
+    *balance = imbalance(ran, threads);
+    list_free(s.l);
+    pthread_mutex_destroy(&s.lock);
+    free(args);
+    free(tids);
+    free(ran);
+    return ns;
+}
+
+/* run_wpool(): the same, on a wpool_t. Also reports how many values were stolen */
+static double run_wpool(const workload_t *w, int threads, work_ctx_t *ctx, double *balance,
+                        long *steals){
+    ctx->shared = NULL;
+    double start = now_ns();
+    ctx->wpool = wpool_new(threads, w->fn, ctx);
+    submit_roots(w, ctx);
+    wpool_wait(ctx->wpool);
+    double ns = now_ns() - start;
+
+    long *ran = malloc(threads * sizeof(long));
+    *steals = 0;
+    for(int i = 0; i < threads; i++){
+        ran[i] = atomic_load(&ctx->wpool->workers[i].ran);
+        *steals += atomic_load(&ctx->wpool->workers[i].stolen);
+    }
+    *balance = imbalance(ran, threads);
+    wpool_free(ctx->wpool);
+    free(ran);
+    return ns;
+}
+
+int main(int argc, char **argv){
+    int max_threads = argc > 1 ? atoi(argv[1]) : 8;
+    if(max_threads < 1){
+        max_threads = 1;
+    }
+
+    bool ok = true;
+    for(int threads = 2; threads <= (max_threads > 2 ? max_threads : 2); threads *= 2){
+        ok = stress(threads) && ok;
+    }
+
+    for(size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++){
+        const workload_t *w = &workloads[i];
+        printf("\n%-7s %7s %10s %9s %8s %10s %9s\n", w->name, "threads", "wpool ms", "balance",
+               "steals", "shared ms", "balance");
+        for(int threads = 1; threads <= max_threads; threads++){
+            work_ctx_t ctx;
+            double wp_balance, sh_balance;
+            long steals;
+
+            atomic_init(&ctx.leaves, 0);
+            atomic_init(&ctx.checksum, 0);
+            double wp_ns = run_wpool(w, threads, &ctx, &wp_balance, &steals);
+            bool wp_ok = atomic_load(&ctx.leaves) == w->expected_leaves;
+
+            atomic_init(&ctx.leaves, 0);
+            double sh_ns = run_shared(w, threads, &ctx, &sh_balance);
+            bool sh_ok = atomic_load(&ctx.leaves) == w->expected_leaves;
+
+            printf("%-7s %7d %10.2f %9.2f %8ld %10.2f %9.2f%s\n", "", threads, wp_ns / 1e6,
+                   wp_balance, steals, sh_ns / 1e6, sh_balance,
+                   wp_ok && sh_ok ? "" : "  !!! FAILED !!!");
+            ok = ok && wp_ok && sh_ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+/*
+ *  This file (clist.c) holds the concurrent list (clist_t) for the linked list demo.
+ *
+ *  The list looks just like a LIST_CHAIN list: a circular, doubly-linked list with a header node.
+ *  What's new is who is allowed to touch which pointers. The front end of the list is
+ *  header->next and the first node's prev; the back end is header->prev and the last node's
+ *  next. The front lock guards the first pair and the back lock guards the second, so as long as
+ *  the first and last nodes are far enough apart, a thread at the front and a thread at the back
+ *  can both work at the same time.
+ *
+ *  "Far enough apart" is decided with the atomic size:
+ *      - a push/append only touches the neighbouring node's prev/next, which is safe on its own
+ *        once the list has at least 2 values.
+ *      - a pop/remove_last also rewires the node behind the one it removes, so it needs at least
+ *        3 values. It claims its value by decreasing the size *before* unlinking (with a
+ *        compare-and-swap), so two threads at opposite ends can't both take the last few values.
+ *  When the list is smaller than that, the operation takes both locks (front first, then back,
+ *  always in that order so two threads can't wait on each other forever) and works exactly like
+ *  the single-threaded list.
+ *
+ *  Nodes are plain malloc'd node_t's. The node pool in linkedlist-ref.c isn't thread-safe, and
+ *  strings always get their own heap copy here (never the small_str buffer) so that a popped
+ *  string can be handed straight to the caller.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "clist.h"
+
+/* clist_new(): no parameters, return a pointer to a new concurrent list or NULL if space can't be
+   allocated */
+clist_t *clist_new(){
+    clist_t *l = malloc(sizeof(clist_t));
+    if(l == NULL){
+        return NULL;
+    }
+    l->header = malloc(sizeof(node_t));
+    if(l->header == NULL){
+        free(l);
+        return NULL;
+    }
+    l->header->next = l->header;
+    l->header->prev = l->header;
+    l->header->type = VAL_NONE;
+    atomic_init(&l->size, 0);
+    pthread_mutex_init(&l->head_lock, NULL);
+    pthread_mutex_init(&l->tail_lock, NULL);
+    return l;
+}
+
+/* clist_free(): clist * parameter, no return value; free all space used by this list. No other
+   thread may be using the list anymore */
+void clist_free(clist_t *l){
+    if(l == NULL){
+        return;
+    }
+    node_t *curr = l->header->next;
+    while(curr != l->header){
+        node_t *next = curr->next;
+        if(curr->type == VAL_STR){
+            free(curr->val.sval);
+        }
+        free(curr);
+        curr = next;
+    }
+    free(l->header);
+    pthread_mutex_destroy(&l->head_lock);
+    pthread_mutex_destroy(&l->tail_lock);
+    free(l);
+}
+
+/* clist_lock_both(): clist * parameter, no return value; take both locks, front first */
+static void clist_lock_both(clist_t *l){
+    pthread_mutex_lock(&l->head_lock);
+    pthread_mutex_lock(&l->tail_lock);
+}
+
+/* clist_unlock_both(): clist * parameter, no return value; let go of both locks */
+static void clist_unlock_both(clist_t *l){
+    pthread_mutex_unlock(&l->tail_lock);
+    pthread_mutex_unlock(&l->head_lock);
+}
+
+/* clist_make_node(): value and value type parameters, return a new unlinked node holding the
+   value (strings are copied), or NULL if space can't be allocated. No lock is needed for this,
+   so it happens before we take one */
+static node_t *clist_make_node(value_t v, value_type_t t){
+    node_t *n = malloc(sizeof(node_t));
+    if(n == NULL){
+        return NULL;
+    }
+    if(t == VAL_STR){
+        size_t len = strlen(v.sval) + 1;
+        char *copy = malloc(len);
+        if(copy == NULL){
+            free(n);
+            return NULL;
+        }
+        memcpy(copy, v.sval, len);
+        v.sval = copy;
+    }
+    n->val = v;
+    n->type = t;
+    return n;
+}
+
+/* clist_take_node(): node *, value * and value type * parameters, no return value; hand the
+   node's value to the caller and free the node (the string, if any, now belongs to the caller) */
+static void clist_take_node(node_t *n, value_t *v, value_type_t *t){
+    if(v != NULL){
+        *v = n->val;
+    }else if(n->type == VAL_STR){
+        free(n->val.sval);      /* nobody wants it */
+    }
+    if(t != NULL){
+        *t = n->type;
+    }
+    free(n);
+}
+
+/* clist_reserve(): clist * parameter, return true if we took one value off the size while it was
+   at least 3; otherwise leave the size alone and return false */
+static bool clist_reserve(clist_t *l){
+    int size = atomic_load(&l->size);
+    while(size >= 3){
+        /* if another thread changed the size in the meantime, 'size' is refreshed and we retry */
+        if(atomic_compare_exchange_weak(&l->size, &size, size - 1)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/* clist_push(): value, value type, and clist * parameters, return true if the value (strings are
+   copied) was added to the front of the list */
+bool clist_push(value_t v, value_type_t t, clist_t *l){
+    if(l == NULL){
+        return false;
+    }
+    node_t *new_node = clist_make_node(v, t);
+    if(new_node == NULL){
+        return false;
+    }
+
+    pthread_mutex_lock(&l->head_lock);
+    /* with fewer than 2 values the back end may be rewiring the node we'd link to, so wait for it
+       too. The size only grows after a node is fully linked, so it never overstates the list */
+    bool both = atomic_load(&l->size) < 2;
+    if(both){
+        pthread_mutex_lock(&l->tail_lock);
+    }
+    node_t *first = l->header->next;
+    new_node->prev = l->header;
+    new_node->next = first;
+    first->prev = new_node;
+    l->header->next = new_node;
+    atomic_fetch_add(&l->size, 1);
+    if(both){
+        pthread_mutex_unlock(&l->tail_lock);
+    }
+    pthread_mutex_unlock(&l->head_lock);
+    return true;
+}
+
+/* clist_append(): value, value type, and clist * parameters, return true if the value was added to
+   the end of the list */
+bool clist_append(value_t v, value_type_t t, clist_t *l){
+    if(l == NULL){
+        return false;
+    }
+    node_t *new_node = clist_make_node(v, t);
+    if(new_node == NULL){
+        return false;
+    }
+
+    /* the back end can't take its own lock before the front lock (see the top of the file), so
+       when the list is small we start over with both locks */
+    pthread_mutex_lock(&l->tail_lock);
+    bool both = atomic_load(&l->size) < 2;
+    if(both){
+        pthread_mutex_unlock(&l->tail_lock);
+        clist_lock_both(l);
+    }
+    node_t *last = l->header->prev;
+    new_node->next = l->header;
+    new_node->prev = last;
+    last->next = new_node;
+    l->header->prev = new_node;
+    atomic_fetch_add(&l->size, 1);
+    if(both){
+        clist_unlock_both(l);
+    }else{
+        pthread_mutex_unlock(&l->tail_lock);
+    }
+    return true;
+}
+
+/* clist_pop(): clist *, value * and value type * parameters, return false if the list was empty;
+   otherwise remove the front value and store it (and its type, if that pointer isn't NULL) */
+bool clist_pop(clist_t *l, value_t *v, value_type_t *t){
+    if(l == NULL){
+        return false;
+    }
+    pthread_mutex_lock(&l->head_lock);
+    bool both = !clist_reserve(l);
+    if(both){
+        pthread_mutex_lock(&l->tail_lock);
+        if(atomic_load(&l->size) == 0){
+            clist_unlock_both(l);
+            return false;
+        }
+        atomic_fetch_sub(&l->size, 1);
+    }
+    node_t *dead = l->header->next;
+    l->header->next = dead->next;
+    dead->next->prev = l->header;
+    if(both){
+        pthread_mutex_unlock(&l->tail_lock);
+    }
+    pthread_mutex_unlock(&l->head_lock);
+
+    clist_take_node(dead, v, t);
+    return true;
+}
+
+/* clist_remove_last(): the same as clist_pop, but from the end of the list */
+bool clist_remove_last(clist_t *l, value_t *v, value_type_t *t){
+    if(l == NULL){
+        return false;
+    }
+    pthread_mutex_lock(&l->tail_lock);
+    bool both = !clist_reserve(l);
+    if(both){
+        pthread_mutex_unlock(&l->tail_lock);
+        clist_lock_both(l);
+        if(atomic_load(&l->size) == 0){
+            clist_unlock_both(l);
+            return false;
+        }
+        atomic_fetch_sub(&l->size, 1);
+    }
+    node_t *dead = l->header->prev;
+    l->header->prev = dead->prev;
+    dead->prev->next = l->header;
+    if(both){
+        clist_unlock_both(l);
+    }else{
+        pthread_mutex_unlock(&l->tail_lock);
+    }
+
+    clist_take_node(dead, v, t);
+    return true;
+}
+
+/* clist_size(): clist * parameter, return its size (which other threads may change right away) */
+int clist_size(clist_t *l){
+    if(l == NULL){
+        return 0;
+    }
+    return atomic_load(&l->size);
+}
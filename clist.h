@@ -0,0 +1,64 @@
+/*
+ *  This file (clist.h) is the header file for the concurrent version of the linked list demo.
+ *
+ *  A clist_t can be shared by several threads without any locking on the caller's side. It has
+ *  one lock for the front and one for the back, so a thread using list_push/list_pop-style calls
+ *  on the front doesn't wait for a thread using list_append/list_remove_last on the back. Only
+ *  when the list is nearly empty (and both ends are touching the same few nodes) does an
+ *  operation take both locks.
+ *
+ *  Contents:
+ *      - clist_t struct
+ *      - function prototypes for concurrent lists
+ *
+ */
+
+#ifndef CLIST_H
+#define CLIST_H
+
+#include <pthread.h>        /* POSIX threads: mutexes live here */
+#include <stdatomic.h>      /* C11 atomics, for the size */
+
+#include "list.h"
+
+/* DEFINITION OF CLIST_T STRUCT */
+/* The nodes are ordinary node_t's in a circular list with a header, like list_t. 'size' is
+   atomic so both ends can update it without sharing a lock */
+typedef struct{
+    node_t *header;
+    atomic_int size;
+    pthread_mutex_t head_lock;  /* guards header->next and the first node's prev */
+    pthread_mutex_t tail_lock;  /* guards header->prev and the last node's next */
+} clist_t;
+
+/* FUNCTION PROTOTYPES FOR CONCURRENT LISTS */
+
+/* clist_new(): no parameters, return a pointer to a new concurrent list or NULL if space can't be
+   allocated */
+clist_t *clist_new();
+
+/* clist_free(): clist * parameter, no return value; free all space used by this list. No other
+   thread may be using the list anymore */
+void clist_free(clist_t *);
+
+/* clist_push(): value, value type, and clist * parameters, return true if the value (strings are
+   copied) was added to the front of the list */
+bool clist_push(value_t, value_type_t, clist_t *);
+
+/* clist_append(): value, value type, and clist * parameters, return true if the value was added to
+   the end of the list */
+bool clist_append(value_t, value_type_t, clist_t *);
+
+/* clist_pop(): clist *, value * and value type * parameters, return false if the list was empty;
+   otherwise remove the front value and store it (and its type, if that pointer isn't NULL).
+   Another thread could empty the list at any moment, which is why this reports emptiness itself
+   instead of leaving it to a separate size check. A string belongs to the caller afterwards */
+bool clist_pop(clist_t *, value_t *, value_type_t *);
+
+/* clist_remove_last(): the same as clist_pop, but from the end of the list */
+bool clist_remove_last(clist_t *, value_t *, value_type_t *);
+
+/* clist_size(): clist * parameter, return its size (which other threads may change right away) */
+int clist_size(clist_t *);
+
+#endif /* CLIST_H */
@@ -0,0 +1,277 @@
+/*
+ *  This file (lfqueue.c) holds the lock-free queue (lfqueue_t) for the linked list demo.
+ *
+ *  It's the classic Michael & Scott queue: a singly-linked list with a dummy node at the front.
+ *      - Enqueueing links a new node after the last one with a compare-and-swap ("CAS": set this
+ *        pointer to X, but only if it still holds Y) on the last node's next, and then swings
+ *        'tail' forward.
+ *      - Dequeueing swings 'head' from the dummy to the node after it, which becomes the new
+ *        dummy, and hands out that node's value.
+ *  If a thread finds 'tail' lagging behind (another thread linked a node but hasn't moved 'tail'
+ *  yet), it moves 'tail' on its behalf instead of waiting, so no thread can hold up the others.
+ *
+ *  The hard part in C is freeing the old dummy: another thread may have read 'head' a moment ago
+ *  and be about to read the node's next. Hazard pointers (see lfqueue.h) fix that: a thread
+ *  announces which node it is about to use, double-checks the node is still in the queue, and
+ *  removed nodes are only freed once nobody has announced them.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>      /* sched_yield() */
+
+#include "lfqueue.h"
+
+/* the record this thread used last time, tried first next time. An index (rather than a pointer)
+   stays harmless if the queue it was used with is long gone */
+static _Thread_local int lfq_hint = 0;
+
+/* lfq_new(): no parameters, return a pointer to a new empty queue or NULL if space can't be
+   allocated */
+lfqueue_t *lfq_new(){
+    lfqueue_t *q = aligned_alloc(64, sizeof(lfqueue_t));
+    if(q == NULL){
+        return NULL;
+    }
+    lfq_node_t *dummy = malloc(sizeof(lfq_node_t));
+    if(dummy == NULL){
+        free(q);
+        return NULL;
+    }
+    atomic_init(&dummy->next, NULL);
+    dummy->type = VAL_NONE;
+    atomic_init(&q->head, dummy);
+    atomic_init(&q->tail, dummy);
+    atomic_init(&q->hazards_used, 0);
+    for(int i = 0; i < LFQ_MAX_THREADS; i++){
+        atomic_init(&q->hazards[i].busy, false);
+        atomic_init(&q->hazards[i].hp[0], NULL);
+        atomic_init(&q->hazards[i].hp[1], NULL);
+        q->hazards[i].retired = NULL;
+        q->hazards[i].retired_count = 0;
+    }
+    return q;
+}
+
+/* lfq_free(): lfqueue * parameter, no return value; free the queue and everything still in it */
+void lfq_free(lfqueue_t *q){
+    if(q == NULL){
+        return;
+    }
+    /* the dummy's value was handed out already; every node after it still owns its string */
+    lfq_node_t *curr = atomic_load(&q->head);
+    lfq_node_t *next = atomic_load(&curr->next);
+    free(curr);
+    for(curr = next; curr != NULL; curr = next){
+        next = atomic_load(&curr->next);
+        if(curr->type == VAL_STR){
+            free(curr->val.sval);
+        }
+        free(curr);
+    }
+    /* retired nodes were all dummies at some point, so none of them own a string */
+    for(int i = 0; i < LFQ_MAX_THREADS; i++){
+        curr = q->hazards[i].retired;
+        while(curr != NULL){
+            next = curr->retired_next;
+            free(curr);
+            curr = next;
+        }
+    }
+    free(q);
+}
+
+/* HAZARD POINTERS */
+
+/* lfq_claim(): lfqueue * parameter, return a hazard record that now belongs to this thread until
+   lfq_release() */
+static lfq_hazard_t *lfq_claim(lfqueue_t *q){
+    int i = lfq_hint;
+    for(;;){
+        for(int tries = 0; tries < LFQ_MAX_THREADS; tries++){
+            lfq_hazard_t *h = &q->hazards[i];
+            bool expected = false;
+            if(!atomic_load_explicit(&h->busy, memory_order_relaxed)
+                    && atomic_compare_exchange_strong(&h->busy, &expected, true)){
+                lfq_hint = i;
+                /* make sure lfq_scan() looks at this record from now on */
+                int used = atomic_load(&q->hazards_used);
+                while(used <= i && !atomic_compare_exchange_weak(&q->hazards_used, &used, i + 1)){
+                }
+                return h;
+            }
+            i = (i + 1) % LFQ_MAX_THREADS;
+        }
+        sched_yield();      /* every record is busy: let someone finish */
+    }
+}
+
+/* lfq_release(): hazard * parameter, no return value; clear the hazard pointers and give the
+   record back (its retired nodes stay with it for whoever claims it next) */
+static void lfq_release(lfq_hazard_t *h){
+    atomic_store(&h->hp[0], NULL);
+    atomic_store(&h->hp[1], NULL);
+    atomic_store_explicit(&h->busy, false, memory_order_release);
+}
+
+/* lfq_protect(): hazard *, slot and source parameters, return the node the source points at, once
+   it is announced in hazard slot 'slot' and the source still points at it */
+static lfq_node_t *lfq_protect(lfq_hazard_t *h, int slot, _Atomic(lfq_node_t *) *src){
+    lfq_node_t *n = atomic_load(src);
+    for(;;){
+        atomic_store(&h->hp[slot], n);
+        lfq_node_t *again = atomic_load(src);
+        if(again == n){
+            return n;
+        }
+        n = again;
+    }
+}
+
+/* lfq_scan(): lfqueue * and hazard * parameters, no return value; free every node on this
+   record's retired list that no thread has announced */
+static void lfq_scan(lfqueue_t *q, lfq_hazard_t *h){
+    lfq_node_t *announced[2 * LFQ_MAX_THREADS];
+    int count = 0;
+    int used = atomic_load(&q->hazards_used);
+    for(int i = 0; i < used; i++){
+        for(int s = 0; s < 2; s++){
+            lfq_node_t *n = atomic_load(&q->hazards[i].hp[s]);
+            if(n != NULL){
+                announced[count++] = n;
+            }
+        }
+    }
+
+    lfq_node_t *keep = NULL;
+    int kept = 0;
+    lfq_node_t *curr = h->retired;
+    while(curr != NULL){
+        lfq_node_t *next = curr->retired_next;
+        bool in_use = false;
+        for(int i = 0; i < count && !in_use; i++){
+            in_use = announced[i] == curr;
+        }
+        if(in_use){
+            curr->retired_next = keep;
+            keep = curr;
+            kept++;
+        }else{
+            free(curr);
+        }
+        curr = next;
+    }
+    h->retired = keep;
+    h->retired_count = kept;
+}
+
+/* lfq_retire(): lfqueue *, hazard * and node * parameters, no return value; free the node once it's
+   safe. Scanning waits until the list is a few times longer than the number of hazard pointers,
+   so each scan frees most of what it looks at */
+static void lfq_retire(lfqueue_t *q, lfq_hazard_t *h, lfq_node_t *n){
+    n->retired_next = h->retired;
+    h->retired = n;
+    h->retired_count++;
+    int threshold = 4 * atomic_load(&q->hazards_used);
+    if(h->retired_count >= (threshold > 32 ? threshold : 32)){
+        lfq_scan(q, h);
+    }
+}
+
+/* QUEUE OPERATIONS */
+
+/* lfq_enqueue(): value, value type, and lfqueue * parameters, return true if the value (strings are
+   copied) was added to the back of the queue */
+bool lfq_enqueue(value_t v, value_type_t t, lfqueue_t *q){
+    if(q == NULL){
+        return false;
+    }
+    lfq_node_t *new_node = malloc(sizeof(lfq_node_t));
+    if(new_node == NULL){
+        return false;
+    }
+    if(t == VAL_STR){
+        size_t len = strlen(v.sval) + 1;
+        char *copy = malloc(len);
+        if(copy == NULL){
+            free(new_node);
+            return false;
+        }
+        memcpy(copy, v.sval, len);
+        v.sval = copy;
+    }
+    atomic_init(&new_node->next, NULL);
+    new_node->val = v;
+    new_node->type = t;
+
+    lfq_hazard_t *h = lfq_claim(q);
+    for(;;){
+        lfq_node_t *last = lfq_protect(h, 0, &q->tail);
+        lfq_node_t *next = atomic_load(&last->next);
+        if(next != NULL){
+            /* 'tail' is behind: help move it along, then try again */
+            atomic_compare_exchange_strong(&q->tail, &last, next);
+            continue;
+        }
+        lfq_node_t *expected = NULL;
+        if(atomic_compare_exchange_strong(&last->next, &expected, new_node)){
+            /* if this fails, somebody already moved 'tail' for us */
+            atomic_compare_exchange_strong(&q->tail, &last, new_node);
+            break;
+        }
+    }
+    lfq_release(h);
+    return true;
+}
+
+/* lfq_dequeue(): lfqueue *, value * and value type * parameters, return false if the queue was
+   empty; otherwise take the value at the front and store it (and its type, if that pointer isn't
+   NULL) */
+bool lfq_dequeue(lfqueue_t *q, value_t *v, value_type_t *t){
+    if(q == NULL){
+        return false;
+    }
+    lfq_hazard_t *h = lfq_claim(q);
+    lfq_node_t *dummy;
+    value_t val;
+    value_type_t type;
+    for(;;){
+        dummy = lfq_protect(h, 0, &q->head);
+        lfq_node_t *next = lfq_protect(h, 1, &dummy->next);
+        if(atomic_load(&q->head) != dummy){
+            continue;       /* 'dummy' was dequeued under us, and its next may be stale */
+        }
+        if(next == NULL){
+            lfq_release(h);
+            return false;
+        }
+        lfq_node_t *last = atomic_load(&q->tail);
+        if(last == dummy){
+            /* 'tail' is still on the node we're about to remove: move it first */
+            atomic_compare_exchange_strong(&q->tail, &last, next);
+            continue;
+        }
+        /* read the value before the CAS, like the original algorithm does. Several threads may
+           read it, but only the one whose CAS succeeds gets to use it (and its string) */
+        val = next->val;
+        type = next->type;
+        if(atomic_compare_exchange_strong(&q->head, &dummy, next)){
+            break;
+        }
+    }
+    atomic_store(&h->hp[1], NULL);
+    atomic_store(&h->hp[0], NULL);
+    lfq_retire(q, h, dummy);
+    lfq_release(h);
+
+    if(v != NULL){
+        *v = val;
+    }else if(type == VAL_STR){
+        free(val.sval);
+    }
+    if(t != NULL){
+        *t = type;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+/*
+ *  This file (lfqueue.h) is the header file for the lock-free queue in the linked list demo.
+ *
+ *  An lfqueue_t is a first-in-first-out queue (think list_append plus list_pop) that any number
+ *  of threads can add to and take from at once, without ever taking a lock. It holds the same
+ *  tagged values as list_t.
+ *
+ *  Contents:
+ *      - lfq_node_t, lfq_hazard_t and lfqueue_t structs
+ *      - function prototypes for lock-free queues
+ *
+ */
+
+#ifndef LFQUEUE_H
+#define LFQUEUE_H
+
+#include <stdatomic.h>      /* C11 atomics */
+
+#include "list.h"
+
+/* DEFINITION OF LFQ_NODE_T STRUCT */
+/* A queue node is like a node_t with only a next pointer, which threads read and swing with
+   atomic operations. 'retired_next' links nodes that are waiting to be freed (see below) */
+typedef struct LFQ_NODE{
+    _Atomic(struct LFQ_NODE *) next;
+    value_t val;
+    value_type_t type;
+    struct LFQ_NODE *retired_next;
+} lfq_node_t;
+
+/* The most threads that can be inside an lfqueue function at the same moment. Any more simply
+   wait their turn */
+#define LFQ_MAX_THREADS 128
+
+/* DEFINITION OF LFQ_HAZARD_T STRUCT */
+/* A thread can't free a node it took off the queue right away, because another thread may still
+   be looking at it. Instead, a thread inside a queue function claims one of these records and
+   writes the (up to two) nodes it is looking at into 'hp' ("hazard pointers"). Removed nodes
+   go onto the record's retired list, and are only freed once no record's hazard pointers name
+   them. The alignment keeps each record on its own cache line */
+typedef struct{
+    _Alignas(64) atomic_bool busy;
+    _Atomic(lfq_node_t *) hp[2];
+    lfq_node_t *retired;
+    int retired_count;
+} lfq_hazard_t;
+
+/* DEFINITION OF LFQUEUE_T STRUCT */
+/* Like list_t there's always one extra node: 'head' points at an already-used 'dummy' node whose
+   next is the first real value, and 'tail' points at (or just behind) the last node */
+typedef struct{
+    _Alignas(64) _Atomic(lfq_node_t *) head;
+    _Alignas(64) _Atomic(lfq_node_t *) tail;
+    _Alignas(64) atomic_int hazards_used;   /* records at or above this index were never used */
+    lfq_hazard_t hazards[LFQ_MAX_THREADS];
+} lfqueue_t;
+
+/* FUNCTION PROTOTYPES FOR LOCK-FREE QUEUES */
+
+/* lfq_new(): no parameters, return a pointer to a new empty queue or NULL if space can't be
+   allocated */
+lfqueue_t *lfq_new();
+
+/* lfq_free(): lfqueue * parameter, no return value; free the queue and everything still in it. No
+   other thread may be using the queue anymore */
+void lfq_free(lfqueue_t *);
+
+/* lfq_enqueue(): value, value type, and lfqueue * parameters, return true if the value (strings are
+   copied) was added to the back of the queue */
+bool lfq_enqueue(value_t, value_type_t, lfqueue_t *);
+
+/* lfq_dequeue(): lfqueue *, value * and value type * parameters, return false if the queue was
+   empty; otherwise take the value at the front and store it (and its type, if that pointer isn't
+   NULL). A string belongs to the caller afterwards */
+bool lfq_dequeue(lfqueue_t *, value_t *, value_type_t *);
+
+#endif /* LFQUEUE_H */
@@ -16,8 +16,12 @@
 #include <stdlib.h>     /* standard library */
 #include <stdio.h>      /* standard input/output library */
 #include <string.h>     /* standard string library */
+#include <ctype.h>      /* toupper(), for one of the demo's callbacks */
+#include <limits.h>     /* INT_MAX, the most values a list can hold */
+#include <unistd.h>     /* close() and unlink(), for the list_save() test's file */
 
 #include "list.h"       /* we also need to include our header file! this includes stdbool for us */
+#include "list-internal.h"  /* the other list modes, which live in their own files */
 
 #define DEBUG_MODE 1    /* we will use #define to declare this constant ahead of time */
 
@@ -27,48 +31,544 @@
    meant, and it would be mad at you. */
 void demo_log(const char *);
 
-/* list_new(): no parameters, return a pointer to a new list or NULL if space can't be allocated */
-list_t *list_new(){
-    list_t *l = malloc(sizeof(list_t));
+/* NODE POOL HELPERS */
+/* The pool hands out nodes from big blocks instead of one malloc per node. Blocks start small
+   and double in size (up to a limit) as the list grows, so a tiny list stays tiny and a huge
+   list only calls malloc a handful of times. */
+#define POOL_MIN_BLOCK 16
+#define POOL_MAX_BLOCK 4096
+
+/* pool_new(): arena * parameter, return a new empty pool used by one list, or NULL if space can't
+   be allocated. With an arena, the pool and all of its blocks come from there instead of malloc */
+static node_pool_t *pool_new(arena_t *arena){
+    node_pool_t *p = arena != NULL ? arena_alloc(sizeof(node_pool_t), arena)
+                                   : malloc(sizeof(node_pool_t));
+    if(p == NULL){
+        return NULL;
+    }
+    memset(p, 0, sizeof(node_pool_t));     /* sets every pointer to NULL and every count to 0 */
+    p->refs = 1;
+    p->arena = arena;
+    return p;
+}
+
+/* pool_add_block(): pool * and node count parameters, return true if a block with room for that
+   many nodes was added to the front of the pool's block list */
+static bool pool_add_block(node_pool_t *p, size_t capacity){
+    size_t bytes = sizeof(node_block_t) + capacity * sizeof(node_t);
+    node_block_t *b = p->arena != NULL ? arena_alloc(bytes, p->arena) : malloc(bytes);
+    if(b == NULL){
+        return false;
+    }
+    LIST_STAT_ADD(p, allocs, p->arena == NULL);
+    b->capacity = capacity;
+    b->used = 0;
+    b->next = p->blocks;
+    if(p->blocks == NULL){
+        p->blocks_tail = b;
+    }
+    p->blocks = b;
+    return true;
+}
+
+/* pool_alloc(): pool * parameter, return a node for the list to use, or NULL if we're out of
+   memory. Recycled nodes come first, then unused room in the newest block, then a new block */
+static node_t *pool_alloc(node_pool_t *p){
+    if(p->free_nodes != NULL){
+        node_t *n = p->free_nodes;
+        p->free_nodes = n->next;
+        if(p->free_nodes == NULL){
+            p->free_tail = NULL;
+        }
+        return n;
+    }
+    if(p->blocks == NULL || p->blocks->used == p->blocks->capacity){
+        size_t capacity = p->blocks == NULL ? POOL_MIN_BLOCK : p->blocks->capacity * 2;
+        if(capacity > POOL_MAX_BLOCK){
+            capacity = POOL_MAX_BLOCK;
+        }
+        if(!pool_add_block(p, capacity)){
+            return NULL;
+        }
+    }
+    return &p->blocks->nodes[p->blocks->used++];
+}
+
+/* pool_release_run(): pool *, node * and node * parameters, no return value; put a run of nodes
+   that are already chained together through 'next' (first to last) on the free list at once */
+static void pool_release_run(node_pool_t *p, node_t *first, node_t *last){
+    last->next = p->free_nodes;
+    if(p->free_nodes == NULL){
+        p->free_tail = last;
+    }
+    p->free_nodes = first;
+}
+
+/* pool_release(): pool * and node * parameters, no return value; put the node on the free list
+   (we borrow its 'next' pointer for that, since the node isn't in the list anymore) */
+static void pool_release(node_pool_t *p, node_t *n){
+    pool_release_run(p, n, n);
+}
+
+/* pool_reserve(): pool * and node count parameters, return true if the next 'count' calls to
+   pool_alloc are sure not to need malloc. Whatever is left of the newest block goes onto the free
+   list first so it doesn't go to waste, then one block big enough for the rest is added */
+static bool pool_reserve(node_pool_t *p, size_t count){
+    size_t left = p->blocks == NULL ? 0 : p->blocks->capacity - p->blocks->used;
+    if(left >= count){
+        return true;
+    }
+    while(p->blocks != NULL && p->blocks->used < p->blocks->capacity){
+        pool_release(p, &p->blocks->nodes[p->blocks->used++]);
+    }
+    return pool_add_block(p, count - left);
+}
+
+/* pool_merge(): two pool * parameters, no return value; hand every block and free node of the
+   second pool to the first one, along with all of its users. The second pool stays behind as an
+   empty shell pointing at the first until its last user has moved over (see list_pool) */
+static void pool_merge(node_pool_t *into, node_pool_t *from){
+    if(from->blocks != NULL){
+        size_t room_into = into->blocks == NULL ? 0 : into->blocks->capacity - into->blocks->used;
+        size_t room_from = from->blocks->capacity - from->blocks->used;
+        if(into->blocks == NULL){
+            into->blocks = from->blocks;
+            into->blocks_tail = from->blocks_tail;
+        }else if(room_from > room_into){
+            /* pool_alloc only carves from the first block, so keep the roomier one in front */
+            from->blocks_tail->next = into->blocks;
+            into->blocks = from->blocks;
+        }else{
+            into->blocks_tail->next = from->blocks;
+            into->blocks_tail = from->blocks_tail;
+        }
+    }
+    if(from->free_nodes != NULL){
+        pool_release_run(into, from->free_nodes, from->free_tail);
+    }
+    LIST_STAT_ADD(into, allocs, from->stats.allocs);
+    into->refs += from->refs;
+    from->blocks = NULL;
+    from->blocks_tail = NULL;
+    from->free_nodes = NULL;
+    from->free_tail = NULL;
+    from->merged_into = into;
+}
+
+/* pool_destroy(): pool * parameter, no return value; free every block at once, and the pool
+   itself. Any node that came from this pool is gone after this, so only call it when the last
+   list using it is done for good */
+static void pool_destroy(node_pool_t *p){
+    if(p->arena != NULL){
+        return;     /* the arena gets it all back when it's rewound */
+    }
+    node_block_t *b = p->blocks;
+    while(b != NULL){
+        node_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(p);
+}
+
+/* list_pool(): list * parameter, return the pool the list's nodes come from. If that pool was
+   merged into another one, the list moves over to the new pool first (and the old shell is
+   freed once nobody points at it anymore) */
+static node_pool_t *list_pool(list_t *l){
+    while(l->pool->merged_into != NULL){
+        node_pool_t *old = l->pool;
+        l->pool = old->merged_into;
+        if(--old->refs == 0 && old->arena == NULL){
+            free(old);
+        }
+    }
+    return l->pool;
+}
+
+/* list_share_pool(): two list * parameters, no return value; make sure both lists use the same
+   pool, so nodes can move from one to the other */
+static void list_share_pool(list_t *a, list_t *b){
+    node_pool_t *pa = list_pool(a);
+    node_pool_t *pb = list_pool(b);
+    if(pa != pb){
+        pool_merge(pa, pb);
+        list_pool(b);
+    }
+}
+
+/* STRING HELPERS */
+
+/* list_copy_str(): list * and string parameters, return the list's own copy of the string: a
+   fresh malloc'd one, or with a string table, one more reference to the table's copy */
+char *list_copy_str(list_t *l, const char *s){
+    if(l->arena != NULL){
+        size_t len = strlen(s);
+        char *copy = arena_alloc(len + 1, l->arena);
+        if(copy != NULL){
+            memcpy(copy, s, len + 1);
+        }
+        return copy;
+    }
+    if(l->intern != NULL){
+        bool added;
+        char *copy = intern_acquire(s, l->intern, &added);
+        LIST_STAT_ADD(l, allocs, added);
+        return copy;
+    }
+    size_t len = strlen(s);
+    char *copy = malloc(len + 1);
+    if(copy == NULL){
+        return NULL;
+    }
+    memcpy(copy, s, len + 1);
+    LIST_STAT_ADD(l, allocs, 1);
+    return copy;
+}
+
+/* list_own_str(): list * and malloc'd string parameters, return the string the list keeps in its
+   place (see list-internal.h) */
+char *list_own_str(list_t *l, char *s){
+    if(l->intern == NULL && l->arena == NULL){
+        return s;
+    }
+    char *copy = list_copy_str(l, s);
+    if(copy != NULL){
+        free(s);
+    }
+    return copy;
+}
+
+/* list_export_str(): list * and string parameters, return a string the caller may keep and free
+   in place of one the list is giving up (see list-internal.h) */
+char *list_export_str(list_t *l, char *s){
+    if(l->intern == NULL && l->arena == NULL){
+        return s;
+    }
+    size_t len = strlen(s);
+    char *copy = malloc(len + 1);
+    if(copy == NULL){
+        return NULL;
+    }
+    memcpy(copy, s, len + 1);
+    LIST_STAT_ADD(l, allocs, 1);
+    if(l->intern != NULL){
+        intern_release(s, l->intern);
+    }
+    return copy;
+}
+
+/* list_free_str(): list * and string parameters, no return value; free one of the list's strings
+   (or with a string table, drop the list's reference to it). NULL is fine */
+void list_free_str(list_t *l, char *s){
+    if(s == NULL || l->arena != NULL){
+        return;
+    }
+    if(l->intern != NULL){
+        intern_release(s, l->intern);
+        return;
+    }
+    LIST_STAT_ADD(l, frees, 1);
+    free(s);
+}
+
+/* node_store_str(): list *, node * and string parameters, return true if the node now holds the
+   list's own copy of the string. Short strings are copied into the node itself, so they don't
+   need a malloc - unless the list has a string table, which holds every string */
+static bool node_store_str(list_t *l, node_t *n, const char *s){
+    size_t len = strlen(s);
+    if(len < LIST_SSO_SIZE && l->intern == NULL){
+        memcpy(n->small_str, s, len + 1);
+        n->val.sval = n->small_str;
+        return true;
+    }
+    n->val.sval = list_copy_str(l, s);
+    return n->val.sval != NULL;
+}
+
+/* node_str_is_small(): node * parameter, return true if the node's string lives inside it */
+static bool node_str_is_small(node_t *n){
+    return n->val.sval == n->small_str;
+}
+
+/* node_free_str(): list * and node * parameters, no return value; free the node's string if it
+   has its own buffer (strings stored inside the node go away with the node) */
+static void node_free_str(list_t *l, node_t *n){
+    if(n->type == VAL_STR && !node_str_is_small(n)){
+        list_free_str(l, n->val.sval);
+    }
+}
+
+/* list_park_str(): list * and string parameters, return the string after handing it to the list
+   to hold until the next removal. Whatever was parked before is freed */
+char *list_park_str(list_t *l, char *s){
+    list_free_str(l, l->popped_str);
+    l->popped_str = s;
+    return s;
+}
+
+/* list_take_str(): list * and node * parameters, return the node's string, now parked in the list
+   (see popped_str in list.h) so that it outlives the node. Whatever was parked before is freed */
+static char *list_take_str(list_t *l, node_t *n){
+    LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(n->val.sval) + 1));
+    if(node_str_is_small(n)){
+        list_park_str(l, NULL);
+        memcpy(l->popped_small, n->small_str, LIST_SSO_SIZE);
+        return l->popped_small;
+    }
+    /* no copy needed: the list just keeps the buffer instead of freeing it */
+    return list_park_str(l, n->val.sval);
+}
+
+/* list_unlink(): list *, node * and int parameters, no return value; take the node out of the list
+   and give it back to the pool. Anything the node owned (like a string) must be dealt with
+   first. This is also the one place that keeps list_get's cached position honest. The int is
+   the node's index, or -1 if the caller doesn't know it (it's only needed in the middle of a list
+   with a skip layer) */
+static void list_unlink(list_t *l, node_t *dead, int index){
+    if(index < 0 && dead == l->header->next){
+        index = 0;
+    }else if(index < 0 && dead == l->header->prev){
+        index = l->size - 1;
+    }
+    if(index >= 0){
+        skip_removed(l, dead, index);
+    }else{
+        skip_forget(l->skip);
+    }
+    if(l->cache_node == dead){
+        l->cache_node = NULL;
+    }else if(dead == l->header->next){
+        l->cache_index--;               /* every other node moved forward by one */
+    }else if(dead != l->header->prev){
+        l->cache_node = NULL;           /* we don't know which side of the cache it was on */
+    }
+    dead->prev->next = dead->next;
+    dead->next->prev = dead->prev;
+    pool_release(list_pool(l), dead);
+    l->size--;
+}
+
+/* list_release_nodes(): list * and two node * parameters, no return value; give a run of nodes
+   that are already unlinked and chained through 'next' back to the pool (list_filter in
+   list-parallel.c can't reach the pool functions itself) */
+void list_release_nodes(list_t *l, node_t *first, node_t *last){
+    pool_release_run(list_pool(l), first, last);
+}
+
+/* list_alloc(): list_mode_t and arena * parameters, return a new list structure (from the arena,
+   if there is one) with every field set to 'empty' (the mode's own setup is up to the caller), or
+   NULL if space can't be allocated */
+static list_t *list_alloc(list_mode_t mode, arena_t *arena){
+    list_t *l = arena != NULL ? arena_alloc(sizeof(list_t), arena) : malloc(sizeof(list_t));
+    if(l == NULL){
+        return NULL;
+    }
+    l->header = NULL;
+    l->size = 0;
+    l->pool = NULL;
+    l->cache_node = NULL;
+    l->cache_index = 0;
+    l->popped_str = NULL;
+    l->mode = mode;
+    l->uheader = NULL;
+    l->uspare = NULL;
+    l->ucache_node = NULL;
+    l->ucache_base = 0;
+    l->rvals = NULL;
+    l->rtags = NULL;
+    l->rhead = 0;
+    l->rcap = 0;
+    l->intern = NULL;
+    l->arena = arena;
+    l->index = NULL;
+    l->skip = NULL;
+#ifdef LIST_STATS
+    memset(&l->stats, 0, sizeof(l->stats));
+#endif
+    return l;
+}
+
+/* list_new_with_capacity(): int parameter, return a pointer to a new list that already has room
+   for that many nodes, or NULL if space can't be allocated */
+list_t *list_new_with_capacity(int capacity){
+    list_t *l = list_alloc(LIST_CHAIN, NULL);
     /* error check */
     if(l == NULL){
       return NULL;
     }
+    l->pool = pool_new(NULL);
+    /* reserve the nodes up front (plus one for the header) so pushes don't have to */
+    if(l->pool == NULL || (capacity > 0 && !pool_add_block(l->pool, (size_t) capacity + 1))){
+        free(l->pool);
+        free(l);
+        return NULL;
+    }
     /* now we need to actually set all of its fields */
-    l->header = malloc(sizeof(node_t));
+    l->header = pool_alloc(l->pool);
+    if(l->header == NULL){
+        pool_destroy(l->pool);
+        free(l);
+        return NULL;
+    }
+    l->header->prev = l->header;
+    l->header->val.sval = NULL;
+    l->header->type = VAL_NONE;
+    l->header->next = l->header;
+    return l;
+}
+
+/* list_new(): no parameters, return a pointer to a new list or NULL if space can't be allocated */
+list_t *list_new(){
+    return list_new_with_capacity(0);
+}
+
+/* list_new_mode(): list_mode_t parameter, return a pointer to a new list that stores its values
+   the given way, or NULL if space can't be allocated */
+list_t *list_new_mode(list_mode_t mode){
+    if(mode == LIST_CHAIN){
+        return list_new_with_capacity(0);
+    }
+    list_t *l = list_alloc(mode, NULL);
+    if(l == NULL){
+        return NULL;
+    }
+    bool ready = false;
+    if(mode == LIST_UNROLLED){
+        ready = ulist_init(l);
+    }else if(mode == LIST_RING){
+        ready = rlist_init(l);
+    }
+    if(!ready){
+        free(l);
+        return NULL;
+    }
+    return l;
+}
+
+/* list_new_in_arena(): arena * parameter, return a pointer to a new LIST_CHAIN list whose memory
+   all comes from the arena, or NULL if space can't be allocated. Whatever was allocated before a
+   failure just stays in the arena until it's rewound */
+list_t *list_new_in_arena(arena_t *arena){
+    if(arena == NULL){
+        return NULL;
+    }
+    list_t *l = list_alloc(LIST_CHAIN, arena);
+    if(l == NULL){
+        return NULL;
+    }
+    l->pool = pool_new(arena);
+    if(l->pool == NULL){
+        return NULL;
+    }
+    l->header = pool_alloc(l->pool);
+    if(l->header == NULL){
+        return NULL;
+    }
     l->header->prev = l->header;
     l->header->val.sval = NULL;
     l->header->type = VAL_NONE;
     l->header->next = l->header;
-    l->size = 0;
     return l;
 }
 
 /* list_free(): list * parameter, no return value; free all space used by this list */
 void list_free(list_t *l){
-    /* error check */
-    if(l == NULL){
+    /* error check; a list in an arena goes away with the arena instead, all at once */
+    if(l == NULL || l->arena != NULL){
+        return;
+    }
+    if(l->mode != LIST_CHAIN){
+        if(l->mode == LIST_UNROLLED){
+            ulist_free(l);
+        }else{
+            rlist_free(l);
+        }
+        list_free_str(l, l->popped_str);
+        intern_drop(l->intern);
+        free(l);
         return;
     }
-    /* Remember to free the whole structure and any members it has! */
-    node_t *node_to_free = NULL;
+    /* Remember to free the whole structure and any members it has! The nodes themselves all live
+       in the pool's blocks, so we only have to visit nodes that own a string */
     node_t *curr_node = l->header->next;
     while(curr_node != l->header){
-        node_to_free = curr_node;
+        node_free_str(l, curr_node);
         curr_node = curr_node->next;
-        if(curr_node->type == VAL_STR){
-            free(curr_node->val.sval);
-        }
-        free(node_to_free);
-        /* don't free prev or next nodes; if you free the prev and next node, you're
-           freeing up nodes from the list too early -- leave them be and come back
-           to free those nodes by iterating through the list. */
     }
-    /* Free the list structure's header and the structure itself */
-    free(l->header);
+    list_free_str(l, l->popped_str);
+    intern_drop(l->intern);
+    index_free(l->index);
+    skip_free(l->skip);
+    node_pool_t *p = list_pool(l);
+    if(--p->refs == 0){
+        /* Free every block (the header included) in one sweep */
+        pool_destroy(p);
+    }else{
+        /* other lists still use this pool, so our nodes (header included) just go back on its
+           free list - they're already chained together through 'next', header first */
+        pool_release_run(p, l->header, l->header->prev);
+    }
+    /* then the structure itself */
     free(l);
 }
 
+/* list_use_intern(): table * and list * parameters, return true if the list keeps its strings in
+   that table from now on (a private one of its own if the table is NULL). The list has to be
+   empty, so it doesn't hold any strings that were stored the old way */
+bool list_use_intern(list_intern_t *t, list_t *l){
+    if(l == NULL || l->size != 0 || l->arena != NULL){
+        return false;
+    }
+    if(t == NULL){
+        t = list_intern_new();      /* users starts at 1, which will be this list's */
+        if(t == NULL){
+            return false;
+        }
+    }else{
+        t->users++;
+    }
+    /* a string parked by the last pop was stored the old way too */
+    list_park_str(l, NULL);
+    intern_drop(l->intern);
+    l->intern = t;
+    return true;
+}
+
+/* list_use_index(): list * parameter, return true if the list keeps a hash index of its values.
+   The index starts out stale, so the first lookup builds it */
+bool list_use_index(list_t *l){
+    if(l == NULL || l->mode != LIST_CHAIN || l->arena != NULL){
+        return false;
+    }
+    if(l->index == NULL){
+        l->index = index_new();
+        if(l->index == NULL){
+            return false;
+        }
+    }
+    return true;
+}
+
+/* list_use_skip(): list * parameter, return true if the list keeps a skip layer, so list_get can
+   find any index in O(log n). It starts out stale, so the first long walk builds it */
+bool list_use_skip(list_t *l){
+    if(l == NULL || l->mode != LIST_CHAIN || l->arena != NULL){
+        return false;
+    }
+    if(l->skip == NULL){
+        l->skip = skip_new();
+        if(l->skip == NULL){
+            return false;
+        }
+    }
+    return true;
+}
+
+/* list_intern_of(): list * parameter, return the list's string table (NULL if it has none) */
+list_intern_t *list_intern_of(list_t *l){
+    return l != NULL ? l->intern : NULL;
+}
+
 /* list_push(): value, value type, and list * parameters, no return value; add the value to the
    front of the list */
 void list_push(value_t v, value_type_t t, list_t *l){
@@ -76,7 +576,15 @@ void list_push(value_t v, value_type_t t, list_t *l){
     if(l == NULL){
         return;
     }
-    node_t *new_node = malloc(sizeof(node_t));
+    if(l->mode == LIST_UNROLLED){
+        ulist_push(v, t, l);
+        return;
+    }
+    if(l->mode == LIST_RING){
+        rlist_insert_at(0, v, t, l);
+        return;
+    }
+    node_t *new_node = pool_alloc(list_pool(l));
     if(new_node == NULL){
         return;
     }
@@ -94,18 +602,17 @@ void list_push(value_t v, value_type_t t, list_t *l){
             break;
         case VAL_STR:
             /* we want a *copy* of this string, or else modifying the original modifies this
-               value */
-            new_node->val.sval = malloc(strlen(v.sval) + 1);
-            if(new_node->val.sval == NULL){
-                /* major issue! free and return early */
-                free(new_node);
+               value (short strings get copied into the node itself) */
+            if(!node_store_str(l, new_node, v.sval)){
+                /* major issue! give the node back and return early */
+                pool_release(list_pool(l), new_node);
                 return;
             }
-            strcpy(new_node->val.sval, v.sval); /* usage: strcpy(char *dest, const char *src) */
+            LIST_STAT_ADD(l, str_bytes, strlen(v.sval) + 1);
             break;
         default:
-            /* major issue! free and return early */
-            free(new_node);
+            /* major issue! give the node back and return early */
+            pool_release(list_pool(l), new_node);
             return;
     }
     new_node->type = t;
@@ -116,6 +623,10 @@ void list_push(value_t v, value_type_t t, list_t *l){
     new_node->prev = l->header;         /* new node's prev reference is to header */
     l->header->next = new_node;         /* header's next reference is to new node */
     l->size++;
+    LIST_STAT_GROW(l);
+    l->cache_index++;                   /* the cached node (if any) moved back by one */
+    index_add(l->index, new_node);
+    skip_inserted(l, new_node, 0);
 }
 
 /* list_append(): value, value type, and list * parameters, no return value; add the value to the
@@ -125,7 +636,15 @@ void list_append(value_t v, value_type_t t, list_t *l){
     if(l == NULL){
       return;
     }
-    node_t *new_node = malloc(sizeof(node_t));
+    if(l->mode == LIST_UNROLLED){
+        ulist_append(v, t, l);
+        return;
+    }
+    if(l->mode == LIST_RING){
+        rlist_insert_at(l->size, v, t, l);
+        return;
+    }
+    node_t *new_node = pool_alloc(list_pool(l));
     if(new_node == NULL){
       return;
     }
@@ -143,18 +662,17 @@ void list_append(value_t v, value_type_t t, list_t *l){
             break;
         case VAL_STR:
             /* we want a *copy* of this string, or else modifying the original modifies this
-               value */
-            new_node->val.sval = malloc(strlen(v.sval) + 1);
-            if(new_node->val.sval == NULL){
-                /* major issue! free and return early */
-                free(new_node);
+               value (short strings get copied into the node itself) */
+            if(!node_store_str(l, new_node, v.sval)){
+                /* major issue! give the node back and return early */
+                pool_release(list_pool(l), new_node);
                 return;
             }
-            strcpy(new_node->val.sval, v.sval); /* usage: strcpy(char *dest, const char *src) */
+            LIST_STAT_ADD(l, str_bytes, strlen(v.sval) + 1);
             break;
         default:
-            /* something went wrong; free and return early */
-            free(new_node);
+            /* something went wrong; give the node back and return early */
+            pool_release(list_pool(l), new_node);
             return;
     }
     new_node->type = t;
@@ -165,6 +683,9 @@ void list_append(value_t v, value_type_t t, list_t *l){
     new_node->next = l->header;         /* new node's next reference is to header */
     l->header->prev = new_node;         /* header's prev reference is to new node */
     l->size++;
+    LIST_STAT_GROW(l);
+    index_add(l->index, new_node);
+    skip_inserted(l, new_node, l->size - 1);
 }
 
 /* list_pop(): list * parameter, return the value from the front of the list and remove it */
@@ -175,6 +696,15 @@ value_t list_pop(list_t *l){
     if(l == NULL){
         return ret_val;
     }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_remove_first(l, false);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_remove_at(0, l, false);
+    }
+
+    /* the index has to find the node by its value, so it goes first */
+    index_remove(l->index, l->header->next);
 
     /* get the return value */
     value_type_t val_type = l->header->next->type;
@@ -189,32 +719,18 @@ value_t list_pop(list_t *l){
             ret_val.bval = l->header->next->val.bval;
             break;
         case VAL_STR:
-            /* We need a copy of the string to return since we're freeing the string -
-               if you free a pointer and return it, it points to unallocated memory. */
-            ret_val.sval = malloc(strlen(l->header->next->val.sval) + 1);
-            if(ret_val.sval == NULL){
-                /* major issue, return early (NULL) */
-                return ret_val;
-            }
-            strcpy(ret_val.sval, l->header->next->val.sval); /* strcpy as used above */
+            /* We can't return the node's string and then free it - if you free a pointer and
+               return it, it points to unallocated memory. The list holds on to it for us. */
+            ret_val.sval = list_take_str(l, l->header->next);
             break;
         default:
             /* something went wrong; return ret_val, which at this point should still be NULL */
             return ret_val;
     }
 
-    /* free and unlink front node */
-    node_t *dead = l->header->next;
-    l->header->next->next->prev = l->header;
-    l->header->next = l->header->next->next;
-    
-    /* account for strings */
-    if(dead->type == VAL_STR){
-        free(dead->val.sval);
-    }
-    
-    free(dead);
-    l->size--;
+    /* free and unlink front node (no string to free here: list_take_str already took it off
+       the node) */
+    list_unlink(l, l->header->next, 0);
 
     return ret_val;
 }
@@ -227,6 +743,14 @@ value_t list_remove_last(list_t *l){
     if(l == NULL){
         return ret_val;
     }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_remove_last(l, false);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_remove_at(l->size - 1, l, false);
+    }
+
+    index_remove(l->index, l->header->prev);
 
     /* get the return value */
     value_type_t val_type = l->header->prev->type;
@@ -241,120 +765,1109 @@ value_t list_remove_last(list_t *l){
             ret_val.bval = l->header->prev->val.bval;
             break;
         case VAL_STR:
-            ret_val.sval = malloc(strlen(l->header->next->val.sval) + 1);
-            if(ret_val.sval == NULL){
-                /* major issue, return early (NULL) */
-                return ret_val;
-            }
-            strcpy(ret_val.sval, l->header->next->val.sval); /* strcpy as used above */
+            ret_val.sval = list_take_str(l, l->header->prev);
             break;
         default:
             /* something went wrong; return ret_val, which at this point should still be NULL */
             return ret_val;
     }
 
-    /* free and unlink last node */
-    node_t *dead = l->header->prev;
-    l->header->prev->prev->next = l->header;
-    l->header->prev = l->header->prev->prev;
+    /* free and unlink last node (again, list_take_str already took care of any string) */
+    list_unlink(l, l->header->prev, l->size - 1);
 
-    /* account for strings */
-    if(dead->type == VAL_STR){
-        free(dead->val.sval);
+    return ret_val;
+}
+
+/* list_adopt_node(): string and list * parameters, return a node holding that string without
+   copying it (a list with a string table swaps it for the table's copy), or NULL if there's no
+   room for a node */
+static node_t *list_adopt_node(char *s, list_t *l){
+    node_t *new_node = pool_alloc(list_pool(l));
+    if(new_node == NULL){
+        return NULL;
+    }
+    s = list_own_str(l, s);
+    if(s == NULL){
+        pool_release(list_pool(l), new_node);
+        return NULL;
     }
+    new_node->val.sval = s;
+    new_node->type = VAL_STR;
+    LIST_STAT_ADD(l, str_bytes, strlen(s) + 1);
+    return new_node;
+}
 
-    free(dead);
-    l->size--;
+/* list_push_owned(): string and list * parameters, return true if the string was added to the
+   front of the list. The list takes the caller's malloc'd string as it is (no copy); on false,
+   the caller still owns it */
+bool list_push_owned(char *s, list_t *l){
+    if(l == NULL || s == NULL){
+        return false;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_push_owned(s, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_insert_owned(0, s, l);
+    }
+    node_t *new_node = list_adopt_node(s, l);
+    if(new_node == NULL){
+        return false;
+    }
+    l->header->next->prev = new_node;
+    new_node->next = l->header->next;
+    new_node->prev = l->header;
+    l->header->next = new_node;
+    l->size++;
+    LIST_STAT_GROW(l);
+    l->cache_index++;
+    index_add(l->index, new_node);
+    skip_inserted(l, new_node, 0);
+    return true;
+}
 
-    return ret_val;
+/* list_append_owned(): string and list * parameters, return true if the string was added to the
+   end of the list (same ownership rules as list_push_owned) */
+bool list_append_owned(char *s, list_t *l){
+    if(l == NULL || s == NULL){
+        return false;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_append_owned(s, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_insert_owned(l->size, s, l);
+    }
+    node_t *new_node = list_adopt_node(s, l);
+    if(new_node == NULL){
+        return false;
+    }
+    l->header->prev->next = new_node;
+    new_node->prev = l->header->prev;
+    new_node->next = l->header;
+    l->header->prev = new_node;
+    l->size++;
+    LIST_STAT_GROW(l);
+    index_add(l->index, new_node);
+    skip_inserted(l, new_node, l->size - 1);
+    return true;
 }
 
-/* list_size(): list * parameter, return its size */
-int list_size(list_t *l){
-    return l == NULL ? 0 : l->size;
+/* node_export_str(): list * and node * parameters, return the node's string in a form the caller
+   can keep and free, or NULL if space can't be allocated (the node keeps its string then). Only
+   a short string (which lives inside the node) or a string table's copy has to be copied */
+static char *node_export_str(list_t *l, node_t *n){
+    if(!node_str_is_small(n)){
+        return list_export_str(l, n->val.sval);
+    }
+    char *copy = malloc(strlen(n->small_str) + 1);
+    if(copy != NULL){
+        strcpy(copy, n->small_str);
+        LIST_STAT_ADD(l, allocs, 1);
+    }
+    return copy;
 }
 
-/* list_get(): int and list * parameters, returns the value at the given index */
-value_t list_get(int index, list_t *l){
-    /* error check (!l is another way of saying l == NULL) */
-    if( !l || index >= l->size){
-        value_t null_val;
-        null_val.sval = NULL;
-        return null_val;
+/* list_remove_owned(): list * and node * parameters, return the node's value and remove it. A
+   string is handed straight to the caller whenever it can be (see node_export_str) */
+static value_t list_remove_owned(list_t *l, node_t *n){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(n == l->header){
+        return ret_val;             /* the list is empty */
     }
-    int i = 0;
-    node_t *curr_node = l->header->next;
-    while(i < index){
-        curr_node = curr_node->next;
-        i++;
+    ret_val = n->val;
+    index_remove(l->index, n);
+    if(n->type == VAL_STR){
+        ret_val.sval = node_export_str(l, n);
+        if(ret_val.sval == NULL){
+            /* leave the node where it is so nothing is lost */
+            index_add(l->index, n);
+            return ret_val;
+        }
+        LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(ret_val.sval) + 1));
     }
-    return curr_node->val;
+    list_unlink(l, n, -1);
+    return ret_val;
 }
 
-/* list_get_type(): int and list * parameters, returns the value type at the given index */
-value_type_t list_get_type(int index, list_t *l){
-    /* error check */
-    if( !l || index >= l->size){
-        return VAL_NONE;
+/* list_pop_owned(): list * parameter, return the value from the front of the list and remove it;
+   a string now belongs to the caller, who has to free it */
+value_t list_pop_owned(list_t *l){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(l == NULL){
+        return ret_val;
     }
-    int i = 0;
-    node_t *curr_node = l->header->next;
-    while(i < index){
-        curr_node = curr_node->next;
-        i++;
+    if(l->mode == LIST_UNROLLED){
+        return ulist_remove_first(l, true);
     }
-    return curr_node->type;
+    if(l->mode == LIST_RING){
+        return rlist_remove_at(0, l, true);
+    }
+    return list_remove_owned(l, l->header->next);
 }
 
-/* list_print(): list * parameter, no return value; print the given list */
-void list_print(list_t *l){
-    if(DEBUG_MODE){
-        if(!l){
-            return;
-        }
-        printf("[");
-        node_t *curr_node = l->header->next;
-        while(curr_node != l->header){
-            switch(curr_node->type){
-                case VAL_CHAR:
-                    printf(" (char) %c ", curr_node->val.cval);
-                    break;
-                case VAL_INT:
-                    printf(" (int) %d ", curr_node->val.ival);
-                    break;
-                case VAL_BOOL:
-                    printf(" (bool) %d ", curr_node->val.bval);
-                    break;
-                case VAL_STR:
-                    printf(" (char *) %s ", curr_node->val.sval);
-                    break;
-                default:
-                    /* if we have any errors, we may as well see 'em in hex */
-                    printf(" (ERROR) %llx ", ((long long int) curr_node->val.sval));
+/* list_remove_last_owned(): list * parameter, return the value from the end of the list and
+   remove it; a string now belongs to the caller, who has to free it */
+value_t list_remove_last_owned(list_t *l){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(l == NULL){
+        return ret_val;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_remove_last(l, true);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_remove_at(l->size - 1, l, true);
+    }
+    return list_remove_owned(l, l->header->prev);
+}
+
+/* list_append_run(): list *, values, types (or one type for all), and count parameters, return
+   how many values were appended. The nodes are reserved in one go and linked to each other
+   first, so the list itself only gets relinked once at the end */
+static size_t list_append_run(list_t *l, const value_t *vals, const value_type_t *types,
+                              value_type_t type, size_t n){
+    if(l->mode == LIST_UNROLLED){
+        /* unrolled nodes already come 16 values at a time */
+        size_t before = l->size;
+        for(size_t i = 0; i < n; i++){
+            ulist_append(vals[i], types ? types[i] : type, l);
+            if((size_t) l->size != before + i + 1){
+                break;
             }
-            if(curr_node->next != l->header){
-                printf("|");
+        }
+        return l->size - before;
+    }
+    if(l->mode == LIST_RING){
+        /* make room for the whole run first, so the array grows (at most) once */
+        if(n > (size_t) (INT_MAX - l->size) || !rlist_reserve(l, (int) n)){
+            return 0;
+        }
+        size_t done = 0;
+        while(done < n && rlist_insert_at(l->size, vals[done], types ? types[done] : type, l)){
+            done++;
+        }
+        return done;
+    }
+    if(n == 0 || !pool_reserve(list_pool(l), n)){
+        return 0;
+    }
+    node_t *first = NULL;
+    node_t *last = NULL;
+    size_t done = 0;
+    while(done < n){
+        value_type_t t = types ? types[done] : type;
+        node_t *new_node = pool_alloc(list_pool(l));
+        new_node->type = t;
+        if(t == VAL_STR){
+            if(!node_store_str(l, new_node, vals[done].sval)){
+                pool_release(list_pool(l), new_node);
+                break;
             }
-            curr_node = curr_node->next;
+            LIST_STAT_ADD(l, str_bytes, strlen(vals[done].sval) + 1);
+        }else if(t == VAL_CHAR || t == VAL_INT || t == VAL_BOOL){
+            new_node->val = vals[done];
+        }else{
+            /* not a type we know; stop here like list_append would */
+            pool_release(list_pool(l), new_node);
+            break;
         }
-        printf("]\n");
+        /* link the new nodes to each other only */
+        new_node->prev = last;
+        if(last == NULL){
+            first = new_node;
+        }else{
+            last->next = new_node;
+        }
+        last = new_node;
+        index_add(l->index, new_node);
+        /* the skip layer doesn't look at the links, so the node can go in before they're done */
+        skip_inserted(l, new_node, l->size + (int) done);
+        done++;
+    }
+    if(done == 0){
+        return 0;
     }
+    /* now hook the whole run onto the back of the list at once */
+    first->prev = l->header->prev;
+    l->header->prev->next = first;
+    last->next = l->header;
+    l->header->prev = last;
+    l->size += done;
+    LIST_STAT_GROW(l);
+    return done;
 }
 
-/* demo_log(): for printing what's happening if DEBUG_MODE is on */
-void demo_log(const char *s){
-    if(DEBUG_MODE){
-        printf("%s", s);
+/* list_append_array(): values, types, count and list * parameters, return how many values were
+   appended (fewer than asked only if we ran out of memory or hit a bad type) */
+size_t list_append_array(const value_t *vals, const value_type_t *types, size_t n, list_t *l){
+    if(l == NULL || vals == NULL || types == NULL){
+        return 0;
     }
+    return list_append_run(l, vals, types, VAL_NONE, n);
 }
 
-/* this is similar to Java main: this is the actual function that executes */
-/* for our purposes, main will just execute a few tests */
-int main() {
-    printf("Starting linked list demo tests...\n");
+/* list_append_array_type(): values, one type, count and list * parameters; the same as above when
+   every value has the same type */
+size_t list_append_array_type(const value_t *vals, value_type_t type, size_t n, list_t *l){
+    if(l == NULL || vals == NULL){
+        return 0;
+    }
+    return list_append_run(l, vals, NULL, type, n);
+}
 
-    /* here are some dummy values we can use in our lists */
-    value_t val1, val2, val3, val4;
+/* list_take_run(): list *, which end, output arrays and count parameters, return how many values
+   were removed. The values go into the arrays in the order single pops would return them; the
+   removed nodes are unlinked and given back to the pool all at once */
+static size_t list_take_run(list_t *l, bool front, value_t *vals, value_type_t *types, size_t n){
+    if(n > (size_t) l->size){
+        n = l->size;
+    }
+    if(l->mode != LIST_CHAIN){
+        /* unrolled and ring lists take values off an end one at a time anyway */
+        for(size_t i = 0; i < n; i++){
+            if(types != NULL){
+                types[i] = list_get_type(front ? 0 : l->size - 1, l);
+            }
+            int before = l->size;
+            vals[i] = front ? list_pop_owned(l) : list_remove_last_owned(l);
+            if(l->size == before){
+                return i;       /* out of memory for a string; it stays in the list */
+            }
+        }
+        return n;
+    }
+    /* copy the values out, walking inwards from the chosen end */
+    node_t *curr_node = l->header;
+    size_t k = 0;
+    while(k < n){
+        curr_node = front ? curr_node->next : curr_node->prev;
+        vals[k] = curr_node->val;
+        index_remove(l->index, curr_node);
+        if(curr_node->type == VAL_STR){
+            vals[k].sval = node_export_str(l, curr_node);
+            if(vals[k].sval == NULL){
+                /* out of memory: stop before this node, so nothing is lost */
+                index_add(l->index, curr_node);
+                curr_node = front ? curr_node->prev : curr_node->next;
+                break;
+            }
+            LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(vals[k].sval) + 1));
+        }
+        if(types != NULL){
+            types[k] = curr_node->type;
+        }
+        skip_removed(l, curr_node, front ? 0 : l->size - 1 - (int) k);
+        k++;
+    }
+    if(k == 0){
+        return 0;
+    }
+    /* first..last is the run in list order */
+    node_t *first = front ? l->header->next : curr_node;
+    node_t *last = front ? curr_node : l->header->prev;
+    if(l->cache_node != NULL){
+        if(front){
+            if(l->cache_index < (int) k){
+                l->cache_node = NULL;
+            }else{
+                l->cache_index -= k;
+            }
+        }else if(l->cache_index >= l->size - (int) k){
+            l->cache_node = NULL;
+        }
+    }
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+    /* the run is still chained together through 'next', so it can join the free list whole */
+    pool_release_run(list_pool(l), first, last);
+    l->size -= k;
+    return k;
+}
+
+/* list_pop_n(): output arrays, count and list * parameters, return how many values were removed
+   from the front (up to n). Strings in the run belong to the caller afterwards */
+size_t list_pop_n(value_t *vals, value_type_t *types, size_t n, list_t *l){
+    if(l == NULL || vals == NULL){
+        return 0;
+    }
+    return list_take_run(l, true, vals, types, n);
+}
+
+/* list_remove_last_n(): the same as list_pop_n, but from the end of the list (so vals[0] is the
+   last value) */
+size_t list_remove_last_n(value_t *vals, value_type_t *types, size_t n, list_t *l){
+    if(l == NULL || vals == NULL){
+        return 0;
+    }
+    return list_take_run(l, false, vals, types, n);
+}
+
+/* list_size(): list * parameter, return its size */
+int list_size(list_t *l){
+    return l == NULL ? 0 : l->size;
+}
+
+/* list_node_at(): int and list * parameters, return the node at the given index (the index must
+   already be checked). We start from whichever is closest: the front, the back (the header's
+   prev is the last node, so that's free), or the node list_get found last time */
+static node_t *list_node_at(int index, list_t *l){
+    node_t *curr_node;
+    int i;
+    int from_back = l->size - 1 - index;
+    if(index <= from_back){
+        curr_node = l->header->next;
+        i = 0;
+    }else{
+        curr_node = l->header->prev;
+        i = l->size - 1;
+    }
+    if(l->cache_node != NULL && abs(index - l->cache_index) < abs(index - i)){
+        curr_node = l->cache_node;
+        i = l->cache_index;
+    }
+    /* a long walk can be cut short with the skip layer, if there is one */
+    node_t *skipped = skip_node_at(index, abs(index - i), l);
+    if(skipped != NULL){
+        l->cache_node = skipped;
+        l->cache_index = index;
+        return skipped;
+    }
+    LIST_STAT_ADD(l, traversed, abs(index - i));
+    while(i < index){
+        curr_node = curr_node->next;
+        i++;
+    }
+    while(i > index){
+        curr_node = curr_node->prev;
+        i--;
+    }
+    l->cache_node = curr_node;
+    l->cache_index = index;
+    return curr_node;
+}
+
+/* list_get(): int and list * parameters, returns the value at the given index */
+value_t list_get(int index, list_t *l){
+    /* error check (!l is another way of saying l == NULL) */
+    if( !l || index < 0 || index >= l->size){
+        value_t null_val;
+        null_val.sval = NULL;
+        return null_val;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_get(index, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_get(index, l);
+    }
+    return list_node_at(index, l)->val;
+}
+
+/* list_get_type(): int and list * parameters, returns the value type at the given index */
+value_type_t list_get_type(int index, list_t *l){
+    /* error check */
+    if( !l || index < 0 || index >= l->size){
+        return VAL_NONE;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_get_type(index, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_get_type(index, l);
+    }
+    return list_node_at(index, l)->type;
+}
+
+/* list_count_type(): value type and list * parameters, return how many values of that type the
+   list holds. Only the type tags get read, never the values */
+int list_count_type(value_type_t t, list_t *l){
+    if(!l){
+        return 0;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_count_type(t, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_count_type(t, l);
+    }
+    int found = 0;
+    for(node_t *curr_node = l->header->next; curr_node != l->header; curr_node = curr_node->next){
+        found += curr_node->type == t;
+    }
+    return found;
+}
+
+/* list_find_type(): value type, int and list * parameters, return the index of the first value of
+   that type at or after the given index, or -1 if there isn't one */
+int list_find_type(value_type_t t, int start, list_t *l){
+    if(!l || start >= l->size){
+        return -1;
+    }
+    if(start < 0){
+        start = 0;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_find_type(t, start, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_find_type(t, start, l);
+    }
+    int i = start;
+    for(node_t *curr_node = list_node_at(start, l); curr_node != l->header; curr_node = curr_node->next){
+        if(curr_node->type == t){
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+/* list_find_int(): int, int and list * parameters, return the index of the first VAL_INT equal to
+   x at or after the given index, or -1 if there isn't one. An unrolled list checks a whole node's
+   worth of values at a time (see list-simd.c); a chain has to look at them one by one */
+int list_find_int(int x, int start, list_t *l){
+    if(!l || start >= l->size){
+        return -1;
+    }
+    if(start < 0){
+        start = 0;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_find_int(x, start, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_find_int(x, start, l);
+    }
+    int i = start;
+    for(node_t *curr_node = list_node_at(start, l); curr_node != l->header; curr_node = curr_node->next){
+        if(curr_node->type == VAL_INT && curr_node->val.ival == x){
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+/* list_find_char(): char, int and list * parameters, return the index of the first VAL_CHAR equal
+   to c at or after the given index, or -1 if there isn't one */
+int list_find_char(char c, int start, list_t *l){
+    if(!l || start >= l->size){
+        return -1;
+    }
+    if(start < 0){
+        start = 0;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_find_char(c, start, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_find_char(c, start, l);
+    }
+    int i = start;
+    for(node_t *curr_node = list_node_at(start, l); curr_node != l->header; curr_node = curr_node->next){
+        if(curr_node->type == VAL_CHAR && curr_node->val.cval == c){
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
+/* list_find_node(): value, value type and list * parameters, return a node holding the value, or
+   NULL if there isn't one. The index is asked first; without one we walk the list */
+node_t *list_find_node(value_t v, value_type_t t, list_t *l){
+    if(!l || l->mode != LIST_CHAIN || (t == VAL_STR && v.sval == NULL)){
+        return NULL;
+    }
+    bool usable;
+    node_t *found = index_find(v, t, l, &usable);
+    if(usable){
+        return found;
+    }
+    for(node_t *curr_node = l->header->next; curr_node != l->header; curr_node = curr_node->next){
+        if(value_equal(curr_node->val, curr_node->type, v, t)){
+            return curr_node;
+        }
+    }
+    return NULL;
+}
+
+/* list_contains(): value, value type and list * parameters, return true if the value is in the
+   list */
+bool list_contains(value_t v, value_type_t t, list_t *l){
+    if(!l || l->size == 0 || (t == VAL_STR && v.sval == NULL)){
+        return false;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_contains(v, t, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_find_value(v, t, l) >= 0;
+    }
+    return list_find_node(v, t, l) != NULL;
+}
+
+/* list_remove_value(): value, value type and list * parameters, return true if one copy of the
+   value was found and removed. Nobody gets the value back, so a string is freed, not parked */
+bool list_remove_value(value_t v, value_type_t t, list_t *l){
+    if(l != NULL && l->mode == LIST_RING){
+        /* no nodes to find: find the value's index instead */
+        int index = (t == VAL_STR && v.sval == NULL) ? -1 : rlist_find_value(v, t, l);
+        if(index < 0){
+            return false;
+        }
+        rlist_discard_at(index, l);
+        return true;
+    }
+    node_t *dead = list_find_node(v, t, l);
+    if(dead == NULL){
+        return false;
+    }
+    index_remove(l->index, dead);
+    if(dead->type == VAL_STR){
+        LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(dead->val.sval) + 1));
+        node_free_str(l, dead);
+    }
+    list_unlink(l, dead, -1);
+    return true;
+}
+
+/* list_concat(): two list * parameters, return true if every value of src was moved to the end of
+   dst, leaving src empty. The two chains are joined with a few pointer swaps */
+bool list_concat(list_t *dst, list_t *src){
+    /* a string can only move to a list that frees it the same way */
+    if(dst == NULL || src == NULL || dst == src || dst->mode != src->mode ||
+       dst->intern != src->intern || dst->arena != src->arena){
+        return false;
+    }
+    if(src->size == 0){
+        return true;
+    }
+    if(dst->mode == LIST_UNROLLED){
+        ulist_concat(dst, src);
+        return true;
+    }
+    if(dst->mode == LIST_RING){
+        return rlist_concat(dst, src);
+    }
+    list_share_pool(dst, src);
+    node_t *first = src->header->next;
+    node_t *last = src->header->prev;
+    /* hook src's nodes onto the back of dst */
+    first->prev = dst->header->prev;
+    dst->header->prev->next = first;
+    last->next = dst->header;
+    dst->header->prev = last;
+    dst->size += src->size;
+    LIST_STAT_GROW(dst);
+    /* and leave src with just its header */
+    src->header->next = src->header;
+    src->header->prev = src->header;
+    src->size = 0;
+    src->cache_node = NULL;
+    index_forget(dst->index);
+    index_forget(src->index);
+    skip_forget(dst->skip);
+    skip_forget(src->skip);
+    return true;
+}
+
+/* list_splice(): list *, node *, list *, node * and node * parameters, return true if the nodes
+   from first to last (inclusive) were moved out of src and put right before pos in dst */
+bool list_splice(list_t *dst, node_t *pos, list_t *src, node_t *first, node_t *last){
+    if(dst == NULL || src == NULL || pos == NULL || first == NULL || last == NULL ||
+       dst->mode != LIST_CHAIN || src->mode != LIST_CHAIN || first == src->header ||
+       dst->intern != src->intern || dst->arena != src->arena){
+        return false;
+    }
+    /* count the run (we need to know how much the sizes change), making sure that 'last' really
+       comes after 'first' and that pos isn't inside the run */
+    int count = 1;
+    node_t *curr_node = first;
+    while(curr_node != last){
+        if(curr_node == pos){
+            return false;
+        }
+        curr_node = curr_node->next;
+        if(curr_node == src->header){
+            return false;
+        }
+        count++;
+    }
+    if(pos == last){
+        return false;
+    }
+    if(pos == last->next){
+        return true;    /* it's already right where it should be */
+    }
+    if(dst != src){
+        list_share_pool(dst, src);
+    }
+    /* unlink the run from src... */
+    first->prev->next = last->next;
+    last->next->prev = first->prev;
+    /* ...and link it in before pos */
+    first->prev = pos->prev;
+    pos->prev->next = first;
+    last->next = pos;
+    pos->prev = last;
+    src->size -= count;
+    dst->size += count;
+    LIST_STAT_GROW(dst);
+    /* we don't know where the cached positions ended up, so forget them */
+    src->cache_node = NULL;
+    dst->cache_node = NULL;
+    index_forget(src->index);
+    index_forget(dst->index);
+    skip_forget(src->skip);
+    skip_forget(dst->skip);
+    return true;
+}
+
+/* list_split_at(): int and list * parameters, return a new list holding every value from the
+   given index onward, moved out of l, or NULL on error */
+list_t *list_split_at(list_t *l, int index){
+    if(l == NULL || index < 0 || index > l->size){
+        return NULL;
+    }
+    list_t *tail = list_alloc(l->mode, l->arena);
+    if(tail == NULL){
+        return NULL;
+    }
+    /* the moved strings stay in l's string table, if it has one */
+    tail->intern = l->intern;
+    if(tail->intern != NULL){
+        tail->intern->users++;
+    }
+    if(l->mode != LIST_CHAIN){
+        bool unrolled = l->mode == LIST_UNROLLED;
+        if(unrolled ? !ulist_init(tail) : !rlist_init(tail)){
+            intern_drop(tail->intern);
+            free(tail);
+            return NULL;
+        }
+        if(unrolled ? !ulist_split(l, index, tail) : !rlist_split(l, index, tail)){
+            list_free(tail);
+            return NULL;
+        }
+        return tail;
+    }
+    /* the new list shares l's pool, since its nodes come from there */
+    tail->pool = list_pool(l);
+    tail->pool->refs++;
+    tail->header = pool_alloc(tail->pool);
+    if(tail->header == NULL){
+        tail->pool->refs--;
+        intern_drop(tail->intern);
+        if(tail->arena == NULL){
+            free(tail);
+        }
+        return NULL;
+    }
+    tail->header->val.sval = NULL;
+    tail->header->type = VAL_NONE;
+    tail->header->next = tail->header;
+    tail->header->prev = tail->header;
+    if(index == l->size){
+        return tail;
+    }
+    /* list_node_at starts from whichever end (or cached spot) is closest */
+    node_t *first = list_node_at(index, l);
+    node_t *last = l->header->prev;
+    first->prev->next = l->header;
+    l->header->prev = first->prev;
+    first->prev = tail->header;
+    tail->header->next = first;
+    last->next = tail->header;
+    tail->header->prev = last;
+    tail->size = l->size - index;
+    l->size = index;
+    LIST_STAT_GROW(tail);
+    if(l->cache_index >= index){
+        l->cache_node = NULL;
+    }
+    index_forget(l->index);
+    skip_forget(l->skip);
+    return tail;
+}
+
+/* list_stats(): list * parameter, return the list's counters (all zeros unless the list was
+   compiled with -DLIST_STATS) */
+list_stats_t list_stats(list_t *l){
+    list_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+#ifdef LIST_STATS
+    if(l != NULL){
+        stats = l->stats;
+        if(l->pool != NULL){
+            stats.allocs += list_pool(l)->stats.allocs;
+        }
+    }
+#else
+    (void) l;   /* this just tells the compiler we're ignoring l on purpose */
+#endif
+    return stats;
+}
+
+/* list_make_node(): value, value type, and list * parameters, return a new unlinked node holding
+   (a copy of) the value, or NULL if the type is bad or we're out of memory */
+static node_t *list_make_node(value_t v, value_type_t t, list_t *l){
+    node_t *new_node = pool_alloc(list_pool(l));
+    if(new_node == NULL){
+        return NULL;
+    }
+    switch(t){
+        case VAL_CHAR:
+        case VAL_INT:
+        case VAL_BOOL:
+            new_node->val = v;
+            break;
+        case VAL_STR:
+            if(!node_store_str(l, new_node, v.sval)){
+                pool_release(list_pool(l), new_node);
+                return NULL;
+            }
+            LIST_STAT_ADD(l, str_bytes, strlen(v.sval) + 1);
+            break;
+        default:
+            pool_release(list_pool(l), new_node);
+            return NULL;
+    }
+    new_node->type = t;
+    return new_node;
+}
+
+/* list_link_before(): list *, node *, node * and int parameters, no return value; link the new node
+   in right before pos (pos can be the header, which means 'at the end'). The int is the index the
+   new node ends up at, or -1 if the caller doesn't know it */
+static void list_link_before(list_t *l, node_t *pos, node_t *new_node, int index){
+    if(pos == l->header->next){
+        l->cache_index++;               /* a new first value: everything moves back by one */
+    }else if(pos != l->header){
+        l->cache_node = NULL;           /* somewhere in the middle; forget the cached spot */
+    }
+    new_node->prev = pos->prev;
+    new_node->next = pos;
+    pos->prev->next = new_node;
+    pos->prev = new_node;
+    l->size++;
+    LIST_STAT_GROW(l);
+    index_add(l->index, new_node);
+    if(index < 0 && new_node == l->header->next){
+        index = 0;
+    }else if(index < 0 && new_node == l->header->prev){
+        index = l->size - 1;
+    }
+    if(index >= 0){
+        skip_inserted(l, new_node, index);
+    }else{
+        skip_forget(l->skip);
+    }
+}
+
+/* list_insert_at(): int, value, value type and list * parameters, return true if the value was
+   added at that index. The node that's there now is found with list_node_at (so through the skip
+   layer, if the list has one), and the new one goes right before it */
+bool list_insert_at(int index, value_t v, value_type_t t, list_t *l){
+    if(l == NULL || index < 0 || index > l->size){
+        return false;
+    }
+    if(l->mode == LIST_RING){
+        return rlist_insert_at(index, v, t, l);
+    }
+    int before = l->size;
+    if(index == 0 || index == l->size){
+        if(index == 0){
+            list_push(v, t, l);
+        }else{
+            list_append(v, t, l);
+        }
+        return l->size != before;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return false;
+    }
+    node_t *new_node = list_make_node(v, t, l);
+    if(new_node == NULL){
+        return false;
+    }
+    list_link_before(l, list_node_at(index, l), new_node, index);
+    return true;
+}
+
+/* list_remove_at(): int and list * parameters, return the value at that index and remove it, the
+   way list_pop would */
+value_t list_remove_at(int index, list_t *l){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(l == NULL || index < 0 || index >= l->size){
+        return ret_val;
+    }
+    if(l->mode == LIST_RING){
+        return rlist_remove_at(index, l, false);
+    }
+    if(index == 0){
+        return list_pop(l);
+    }
+    if(index == l->size - 1){
+        return list_remove_last(l);
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ret_val;
+    }
+    node_t *dead = list_node_at(index, l);
+    index_remove(l->index, dead);
+    ret_val = dead->val;
+    if(dead->type == VAL_STR){
+        ret_val.sval = list_take_str(l, dead);
+    }
+    list_unlink(l, dead, index);
+    return ret_val;
+}
+
+/* A ring list's cursor has no node (it's NULL, just like the ignored cursor of an unrolled list),
+   only an index; cursor_on_ring tells the two apart */
+
+/* cursor_on_ring(): cursor * parameter, return true if it's a cursor into a ring list */
+static bool cursor_on_ring(list_cursor_t *c){
+    return c != NULL && c->node == NULL && c->list != NULL && c->list->mode == LIST_RING;
+}
+
+/* list_cursor_begin(): list * parameter, return a cursor on the first value */
+list_cursor_t list_cursor_begin(list_t *l){
+    list_cursor_t c;
+    c.list = l;
+    c.node = (l == NULL || l->mode != LIST_CHAIN) ? NULL : l->header->next;
+    c.index = 0;
+    return c;
+}
+
+/* list_cursor_at(): int and list * parameters, return a cursor on the value at the given index */
+list_cursor_t list_cursor_at(int index, list_t *l){
+    list_cursor_t c = list_cursor_begin(l);
+    if(c.node != NULL){
+        c.node = (index < 0 || index >= l->size) ? l->header : list_node_at(index, l);
+    }else if(cursor_on_ring(&c)){
+        c.index = (index < 0 || index >= l->size) ? l->size : index;
+    }
+    return c;
+}
+
+/* list_cursor_valid(): cursor * parameter, return true if the cursor is on a value */
+bool list_cursor_valid(list_cursor_t *c){
+    if(cursor_on_ring(c)){
+        return c->index < c->list->size;
+    }
+    return c != NULL && c->node != NULL && c->node != c->list->header;
+}
+
+/* list_cursor_next(): cursor * parameter, no return value; move to the next value */
+void list_cursor_next(list_cursor_t *c){
+    if(cursor_on_ring(c)){
+        c->index = c->index >= c->list->size ? 0 : c->index + 1;
+    }else if(c != NULL && c->node != NULL){
+        c->node = c->node->next;
+    }
+}
+
+/* list_cursor_prev(): cursor * parameter, no return value; move to the previous value */
+void list_cursor_prev(list_cursor_t *c){
+    if(cursor_on_ring(c)){
+        c->index = c->index == 0 ? c->list->size : c->index - 1;
+    }else if(c != NULL && c->node != NULL){
+        c->node = c->node->prev;
+    }
+}
+
+/* list_cursor_get(): cursor * parameter, return the value under the cursor */
+value_t list_cursor_get(list_cursor_t *c){
+    if(!list_cursor_valid(c)){
+        value_t null_val;
+        null_val.sval = NULL;
+        return null_val;
+    }
+    if(c->node == NULL){
+        return rlist_get(c->index, c->list);
+    }
+    return c->node->val;
+}
+
+/* list_cursor_type(): cursor * parameter, return the type of the value under the cursor */
+value_type_t list_cursor_type(list_cursor_t *c){
+    if(!list_cursor_valid(c)){
+        return VAL_NONE;
+    }
+    return c->node == NULL ? rlist_get_type(c->index, c->list) : (value_type_t) c->node->type;
+}
+
+/* list_cursor_insert_before(): cursor *, value and value type parameters, return true if the value
+   was added right before the cursor */
+bool list_cursor_insert_before(list_cursor_t *c, value_t v, value_type_t t){
+    if(cursor_on_ring(c)){
+        /* the cursor's value (or the end) moves up one index, and the cursor goes with it */
+        if(!rlist_insert_at(c->index, v, t, c->list)){
+            return false;
+        }
+        c->index++;
+        return true;
+    }
+    if(c == NULL || c->node == NULL){
+        return false;
+    }
+    node_t *new_node = list_make_node(v, t, c->list);
+    if(new_node == NULL){
+        return false;
+    }
+    list_link_before(c->list, c->node, new_node, -1);
+    return true;
+}
+
+/* list_cursor_insert_after(): cursor *, value and value type parameters, return true if the value
+   was added right after the cursor */
+bool list_cursor_insert_after(list_cursor_t *c, value_t v, value_type_t t){
+    if(cursor_on_ring(c)){
+        /* 'after the end' wraps around to the front, which moves everything (the end too) up */
+        bool past_end = c->index >= c->list->size;
+        if(!rlist_insert_at(past_end ? 0 : c->index + 1, v, t, c->list)){
+            return false;
+        }
+        c->index += past_end;
+        return true;
+    }
+    if(c == NULL || c->node == NULL){
+        return false;
+    }
+    node_t *new_node = list_make_node(v, t, c->list);
+    if(new_node == NULL){
+        return false;
+    }
+    list_link_before(c->list, c->node->next, new_node, -1);
+    return true;
+}
+
+/* list_cursor_erase(): cursor * parameter, return the value under the cursor and remove it */
+value_t list_cursor_erase(list_cursor_t *c){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(!list_cursor_valid(c)){
+        return ret_val;
+    }
+    if(c->node == NULL){
+        /* the next value moves down into the cursor's index, so the cursor stays put */
+        return rlist_remove_at(c->index, c->list, false);
+    }
+    node_t *dead = c->node;
+    ret_val = dead->val;
+    index_remove(c->list->index, dead);
+    if(dead->type == VAL_STR){
+        ret_val.sval = list_take_str(c->list, dead);
+    }
+    c->node = dead->next;
+    list_unlink(c->list, dead, -1);
+    return ret_val;
+}
+
+/* list_walk(): list *, callback and extra pointer parameters, no return value; call the callback
+   on every value from front to back, whatever the list's mode */
+void list_walk(list_t *l, void (*fn)(value_t, value_type_t, void *), void *arg){
+    if(l->mode == LIST_UNROLLED){
+        ulist_foreach(l, fn, arg);
+        return;
+    }
+    if(l->mode == LIST_RING){
+        rlist_foreach(l, fn, arg);
+        return;
+    }
+    for(node_t *curr_node = l->header->next; curr_node != l->header; curr_node = curr_node->next){
+        fn(curr_node->val, curr_node->type, arg);
+    }
+}
+
+/* list_print_sink(): text, length and FILE * parameters, return true if it was all written; hands
+   list_write's text to stdio */
+static bool list_print_sink(const char *s, size_t len, void *out){
+    return fwrite(s, 1, len, out) == len;
+}
+
+/* list_print(): list * parameter, no return value; print the given list. The text is made by
+   list_write (see list-format.c), a buffer-full at a time */
+void list_print(list_t *l){
+    if(DEBUG_MODE){
+        if(!l){
+            return;
+        }
+        list_write(list_print_sink, stdout, l);
+        putchar('\n');
+    }
+}
+
+/* demo_log(): for printing what's happening if DEBUG_MODE is on */
+void demo_log(const char *s){
+    if(DEBUG_MODE){
+        printf("%s", s);
+    }
+}
+
+/* The benchmark programs bring their own main, so they build this file with LIST_NO_DEMO */
+#ifndef LIST_NO_DEMO
+
+/* callbacks for the list_reduce/list_map_inplace/list_filter tests below */
+
+/* demo_sum(): adds an int (or a bool, as 0 or 1) to the running total */
+static value_t demo_sum(value_t total, value_t v, value_type_t t, void *arg){
+    (void) arg;
+    total.ival += t == VAL_BOOL ? v.bval : v.ival;
+    return total;
+}
+
+/* demo_add(): joins two running totals */
+static value_t demo_add(value_t a, value_t b, void *arg){
+    (void) arg;
+    a.ival += b.ival;
+    return a;
+}
+
+/* demo_double(): doubles an int, or capitalizes a string */
+static void demo_double(value_t *v, value_type_t t, void *arg){
+    (void) arg;
+    if(t == VAL_STR){
+        v->sval[0] = toupper((unsigned char) v->sval[0]);
+    }else{
+        v->ival *= 2;
+    }
+}
+
+/* demo_not_multiple(): keeps values that aren't a multiple of *arg */
+static bool demo_not_multiple(value_t v, value_type_t t, void *arg){
+    (void) t;
+    return v.ival % *(int *) arg != 0;
+}
+
+/* demo_is_short(): keeps strings shorter than *arg characters */
+static bool demo_is_short(value_t v, value_type_t t, void *arg){
+    (void) t;
+    return strlen(v.sval) < *(size_t *) arg;
+}
+
+/* demo_cmp_tens(): a comparator for list_sort that only looks at an int's tens */
+static int demo_cmp_tens(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    (void) ta;
+    (void) tb;
+    (void) arg;
+    return (a.ival / 10 > b.ival / 10) - (a.ival / 10 < b.ival / 10);
+}
+
+/* this is similar to Java main: this is the actual function that executes */
+/* for our purposes, main will just execute a few tests */
+int main() {
+    printf("Starting linked list demo tests...\n");
+
+    /* here are some dummy values we can use in our lists */
+    value_t val1, val2, val3, val4;
     val1.ival = 429;
     val2.cval = 'A';
     val3.bval = true;
@@ -480,8 +1993,923 @@ int main() {
     }else{
         printf("!!! list_new() FAILED !!!\n");
     }
+
+    demo_log(">> Testing list_get() walking forwards and backwards...\n");
+    list = list_new();
+    if(list != NULL){
+        for(int i = 0; i < 100; i++){
+            value_t v;
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+        }
+        /* the cached position has to follow along when the front of the list changes */
+        for(int i = 0; i < 100; i++){
+            if(list_get(i, list).ival != i){
+                demo_log("!!! list_get() FAILED !!!\n");
+            }
+        }
+        list_pop(list);
+        if(list_get(98, list).ival != 99 || list_get(50, list).ival != 51){
+            demo_log("!!! list_get() FAILED !!!\n");
+        }
+        value_t front;
+        front.ival = -1;
+        list_push(front, VAL_INT, list);
+        if(list_get(51, list).ival != 51 || list_get(0, list).ival != -1){
+            demo_log("!!! list_get() FAILED !!!\n");
+        }
+        list_remove_last(list);
+        for(int i = 98; i >= 1; i--){
+            if(list_get(i, list).ival != i){
+                demo_log("!!! list_get() FAILED !!!\n");
+            }
+        }
+        if(list_get_type(99, list) != VAL_NONE || list_get_type(-1, list) != VAL_NONE){
+            demo_log("!!! list_get_type() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing short and long strings...\n");
+    list = list_new();
+    if(list != NULL){
+        value_t short_str, long_str;
+        short_str.sval = "tiny";
+        long_str.sval = "this string is too long to fit inside a node";
+        list_append(short_str, VAL_STR, list);
+        list_append(long_str, VAL_STR, list);
+        list_push(long_str, VAL_STR, list);
+        list_print(list);
+        if(strcmp(list_get(1, list).sval, short_str.sval) != 0){
+            demo_log("!!! list_get() FAILED !!!\n");
+        }
+        if(strcmp(list_remove_last(list).sval, long_str.sval) != 0){
+            demo_log("!!! list_remove_last() FAILED !!!\n");
+        }
+        if(strcmp(list_pop(list).sval, long_str.sval) != 0){
+            demo_log("!!! list_pop() FAILED !!!\n");
+        }
+        if(strcmp(list_pop(list).sval, short_str.sval) != 0){
+            demo_log("!!! list_pop() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_push_owned(), list_append_owned() and the owned pops...\n");
+    list = list_new();
+    if(list != NULL){
+        char *mine = malloc(64);
+        strcpy(mine, "a string the list takes over without copying");
+        char *small = malloc(8);
+        strcpy(small, "small");
+        if(!list_append_owned(mine, list) || !list_push_owned(small, list)){
+            demo_log("!!! list_append_owned() FAILED !!!\n");
+        }
+        list_push(val4, VAL_STR, list);
+        list_print(list);
+        if(list_get(2, list).sval != mine){
+            demo_log("!!! list_append_owned() FAILED !!!\n");
+        }
+        /* a short string copied in by list_push still comes back as a buffer we own */
+        char *s = list_pop_owned(list).sval;
+        if(strcmp(s, val4.sval) != 0){
+            demo_log("!!! list_pop_owned() FAILED !!!\n");
+        }
+        free(s);
+        if(list_remove_last_owned(list).sval != mine){
+            demo_log("!!! list_remove_last_owned() FAILED !!!\n");
+        }
+        free(mine);
+        list_free(list);    /* 'small' is still in the list, so list_free takes care of it */
+        list = NULL;
+    }
+
+    demo_log(">> Testing an unrolled list...\n");
+    list = list_new_mode(LIST_UNROLLED);
+    if(list != NULL){
+        /* enough values to need a few nodes, added at both ends */
+        for(int i = 0; i < 40; i++){
+            value_t v;
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+            v.ival = -1 - i;
+            list_push(v, VAL_INT, list);
+        }
+        list_push(val4, VAL_STR, list);
+        list_append(val2, VAL_CHAR, list);
+        if(list_size(list) != 82 || list_get(41, list).ival != 0 || list_get(1, list).ival != -40){
+            demo_log("!!! list_get() FAILED !!!\n");
+        }
+        if(list_get_type(81, list) != VAL_CHAR || list_get(80, list).ival != 39){
+            demo_log("!!! list_get_type() FAILED !!!\n");
+        }
+        if(strcmp(list_pop(list).sval, val4.sval) != 0 || list_remove_last(list).cval != 'A'){
+            demo_log("!!! list_pop() FAILED !!!\n");
+        }
+        for(int i = 39; i >= 0; i--){
+            if(list_remove_last(list).ival != i){
+                demo_log("!!! list_remove_last() FAILED !!!\n");
+            }
+        }
+        list_print(list);
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_count_type() and list_find_type()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        /* every third value is a char, the rest are ints */
+        for(int i = 0; i < 50; i++){
+            value_t v;
+            if(i % 3 == 0){
+                v.cval = 'a' + i % 26;
+                list_append(v, VAL_CHAR, list);
+            }else{
+                v.ival = i;
+                list_append(v, VAL_INT, list);
+            }
+        }
+        if(list_count_type(VAL_CHAR, list) != 17 || list_count_type(VAL_INT, list) != 33 ||
+           list_count_type(VAL_STR, list) != 0){
+            demo_log("!!! list_count_type() FAILED !!!\n");
+        }
+        if(list_find_type(VAL_CHAR, 1, list) != 3 || list_find_type(VAL_CHAR, 46, list) != 48 ||
+           list_find_type(VAL_CHAR, 49, list) != -1 || list_find_type(VAL_STR, 0, list) != -1){
+            demo_log("!!! list_find_type() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_find_int() and list_find_char()...\n");
+    /* the unrolled list gets checked with every kind of search kernel the CPU has */
+    for(int level = LIST_SIMD_SCALAR; level <= LIST_SIMD_AVX2 + 1; level++){
+        int mode = level <= LIST_SIMD_AVX2 ? LIST_UNROLLED : LIST_CHAIN;
+        if(mode == LIST_UNROLLED && list_simd_use(level) != level){
+            continue;
+        }
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        /* ints 0..99, with chars mixed in whose bits look like the ints we'll search for, and a
+           string in front so the nodes don't all line up */
+        value_t v;
+        v.sval = "front";
+        list_append(v, VAL_STR, list);
+        for(int i = 0; i < 100; i++){
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+            if(i % 10 == 0){
+                v.ival = 0;
+                v.cval = (char) (60 + i);
+                list_append(v, VAL_CHAR, list);
+            }
+        }
+        /* ival 70 sits at index 78, and the char 'F' (also 70) at 13 */
+        if(list_find_int(70, 0, list) != 78 || list_find_int(70, 78, list) != 78 ||
+           list_find_int(70, 79, list) != -1 || list_find_int(-5, 0, list) != -1 ||
+           list_find_int(0, -3, list) != 1 || list_find_int(99, 110, list) != 110){
+            demo_log("!!! list_find_int() FAILED !!!\n");
+        }
+        if(list_find_char('F', 0, list) != 13 || list_find_char('F', 14, list) != -1 ||
+           list_find_char('<', 0, list) != 2 || list_find_char('a', 0, list) != -1){
+            demo_log("!!! list_find_char() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+    list_simd_use(LIST_SIMD_BEST);
+
+    demo_log(">> Testing list_save(), list_load() and list views...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        char path[] = "/tmp/list-demo-XXXXXX";
+        int fd = mkstemp(path);
+        if(list == NULL || fd < 0){
+            list_free(list);
+            list = NULL;
+            continue;
+        }
+        /* one of every type, a few times over, with short and long strings (and an empty one) */
+        const char *words[] = {"", "short", "a string far too long to fit inside a node"};
+        for(int i = 0; i < 30; i++){
+            value_t v;
+            switch(i % 4){
+                case 0: v.cval = (char) ('a' + i); break;
+                case 1: v.ival = -1000 * i; break;
+                case 2: v.bval = i % 3 == 0; break;
+                default: v.sval = (char *) words[i % 3]; break;
+            }
+            list_append(v, (value_type_t) (i % 4), list);
+        }
+        bool saved = list_save(fd, list);
+        close(fd);
+        list_t *loaded = list_load(path);
+        list_view_t *view = list_view_open(path);
+        bool same = saved && loaded != NULL && view != NULL && list_size(loaded) == 30 &&
+                    list_view_size(view) == 30;
+        for(int i = 0; same && i < 30; i++){
+            value_type_t t = list_get_type(i, list);
+            value_t a = list_get(i, list), b = list_get(i, loaded), c = list_view_get(i, view);
+            if(list_get_type(i, loaded) != t || list_view_get_type(i, view) != t){
+                same = false;
+            }else if(t == VAL_STR){
+                same = strcmp(a.sval, b.sval) == 0 && strcmp(a.sval, c.sval) == 0;
+            }else if(t == VAL_INT){
+                same = a.ival == b.ival && a.ival == c.ival;
+            }else if(t == VAL_CHAR){
+                same = a.cval == b.cval && a.cval == c.cval;
+            }else{
+                same = a.bval == b.bval && a.bval == c.bval;
+            }
+        }
+        if(!same || list_view_get_type(30, view) != VAL_NONE){
+            demo_log("!!! list_save()/list_load() FAILED !!!\n");
+        }
+        list_free(loaded);
+        list_view_close(view);
+        /* a file cut short isn't a saved list anymore */
+        if(truncate(path, 40) != 0 || list_load(path) != NULL || list_view_open(path) != NULL){
+            demo_log("!!! list_load() of a damaged file FAILED !!!\n");
+        }
+        unlink(path);
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing string tables (list_use_intern())...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list_intern_t *table = list_intern_new();
+        list_t *other = list_new_mode(mode);
+        list_t *plain = list_new_mode(mode);
+        list = list_new_mode(mode);
+        if(table == NULL || other == NULL || plain == NULL || list == NULL ||
+           !list_use_intern(table, list) || !list_use_intern(table, other)){
+            demo_log("!!! list_use_intern() FAILED !!!\n");
+            list_intern_free(table);
+            list_free(other);
+            list_free(plain);
+            list_free(list);
+            list = NULL;
+            continue;
+        }
+        /* lots of copies of two strings: the table only holds each one once */
+        value_t v;
+        for(int i = 0; i < 20; i++){
+            v.sval = i % 2 ? "apple" : "a string too long for a node, stored just once";
+            list_append(v, VAL_STR, list);
+        }
+        v.sval = "apple";
+        list_push(v, VAL_STR, other);
+        const char *apple = list_intern_find("apple", table);
+        if(list_intern_count(table) != 2 || apple == NULL || list_get(1, list).sval != apple ||
+           list_get(0, other).sval != apple || list_intern_find("pear", table) != NULL ||
+           list_use_intern(NULL, list)){
+            demo_log("!!! list_intern_find() FAILED !!!\n");
+        }
+        /* an owned string is swapped for the table's copy; an owned pop gives back a copy */
+        char *pear = malloc(5);
+        strcpy(pear, "pear");
+        if(!list_push_owned(pear, list) || list_intern_find("pear", table) != list_get(0, list).sval){
+            demo_log("!!! list_push_owned() with a string table FAILED !!!\n");
+        }
+        char *popped = list_pop_owned(list).sval;
+        if(popped == NULL || strcmp(popped, "pear") != 0 || list_intern_find("pear", table) != NULL){
+            demo_log("!!! list_pop_owned() with a string table FAILED !!!\n");
+        }
+        free(popped);
+        if(strcmp(list_pop(list).sval, "a string too long for a node, stored just once") != 0){
+            demo_log("!!! list_pop() with a string table FAILED !!!\n");
+        }
+        /* strings can only move between lists sharing a table */
+        v.sval = "plain";
+        list_append(v, VAL_STR, plain);
+        if(list_concat(list, plain) || !list_concat(list, other) || list_size(list) != 20 ||
+           list_size(other) != 0){
+            demo_log("!!! list_concat() with a string table FAILED !!!\n");
+        }
+        size_t short_len = 10;
+        list_t *tail = list_split_at(list, 10);
+        if(list_filter(demo_is_short, LIST_TYPE_BIT(VAL_STR), &short_len, list) != 5 ||
+           list_intern_of(tail) != table || list_intern_count(table) != 2){
+            demo_log("!!! list_filter() with a string table FAILED !!!\n");
+        }
+        list_free(tail);
+        list_free(list);
+        list = NULL;
+        if(list_intern_count(table) != 0){
+            demo_log("!!! list_free() with a string table FAILED !!!\n");
+        }
+        list_free(other);
+        list_free(plain);
+        list_intern_free(table);
+    }
+
+    demo_log(">> Testing arenas and list_new_in_arena()...\n");
+    arena_t *arena = arena_new(4096);      /* small chunks, so the lists below need several */
+    if(arena != NULL){
+        void *before = arena_alloc(100, arena);
+        size_t used_before = arena_used(arena);
+        arena_mark_t mark = arena_mark(arena);
+        list = list_new_in_arena(arena);
+        list_t *other = list_new_in_arena(arena);
+        list_t *plain = list_new();
+        if(before == NULL || list == NULL || other == NULL || plain == NULL){
+            demo_log("!!! list_new_in_arena() FAILED !!!\n");
+        }else{
+            value_t v;
+            for(int i = 0; i < 300; i++){
+                if(i % 3 == 0){
+                    v.sval = "a string too long to fit inside a node";
+                    list_append(v, VAL_STR, list);
+                }else{
+                    v.ival = i;
+                    list_append(v, VAL_INT, list);
+                }
+            }
+            char *owned = malloc(16);
+            strcpy(owned, "owned by me now");
+            v.ival = 7;
+            list_append(v, VAL_INT, other);
+            if(!list_push_owned(owned, list) || strcmp(list_get(0, list).sval, "owned by me now") != 0 ||
+               list_size(list) != 301 || list_use_intern(NULL, other)){
+                demo_log("!!! list_push_owned() in an arena FAILED !!!\n");
+            }
+            /* owned strings come back as malloc'd copies; others stay in the arena */
+            char *back = list_pop_owned(list).sval;
+            if(back == NULL || strcmp(back, "owned by me now") != 0 ||
+               strcmp(list_pop(list).sval, "a string too long to fit inside a node") != 0){
+                demo_log("!!! list_pop() in an arena FAILED !!!\n");
+            }
+            free(back);
+            /* nodes only move between lists in the same arena */
+            if(list_concat(list, plain) || !list_concat(list, other) || list_size(list) != 300){
+                demo_log("!!! list_concat() in an arena FAILED !!!\n");
+            }
+            size_t short_len = 10;
+            list_t *tail = list_split_at(list, 150);
+            if(tail == NULL || list_filter(demo_is_short, LIST_TYPE_BIT(VAL_STR), &short_len, list) != 50 ||
+               list_size(tail) != 150 || list_get(149, tail).ival != 7){
+                demo_log("!!! list_filter() in an arena FAILED !!!\n");
+            }
+            list_free(tail);    /* does nothing: the rewind below frees it all */
+        }
+        list_free(plain);
+        list_free(list);
+        list = NULL;
+        /* one rewind throws away both lists, and the arena is right back where it was */
+        arena_rewind(mark, arena);
+        if(arena_used(arena) != used_before || arena_mark(arena).chunk != mark.chunk){
+            demo_log("!!! arena_rewind() FAILED !!!\n");
+        }
+        /* the chunks the lists used are kept for next time, until a trim */
+        size_t chunks = arena->chunks;
+        arena_reset(arena);
+        if(arena_used(arena) != 0 || arena->chunks != chunks || arena_alloc(10, arena) == NULL){
+            demo_log("!!! arena_reset() FAILED !!!\n");
+        }
+        arena_reset(arena);
+        arena_trim(arena);
+        if(arena->chunks != 0){
+            demo_log("!!! arena_trim() FAILED !!!\n");
+        }
+        arena_free(arena);
+    }
+
+    demo_log(">> Testing list_use_index(), list_contains() and list_remove_value()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        /* only a chain can have an index, but lookups work either way */
+        if(list_use_index(list) != (mode == LIST_CHAIN)){
+            demo_log("!!! list_use_index() FAILED !!!\n");
+        }
+        value_t v;
+        char word[32];
+        for(int i = 0; i < 500; i++){
+            v.ival = i * 3;
+            list_append(v, VAL_INT, list);
+            snprintf(word, sizeof(word), "word number %d", i);
+            v.sval = word;
+            list_push(v, VAL_STR, list);
+        }
+        v.cval = 'q';
+        list_push(v, VAL_CHAR, list);
+        v.bval = false;
+        list_append(v, VAL_BOOL, list);
+        /* a copy of the string, not the list's own pointer, has to match */
+        strcpy(word, "word number 123");
+        v.sval = word;
+        value_t three, four, q, no, yes;
+        three.ival = 3;
+        four.ival = 4;
+        q.cval = 'q';
+        no.bval = false;
+        yes.bval = true;
+        if(!list_contains(v, VAL_STR, list) || !list_contains(three, VAL_INT, list) ||
+           list_contains(four, VAL_INT, list) || !list_contains(q, VAL_CHAR, list) ||
+           !list_contains(no, VAL_BOOL, list) || list_contains(yes, VAL_BOOL, list) ||
+           list_contains(three, VAL_CHAR, list)){
+            demo_log("!!! list_contains() FAILED !!!\n");
+        }
+        if(mode == LIST_CHAIN){
+            node_t *n = list_find_node(three, VAL_INT, list);
+            if(n == NULL || n->val.ival != 3 || list_find_node(four, VAL_INT, list) != NULL){
+                demo_log("!!! list_find_node() FAILED !!!\n");
+            }
+        }
+        if(mode != LIST_UNROLLED){
+            /* pops and removals from the end keep the index right as they go */
+            list_pop(list);
+            list_remove_last(list);
+            free(list_pop_owned(list).sval);        /* "word number 499" */
+            strcpy(word, "word number 499");
+            if(list_contains(q, VAL_CHAR, list) || list_contains(no, VAL_BOOL, list) ||
+               list_contains(v, VAL_STR, list)){
+                demo_log("!!! list_pop() with an index FAILED !!!\n");
+            }
+            strcpy(word, "word number 123");
+            if(!list_remove_value(v, VAL_STR, list) || list_contains(v, VAL_STR, list) ||
+               !list_remove_value(three, VAL_INT, list) || list_remove_value(three, VAL_INT, list) ||
+               list_size(list) != 997){
+                demo_log("!!! list_remove_value() FAILED !!!\n");
+            }
+            /* a bulk change makes the index stale, and the next lookup rebuilds it */
+            int three_times = 3;
+            list_filter(demo_not_multiple, LIST_TYPE_BIT(VAL_INT), &three_times, list);
+            v.ival = 4;
+            list_push(v, VAL_INT, list);
+            if(list_contains(three, VAL_INT, list) || !list_contains(four, VAL_INT, list) ||
+               list_contains(v, VAL_CHAR, list)){
+                demo_log("!!! list_contains() after list_filter() FAILED !!!\n");
+            }
+        }
+        list_free(list);
+    }
+    list = NULL;
+
+    demo_log(">> Testing list_use_skip(), list_insert_at() and list_remove_at()...\n");
+    /* random changes at both ends and in the middle, checked against a plain array: first on a
+       chain with a skip layer, then on a ring list (which wraps around, grows and shrinks) */
+    int *model = malloc(4000 * sizeof(int));
+    for(int m = 0; m < 2; m++){
+        list = list_new_mode(m == 0 ? LIST_CHAIN : LIST_RING);
+        if(list == NULL || model == NULL || (m == 0 && !list_use_skip(list))){
+            demo_log("!!! list_use_skip() FAILED !!!\n");
+            list_free(list);
+            continue;
+        }
+        int count = 0;
+        unsigned int x = 2024;
+        bool good = true;
+        value_t v;
+        for(int i = 0; i < 500; i++){
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+            model[count++] = i;
+        }
+        for(int step = 0; step < 6000 && good; step++){
+            x = x * 1103515245u + 12345u;
+            int r = (int) ((x >> 16) % 100);
+            int at = count > 0 ? (int) ((x >> 4) % (unsigned int) count) : 0;
+            v.ival = step + 1000;
+            if(r < 15 && count < 3900){
+                list_push(v, VAL_INT, list);
+                memmove(model + 1, model, count * sizeof(int));
+                model[0] = v.ival;
+                count++;
+            }else if(r < 30 && count < 3900){
+                list_append(v, VAL_INT, list);
+                model[count++] = v.ival;
+            }else if(r < 40 && count > 0){
+                good = list_pop(list).ival == model[0];
+                memmove(model, model + 1, --count * sizeof(int));
+            }else if(r < 50 && count > 0){
+                good = list_remove_last(list).ival == model[--count];
+            }else if(r < 65 && count < 3900){
+                good = list_insert_at(at, v, VAL_INT, list);
+                memmove(model + at + 1, model + at, (count - at) * sizeof(int));
+                model[at] = v.ival;
+                count++;
+            }else if(r < 80 && count > 0){
+                good = list_remove_at(at, list).ival == model[at];
+                memmove(model + at, model + at + 1, (count - at - 1) * sizeof(int));
+                count--;
+            }else if(r == 80){
+                /* this one makes the layer stale, so the next list_get builds it again */
+                list_cursor_t c = list_cursor_at(count / 2, list);
+                list_cursor_insert_after(&c, v, VAL_INT);
+                memmove(model + count / 2 + 2, model + count / 2 + 1, (count - count / 2 - 1) * sizeof(int));
+                model[count / 2 + 1] = v.ival;
+                count++;
+            }else if(count > 0){
+                good = list_get(at, list).ival == model[at];
+            }
+            good = good && list_size(list) == count;
+        }
+        for(int i = 0; i < count && good; i += 7){
+            good = list_get(i, list).ival == model[i];
+        }
+        if(!good || list_insert_at(count + 1, v, VAL_INT, list) || list_remove_at(-1, list).sval != NULL){
+            demo_log("!!! list_insert_at() and list_remove_at() FAILED !!!\n");
+        }
+        /* once most of its values are gone, a ring list's array shrinks back down */
+        while(list_size(list) > 3){
+            list_remove_at(list_size(list) / 2, list);
+        }
+        if(m == 1 && (list->rcap != LIST_RING_MIN || list_get(2, list).ival != model[count - 1])){
+            demo_log("!!! list_remove_at() shrinking a ring list FAILED !!!\n");
+        }
+        list_free(list);
+    }
+    free(model);
+    list = NULL;
+
+    demo_log(">> Testing list_sort()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        value_t v;
+        v.sval = "zebra";
+        list_append(v, VAL_STR, list);
+        v.ival = 3;
+        list_append(v, VAL_INT, list);
+        v.cval = 'c';
+        list_append(v, VAL_CHAR, list);
+        v.ival = -1;
+        list_append(v, VAL_INT, list);
+        v.sval = "apple";
+        list_append(v, VAL_STR, list);
+        v.ival = 2;
+        list_append(v, VAL_INT, list);
+        list_cursor_t c = list_cursor_begin(list);
+        /* only the ints get ordered; the two strings count as equal, so they keep their order */
+        char text[128];
+        if(!list_sort(list_cmp_int, NULL, list) || list_format(list, text, sizeof(text)) == 0 ||
+           strcmp(text, "[ (char) c | (int) -1 | (int) 2 | (int) 3 | (char *) zebra | (char *) apple ]") != 0){
+            demo_log("!!! list_sort() with list_cmp_int FAILED !!!\n");
+        }
+        if(!list_sort(NULL, NULL, list) || list_format(list, text, sizeof(text)) == 0 ||
+           strcmp(text, "[ (char) c | (int) -1 | (int) 2 | (int) 3 | (char *) apple | (char *) zebra ]") != 0){
+            demo_log("!!! list_sort() with list_cmp_value FAILED !!!\n");
+        }
+        /* a chain's nodes just moved, so the cursor is still on "zebra" */
+        if(mode == LIST_CHAIN && strcmp(list_cursor_get(&c).sval, "zebra") != 0){
+            demo_log("!!! list_sort() moving nodes FAILED !!!\n");
+        }
+        list_free(list);
+
+        /* 0 to 999 shuffled, sorted by their tens only: each ten-value group must come out in the
+           order its values went in */
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        int where[1000];
+        for(int i = 0; i < 1000; i++){
+            v.ival = (i * 7919) % 1000;
+            where[v.ival] = i;
+            list_append(v, VAL_INT, list);
+        }
+        if(!list_sort(demo_cmp_tens, NULL, list)){
+            demo_log("!!! list_sort() of 1000 ints FAILED !!!\n");
+        }
+        for(int i = 1; i < 1000; i++){
+            int a = list_get(i - 1, list).ival;
+            int b = list_get(i, list).ival;
+            if(a / 10 > b / 10 || (a / 10 == b / 10 && where[a] > where[b])){
+                demo_log("!!! list_sort() of 1000 ints FAILED !!!\n");
+                break;
+            }
+        }
+        list_free(list);
+    }
+    list = NULL;
+
+    demo_log(">> Testing list_format() and list_write()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        char text[128];
+        if(list_format(list, text, sizeof(text)) != 2 || strcmp(text, "[]") != 0){
+            demo_log("!!! list_format() of an empty list FAILED !!!\n");
+        }
+        value_t v;
+        v.cval = 'x';
+        list_append(v, VAL_CHAR, list);
+        v.ival = -2147483647 - 1;
+        list_append(v, VAL_INT, list);
+        v.ival = 907;
+        list_append(v, VAL_INT, list);
+        v.bval = true;
+        list_append(v, VAL_BOOL, list);
+        v.sval = "hi there";
+        list_append(v, VAL_STR, list);
+        const char *expected = "[ (char) x | (int) -2147483648 | (int) 907 | (bool) 1 | (char *) hi there ]";
+        size_t len = strlen(expected);
+        if(list_format(list, text, sizeof(text)) != len || strcmp(text, expected) != 0){
+            demo_log("!!! list_format() FAILED !!!\n");
+        }
+        /* too small a buffer gets as much as fits, and the full length is still returned */
+        if(list_format(list, text, 10) != len || strcmp(text, "[ (char) ") != 0 ||
+           list_format(list, NULL, 0) != len){
+            demo_log("!!! list_format() into a small buffer FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+#ifdef LIST_STATS
+    demo_log(">> Testing list_stats()...\n");
+    list = list_new();
+    if(list != NULL){
+        value_t long_str;
+        long_str.sval = "this string is too long to fit inside a node";
+        for(int i = 0; i < 20; i++){
+            list_append(val1, VAL_INT, list);
+        }
+        list_append(long_str, VAL_STR, list);
+        list_push(val4, VAL_STR, list);
+        list_get(5, list);      /* 5 steps from the front */
+        list_pop(list);
+        list_stats_t stats = list_stats(list);
+        /* two node blocks (16 nodes, then 32) and one string */
+        if(stats.allocs != 3 || stats.max_size != 22 || stats.traversed != 5 ||
+           stats.str_bytes != (long long) strlen(long_str.sval) + 1){
+            demo_log("!!! list_stats() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+#endif
+
+    demo_log(">> Testing list_append_array() and the bulk pops...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        value_t some_vals[4] = { val1, val2, val3, val4 };
+        value_type_t some_types[4] = { VAL_INT, VAL_CHAR, VAL_BOOL, VAL_STR };
+        value_t ints[100];
+        for(int i = 0; i < 100; i++){
+            ints[i].ival = i;
+        }
+        if(list_append_array(some_vals, some_types, 4, list) != 4 ||
+           list_append_array_type(ints, VAL_INT, 100, list) != 100 || list_size(list) != 104){
+            demo_log("!!! list_append_array() FAILED !!!\n");
+        }
+        if(strcmp(list_get(3, list).sval, val4.sval) != 0 || list_get(103, list).ival != 99){
+            demo_log("!!! list_append_array() FAILED !!!\n");
+        }
+        value_t out[10];
+        value_type_t out_types[10];
+        if(list_pop_n(out, out_types, 5, list) != 5 || out[0].ival != val1.ival ||
+           out_types[3] != VAL_STR || strcmp(out[3].sval, val4.sval) != 0 || out[4].ival != 0){
+            demo_log("!!! list_pop_n() FAILED !!!\n");
+        }
+        free(out[3].sval);      /* strings from a bulk pop are ours now */
+        if(list_remove_last_n(out, NULL, 10, list) != 10 || out[0].ival != 99 ||
+           out[9].ival != 90 || list_size(list) != 89 || list_get(88, list).ival != 89){
+            demo_log("!!! list_remove_last_n() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_concat(), list_splice() and list_split_at()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        list = list_new_mode(mode);
+        list_t *other = list_new_mode(mode);
+        if(list == NULL || other == NULL){
+            list_free(list);
+            list_free(other);
+            continue;
+        }
+        /* list gets 0..39, other gets 40..79 */
+        for(int i = 0; i < 40; i++){
+            value_t v;
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+            v.ival = 40 + i;
+            list_append(v, VAL_INT, other);
+        }
+        list_push(val4, VAL_STR, other);
+        if(!list_concat(list, other) || list_size(list) != 81 || list_size(other) != 0 ||
+           strcmp(list_get(40, list).sval, val4.sval) != 0 || list_get(80, list).ival != 79){
+            demo_log("!!! list_concat() FAILED !!!\n");
+        }
+        /* split in the middle of an unrolled node, and at the very end */
+        list_t *back = list_split_at(list, 37);
+        list_t *nothing = list_split_at(list, 37);
+        if(back == NULL || nothing == NULL || list_size(list) != 37 || list_size(back) != 44 ||
+           list_size(nothing) != 0 || list_get(36, list).ival != 36 ||
+           list_get(0, back).ival != 37 || list_get(43, back).ival != 79){
+            demo_log("!!! list_split_at() FAILED !!!\n");
+        }
+        if(mode == LIST_CHAIN && back != NULL){
+            /* move back's 2nd..4th values (38, 39 and the string) to the front of 'list' */
+            node_t *first = back->header->next->next;
+            node_t *last = first->next->next;
+            if(!list_splice(list, list->header->next, back, first, last) ||
+               list_size(list) != 40 || list_size(back) != 41 || list_get(1, list).ival != 39 ||
+               strcmp(list_get(2, list).sval, val4.sval) != 0 || list_get(3, list).ival != 0 ||
+               list_get(1, back).ival != 40){
+                demo_log("!!! list_splice() FAILED !!!\n");
+            }
+            /* and 'last' can't be moved in front of itself */
+            if(list_splice(list, last, list, first, last)){
+                demo_log("!!! list_splice() FAILED !!!\n");
+            }
+        }
+        /* the lists share nodes now, so free them in a different order than they were made */
+        list_free(list);
+        list_free(nothing);
+        list_free(other);
+        list_free(back);
+        list = NULL;
+    }
+
+    demo_log(">> Testing cursors...\n");
+    /* an unrolled list has no cursors, and a ring list's cursors are indices */
+    list_mode_t cursor_modes[2] = { LIST_CHAIN, LIST_RING };
+    for(int m = 0; m < 2; m++){
+        list = list_new_mode(cursor_modes[m]);
+        if(list == NULL){
+            continue;
+        }
+        for(int i = 0; i < 20; i++){
+            value_t v;
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+        }
+        /* one pass: drop the odd numbers and put a char after every multiple of 5 */
+        list_cursor_t c = list_cursor_begin(list);
+        while(list_cursor_valid(&c)){
+            int i = list_cursor_get(&c).ival;
+            if(i % 2 == 1){
+                list_cursor_erase(&c);
+                continue;
+            }
+            if(i % 5 == 0){
+                list_cursor_insert_after(&c, val2, VAL_CHAR);
+                list_cursor_next(&c);   /* step over the char we just added */
+            }
+            list_cursor_next(&c);
+        }
+        list_print(list);
+        /* 0 A 2 4 6 8 10 A 12 14 16 18 */
+        if(list_size(list) != 12 || list_get(1, list).cval != 'A' || list_get(7, list).cval != 'A' ||
+           list_get(11, list).ival != 18 || list_count_type(VAL_CHAR, list) != 2){
+            demo_log("!!! list_cursor_erase() FAILED !!!\n");
+        }
+        c = list_cursor_at(6, list);
+        list_cursor_insert_before(&c, val4, VAL_STR);
+        list_cursor_prev(&c);
+        if(list_cursor_type(&c) != VAL_STR || strcmp(list_get(6, list).sval, val4.sval) != 0 ||
+           list_get(7, list).ival != 10){
+            demo_log("!!! list_cursor_insert_before() FAILED !!!\n");
+        }
+        /* 'after the end' is the front, and moving on from the end wraps around to it */
+        c = list_cursor_at(100, list);
+        list_cursor_insert_after(&c, val1, VAL_INT);
+        if(list_cursor_valid(&c) || list_get(0, list).ival != val1.ival || list_size(list) != 14){
+            demo_log("!!! list_cursor_insert_after() past the end FAILED !!!\n");
+        }
+        list_cursor_next(&c);
+        if(!list_cursor_valid(&c) || list_cursor_get(&c).ival != val1.ival){
+            demo_log("!!! list_cursor_next() past the end FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_reduce(), list_map_inplace() and list_filter()...\n");
+    for(int mode = LIST_CHAIN; mode <= LIST_RING; mode++){
+        value_t zero;
+        zero.ival = 0;
+        char word[] = "hello";
+        value_t str;
+        str.sval = word;
+
+        /* a small list: done by one thread */
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        for(int i = 1; i <= 10; i++){
+            value_t v;
+            v.ival = i;
+            list_append(v, VAL_INT, list);
+            v.bval = i % 3 == 0;
+            list_append(v, VAL_BOOL, list);
+        }
+        list_push(str, VAL_STR, list);
+        list_append(val2, VAL_CHAR, list);
+        /* 1+2+...+10 = 55, and three of the bools are true */
+        if(list_reduce(demo_sum, demo_add, zero, LIST_TYPE_BIT(VAL_INT), NULL, list).ival != 55 ||
+           list_reduce(demo_sum, NULL, zero, LIST_TYPE_BIT(VAL_BOOL), NULL, list).ival != 3){
+            demo_log("!!! list_reduce() FAILED !!!\n");
+        }
+        list_map_inplace(demo_double, LIST_TYPE_BIT(VAL_INT) | LIST_TYPE_BIT(VAL_STR), NULL, list);
+        if(list_get(1, list).ival != 2 || list_get(19, list).ival != 20 ||
+           strcmp(list_get(0, list).sval, "Hello") != 0 || list_get(21, list).cval != 'A'){
+            demo_log("!!! list_map_inplace() FAILED !!!\n");
+        }
+        /* the ints are 2, 4, ... 20 now: drop the multiples of 4, and every bool */
+        int four = 4, one = 1;
+        int removed = list_filter(demo_not_multiple, LIST_TYPE_BIT(VAL_INT), &four, list);
+        removed += list_filter(demo_not_multiple, LIST_TYPE_BIT(VAL_BOOL), &one, list);
+        if(removed != 15 || list_size(list) != 7 || list_get(1, list).ival != 2 ||
+           list_get(5, list).ival != 18 || list_get(6, list).cval != 'A'){
+            demo_log("!!! list_filter() FAILED !!!\n");
+        }
+        list_free(list);
+
+        /* a big list: split up between threads, but the answers must be just the same */
+        int n = 3 * LIST_PARALLEL_MIN + 5;
+        list = list_new_mode(mode);
+        if(list == NULL){
+            continue;
+        }
+        for(int i = 0; i < n; i++){
+            value_t v;
+            v.ival = i % 1000;
+            list_append(v, VAL_INT, list);
+            if(i % 1000 == 0){
+                list_append(str, VAL_STR, list);
+            }
+        }
+        long long expected = 0;
+        for(int i = 0; i < n; i++){
+            expected += i % 1000;
+        }
+        if(list_reduce(demo_sum, demo_add, zero, LIST_TYPE_BIT(VAL_INT), NULL, list).ival
+                != expected){
+            demo_log("!!! list_reduce() FAILED !!!\n");
+        }
+        int three = 3;
+        int strings = list_count_type(VAL_STR, list);
+        removed = list_filter(demo_not_multiple, LIST_TYPE_BIT(VAL_INT), &three, list);
+        /* what's left must still be in order: 1 2 4 5 7 8 ... with a string now and then */
+        bool in_order = list_size(list) == n + strings - removed;
+        int prev = -1;
+        for(int i = 0; i < list_size(list) && in_order; i++){
+            if(list_get_type(i, list) != VAL_INT){
+                continue;
+            }
+            int v = list_get(i, list).ival;
+            in_order = v % 3 != 0 && (v > prev || prev >= 997);
+            prev = v;
+        }
+        if(!in_order || list_count_type(VAL_STR, list) != strings){
+            demo_log("!!! list_filter() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }
+
+    demo_log(">> Testing list_new_with_capacity()...\n");
+    list = list_new_with_capacity(8);
+    if(list != NULL){
+        /* push and pop more than the reserved amount a few times over; the nodes should just get
+           recycled through the pool */
+        for(int round = 0; round < 3; round++){
+            for(int i = 0; i < 10; i++){
+                value_t v;
+                v.ival = i;
+                list_append(v, VAL_INT, list);
+            }
+            for(int i = 0; i < 10; i++){
+                if(list_pop(list).ival != i){
+                    demo_log("!!! list_new_with_capacity() FAILED !!!\n");
+                }
+            }
+        }
+        if(list_size(list) != 0){
+            demo_log("!!! list_size() FAILED !!!\n");
+        }
+        list_free(list);
+        list = NULL;
+    }else{
+        printf("!!! list_new_with_capacity() FAILED !!!\n");
+    }
     
     printf("Complete!\n");
     return 0; /* returning 0 from main usually means everything went smoothly! */
 }
 
+#endif /* LIST_NO_DEMO */
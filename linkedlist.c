@@ -36,7 +36,8 @@ list_t *list_new(){
     if( /* your list variable name here */ == NULL){
       return NULL;
     }
-    /* TODO: set all of its fields and update return value */
+    /* TODO: set all of its fields and update return value (popped_str starts out NULL: no
+       string has been popped yet) */
     
     return NULL;
 }
@@ -47,7 +48,8 @@ void list_free(list_t *l){
     if(l == NULL){
         return;
     }
-    /* TODO: Free the whole structure and any members it has */
+    /* TODO: Free the whole structure and any members it has (including popped_str, the last
+       string list_pop or list_remove_last handed out) */
 
 }
 
@@ -159,8 +161,11 @@ value_t list_pop(list_t *l){
 
             break;
         case VAL_STR:
-            /* We need a copy of the string to return since we're freeing the string -
-               if you free a pointer and return it, it points to unallocated memory. */
+            /* We can't free the string and then return it - a freed pointer points to unallocated
+               memory. But copying it would mean the caller has to free the copy, and list.h
+               promises they don't. So the list keeps the string a little longer: free whatever
+               string is in l->popped_str, put this node's string there, and return it. It stays
+               valid until the next list_pop, list_remove_last or list_free. */
             
             break;
         default:
@@ -169,7 +174,7 @@ value_t list_pop(list_t *l){
     }
 
     /* TODO: free and unlink front node */
-    /* In addition: free this node's string value when applicable */
+    /* (but not its string value: that's parked in popped_str now) */
     
     l->size--;
 
@@ -198,12 +203,10 @@ value_t list_remove_last(list_t *l){
             ret_val.bval = l->header->prev->val.bval;
             break;
         case VAL_STR:
-            ret_val.sval = malloc(strlen(l->header->next->val.sval) + 1);
-            if(ret_val.sval == NULL){
-                /* major issue, return early (NULL) */
-                return ret_val;
-            }
-            strcpy(ret_val.sval, l->header->next->val.sval); /* strcpy as used above */
+            /* just like list_pop: park the string in the list instead of copying it */
+            free(l->popped_str);
+            l->popped_str = l->header->prev->val.sval;
+            ret_val.sval = l->popped_str;
             break;
         default:
             /* something went wrong; return ret_val, which at this point should still be NULL */
@@ -211,7 +214,7 @@ value_t list_remove_last(list_t *l){
     }
 
     /* TODO: free and unlink last node */
-    /* In addition: free this node's string value when applicable */
+    /* (its string value, if it had one, is parked in popped_str, so don't free it) */
 
     l->size--;
 
@@ -0,0 +1,194 @@
+/*
+ *  This file (list-format.c) holds list_write and list_format, which turn a list into the same
+ *  text list_print shows: [ (char) a | (int) 5 | (bool) 1 | (char *) hi ]
+ *
+ *  printf has to read its format string and look up its arguments every time it's called, and
+ *  calling it a few times per value adds up quickly for a big list. Here each value is turned
+ *  into text by a small routine of our own, straight into a buffer on the stack, and the buffer is
+ *  only handed on ("flushed") when it's full and once at the end. Nothing is allocated.
+ *
+ */
+
+#include <string.h>
+
+#include "list-internal.h"
+
+/* How much text is gathered before it's handed to the sink */
+#define LIST_FORMAT_BUF 4096
+
+/* the state of one list_write call */
+typedef struct{
+    list_sink_fn sink;
+    void *arg;
+    bool failed;            /* the sink said to stop; everything after that is skipped */
+    bool first;             /* no '|' before the first value */
+    size_t used;
+    char buf[LIST_FORMAT_BUF];
+} list_formatter_t;
+
+/* fmt_flush(): formatter * parameter, no return value; hand the buffered text to the sink */
+static void fmt_flush(list_formatter_t *f){
+    if(f->used > 0 && !f->failed && !f->sink(f->buf, f->used, f->arg)){
+        f->failed = true;
+    }
+    f->used = 0;
+}
+
+/* fmt_put(): formatter *, text and length parameters, no return value. Long strings go through
+   the buffer a piece at a time */
+static inline void fmt_put(list_formatter_t *f, const char *s, size_t len){
+    /* nearly always, it just fits */
+    if(len <= LIST_FORMAT_BUF - f->used){
+        memcpy(f->buf + f->used, s, len);
+        f->used += len;
+        return;
+    }
+    while(len > 0 && !f->failed){
+        if(f->used == LIST_FORMAT_BUF){
+            fmt_flush(f);
+        }
+        size_t room = LIST_FORMAT_BUF - f->used;
+        size_t n = len < room ? len : room;
+        memcpy(f->buf + f->used, s, n);
+        f->used += n;
+        s += n;
+        len -= n;
+    }
+}
+
+/* Two digits at a time: entry i is the two characters of i, for i from 00 to 99 */
+static const char digit_pairs[] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829"
+    "30313233343536373839" "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879" "80818283848586878889"
+    "90919293949596979899";
+
+/* fmt_int(): formatter * and int parameters, no return value; the digits are worked out from the
+   right end of a small array. The magnitude is taken as unsigned so INT_MIN works too */
+static void fmt_int(list_formatter_t *f, int x){
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    unsigned int u = x < 0 ? 0u - (unsigned int) x : (unsigned int) x;
+    while(u >= 100){
+        unsigned int pair = u % 100;
+        u /= 100;
+        p -= 2;
+        memcpy(p, &digit_pairs[2 * pair], 2);
+    }
+    if(u >= 10){
+        p -= 2;
+        memcpy(p, &digit_pairs[2 * u], 2);
+    }else{
+        *--p = (char) ('0' + u);
+    }
+    if(x < 0){
+        *--p = '-';
+    }
+    fmt_put(f, p, (size_t) (digits + sizeof(digits) - p));
+}
+
+/* fmt_hex(): formatter * and number parameters, no return value; lowercase hex, no leading zeros */
+static void fmt_hex(list_formatter_t *f, unsigned long long x){
+    char digits[16];
+    char *p = digits + sizeof(digits);
+    do{
+        *--p = "0123456789abcdef"[x & 15];
+        x >>= 4;
+    }while(x != 0);
+    fmt_put(f, p, (size_t) (digits + sizeof(digits) - p));
+}
+
+/* a string literal's length is known without strlen */
+#define FMT_LITERAL(f, s) fmt_put((f), (s), sizeof(s) - 1)
+
+/* fmt_value(): value, value type and formatter * parameters, no return value; one value, the way
+   list_walk hands them over */
+static void fmt_value(value_t v, value_type_t t, void *arg){
+    list_formatter_t *f = arg;
+    if(f->failed){
+        return;
+    }
+    if(!f->first){
+        FMT_LITERAL(f, "|");
+    }
+    f->first = false;
+    switch(t){
+        case VAL_CHAR:
+            FMT_LITERAL(f, " (char) ");
+            fmt_put(f, &v.cval, 1);
+            break;
+        case VAL_INT:
+            FMT_LITERAL(f, " (int) ");
+            fmt_int(f, v.ival);
+            break;
+        case VAL_BOOL:
+            FMT_LITERAL(f, " (bool) ");
+            fmt_put(f, v.bval ? "1" : "0", 1);
+            break;
+        case VAL_STR:
+            FMT_LITERAL(f, " (char *) ");
+            fmt_put(f, v.sval, strlen(v.sval));
+            break;
+        default:
+            /* if we have any errors, we may as well see 'em in hex */
+            FMT_LITERAL(f, " (ERROR) ");
+            fmt_hex(f, (unsigned long long) (uintptr_t) v.sval);
+    }
+    FMT_LITERAL(f, " ");
+}
+
+/* list_write(): sink callback, extra pointer and list * parameters, return true if the whole list
+   was handed to the sink as text (false if the sink asked to stop). The sink may be called any
+   number of times, with up to LIST_FORMAT_BUF bytes each time; the text isn't null-terminated */
+bool list_write(list_sink_fn sink, void *arg, list_t *l){
+    if(!sink || !l){
+        return false;
+    }
+    list_formatter_t f;
+    f.sink = sink;
+    f.arg = arg;
+    f.failed = false;
+    f.first = true;
+    f.used = 0;
+    FMT_LITERAL(&f, "[");
+    list_walk(l, fmt_value, &f);
+    FMT_LITERAL(&f, "]");
+    fmt_flush(&f);
+    return !f.failed;
+}
+
+/* where list_format is copying to, and how much text there has been so far */
+typedef struct{
+    char *buf;
+    size_t cap;
+    size_t len;
+} list_format_dest_t;
+
+static bool format_sink(const char *s, size_t len, void *arg){
+    list_format_dest_t *d = arg;
+    /* keep the last byte for the null terminator */
+    if(d->len + 1 < d->cap){
+        size_t room = d->cap - 1 - d->len;
+        memcpy(d->buf + d->len, s, len < room ? len : room);
+    }
+    d->len += len;
+    return true;
+}
+
+/* list_format(): list *, buffer and capacity parameters, return the length of the list's whole
+   text. At most cap - 1 characters of it are put in the buffer, followed by a null terminator
+   (if cap is 0 nothing is written), so a return value of cap or more means it was cut short. Just
+   like snprintf */
+size_t list_format(list_t *l, char *buf, size_t cap){
+    list_format_dest_t d;
+    d.buf = buf;
+    d.cap = buf != NULL ? cap : 0;
+    d.len = 0;
+    if(l != NULL){
+        list_write(format_sink, &d, l);
+    }
+    if(d.cap > 0){
+        buf[d.len < d.cap ? d.len : d.cap - 1] = '\0';
+    }
+    return d.len;
+}
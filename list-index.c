@@ -0,0 +1,221 @@
+/*
+ *  This file (list-index.c) holds the hash index that a LIST_CHAIN list can keep on its values
+ *  (see list_use_index), so that asking whether a value is in the list doesn't mean walking it.
+ *
+ *  The index is a hash table of node pointers. Each value is hashed from its type and the part of
+ *  value_t that type uses (a string by its characters), and its node goes in the first free slot
+ *  at or after the one the hash picks ("linear probing"). Finding a value means looking at the
+ *  slots from there on until one holds a matching node, or one is empty. Each slot also keeps its
+ *  node's hash, so most non-matching slots are skipped without even looking at the node. The table
+ *  doubles when it gets half full, so those runs of full slots stay short.
+ *
+ *  Pushing, appending, popping and removing from either end (and inserting or erasing at a
+ *  cursor) change the index along with the list. Anything that moves lots of nodes at once, like
+ *  list_concat or list_filter, just marks the index 'stale' instead, the same way list_get's
+ *  cached position gets forgotten; the next lookup then builds it again from scratch.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "list-internal.h"
+
+/* How many slots a new index has at least (always a power of 2) */
+#define LIST_INDEX_MIN_SLOTS 16
+
+/* index_hash(): value and type parameters, return its hash. Only the bytes the type uses are
+   looked at: a char only sets the first byte of the value_t, and the rest is whatever was there */
+static size_t index_hash(value_t v, value_type_t t){
+    uint64_t x;
+    switch(t){
+        case VAL_CHAR: x = (unsigned char) v.cval; break;
+        case VAL_INT: x = (unsigned int) v.ival; break;
+        case VAL_BOOL: x = v.bval ? 1 : 0; break;
+        case VAL_STR:{
+            size_t len;
+            x = intern_hash(v.sval, &len);
+            break;
+        }
+        default: x = 0; break;
+    }
+    /* mix the type in, then stir the bits so that nearby ints land far apart (the finishing
+       steps of the 'splitmix64' generator) */
+    x ^= (uint64_t) (t + 1) << 56;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return (size_t) x;
+}
+
+/* value_equal(): two values with their types, return true if they're the same value: the same
+   type, and equal in the part of value_t that type uses (strings by their characters) */
+bool value_equal(value_t a, value_type_t ta, value_t b, value_type_t tb){
+    if(ta != tb){
+        return false;
+    }
+    switch(ta){
+        case VAL_CHAR: return a.cval == b.cval;
+        case VAL_INT: return a.ival == b.ival;
+        case VAL_BOOL: return a.bval == b.bval;
+        case VAL_STR: return a.sval == b.sval || strcmp(a.sval, b.sval) == 0;
+        default: return false;
+    }
+}
+
+/* index_alloc(): index * and slot count parameters, return true if the index now has that many
+   empty slots (the old ones are the caller's to deal with) */
+static bool index_alloc(list_index_t *ix, size_t nslots){
+    list_index_slot_t *slots = calloc(nslots, sizeof(list_index_slot_t));
+    if(slots == NULL){
+        return false;
+    }
+    ix->slots = slots;
+    ix->mask = nslots - 1;
+    ix->count = 0;
+    return true;
+}
+
+/* index_put(): index *, node * and hash parameters, no return value; put the node in the first
+   free slot from its hash on. There has to be one */
+static void index_put(list_index_t *ix, node_t *n, size_t hash){
+    size_t i = hash & ix->mask;
+    while(ix->slots[i].node != NULL){
+        i = (i + 1) & ix->mask;
+    }
+    ix->slots[i].node = n;
+    ix->slots[i].hash = hash;
+    ix->count++;
+}
+
+/* index_grow(): index * parameter, return true if the slots were doubled. The hashes are kept in
+   the slots, so nothing has to be hashed again */
+static bool index_grow(list_index_t *ix){
+    list_index_slot_t *old = ix->slots;
+    size_t nold = ix->mask + 1;
+    if(!index_alloc(ix, nold * 2)){
+        return false;
+    }
+    for(size_t i = 0; i < nold; i++){
+        if(old[i].node != NULL){
+            index_put(ix, old[i].node, old[i].hash);
+        }
+    }
+    free(old);
+    return true;
+}
+
+/* index_new(): no parameters, return a new empty (and stale) index, or NULL if space can't be
+   allocated. The first lookup fills it in */
+list_index_t *index_new(){
+    list_index_t *ix = malloc(sizeof(list_index_t));
+    if(ix == NULL){
+        return NULL;
+    }
+    if(!index_alloc(ix, LIST_INDEX_MIN_SLOTS)){
+        free(ix);
+        return NULL;
+    }
+    ix->stale = true;
+    return ix;
+}
+
+/* index_free(): index * parameter, no return value */
+void index_free(list_index_t *ix){
+    if(ix == NULL){
+        return;
+    }
+    free(ix->slots);
+    free(ix);
+}
+
+/* index_forget(): index * parameter (NULL is fine), no return value; the list changed in a way
+   the index didn't follow, so it has to be built again before it's used */
+void index_forget(list_index_t *ix){
+    if(ix != NULL){
+        ix->stale = true;
+    }
+}
+
+/* index_add(): index * and node * parameters, no return value; the node was just added to the
+   list. If there's no room and no memory for more, the index goes stale instead */
+void index_add(list_index_t *ix, node_t *n){
+    if(ix == NULL || ix->stale){
+        return;
+    }
+    if(2 * (ix->count + 1) > ix->mask + 1 && !index_grow(ix)){
+        ix->stale = true;
+        return;
+    }
+    index_put(ix, n, index_hash(n->val, n->type));
+}
+
+/* index_remove(): index * and node * parameters, no return value; the node is about to leave the
+   list, and its value must still be readable. The slots after it are moved back to fill the
+   hole wherever that keeps them reachable ("backward shift"), so there's no need for markers
+   saying 'something was deleted here' */
+void index_remove(list_index_t *ix, node_t *n){
+    if(ix == NULL || ix->stale){
+        return;
+    }
+    size_t i = index_hash(n->val, n->type) & ix->mask;
+    while(ix->slots[i].node != n){
+        if(ix->slots[i].node == NULL){
+            return;     /* not there; can't happen unless the index is out of date */
+        }
+        i = (i + 1) & ix->mask;
+    }
+    size_t hole = i;
+    for(size_t j = (i + 1) & ix->mask; ix->slots[j].node != NULL; j = (j + 1) & ix->mask){
+        /* j's entry may move into the hole only if its home slot isn't between the hole and j */
+        size_t home = ix->slots[j].hash & ix->mask;
+        if(((j - home) & ix->mask) >= ((j - hole) & ix->mask)){
+            ix->slots[hole] = ix->slots[j];
+            hole = j;
+        }
+    }
+    ix->slots[hole].node = NULL;
+    ix->count--;
+}
+
+/* index_rebuild(): index * and list * parameters, return true if the index now holds every node
+   of the list, sized so it's at most half full */
+static bool index_rebuild(list_index_t *ix, list_t *l){
+    size_t nslots = LIST_INDEX_MIN_SLOTS;
+    while(nslots < 2 * (size_t) l->size){
+        nslots *= 2;
+    }
+    if(nslots != ix->mask + 1){
+        list_index_slot_t *old = ix->slots;
+        if(!index_alloc(ix, nslots)){
+            return false;
+        }
+        free(old);
+    }else{
+        memset(ix->slots, 0, nslots * sizeof(list_index_slot_t));
+        ix->count = 0;
+    }
+    for(node_t *curr_node = l->header->next; curr_node != l->header; curr_node = curr_node->next){
+        index_put(ix, curr_node, index_hash(curr_node->val, curr_node->type));
+    }
+    ix->stale = false;
+    return true;
+}
+
+/* index_find(): value, type and list * parameters, return a node of the list holding that value,
+   or NULL if there isn't one. *usable is false if the list has no index to use (or it was stale
+   and there was no memory to build it again), so the caller has to look for the value itself */
+node_t *index_find(value_t v, value_type_t t, list_t *l, bool *usable){
+    list_index_t *ix = l->index;
+    *usable = ix != NULL && (!ix->stale || index_rebuild(ix, l));
+    if(!*usable){
+        return NULL;
+    }
+    size_t hash = index_hash(v, t);
+    for(size_t i = hash & ix->mask; ix->slots[i].node != NULL; i = (i + 1) & ix->mask){
+        if(ix->slots[i].hash == hash && value_equal(ix->slots[i].node->val, ix->slots[i].node->type, v, t)){
+            return ix->slots[i].node;
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,196 @@
+/*
+ *  This file (list-intern.c) holds the string tables ("interning") for the linked list demo.
+ *
+ *  Normally every string in a list is its own copy, even when a million of them say the same
+ *  thing. A list that uses a string table instead keeps exactly one copy of each different string
+ *  in the table, and its values all point at that one copy. The table counts how many values
+ *  point at each string ('refs'), and frees a string once nothing points at it anymore.
+ *
+ *  Two nice things fall out of that:
+ *      - repeated strings cost one pointer each instead of a whole copy (and a malloc)
+ *      - two strings from the same table are equal exactly when their pointers are, so comparing
+ *        them doesn't even need strcmp
+ *  The price is that a table's strings are shared, so nobody may change their characters.
+ *
+ *  The table itself is a hash table: an array of 'buckets', each the start of a short chain of
+ *  entries whose hashes picked that bucket. It doubles in size when it holds more strings than it
+ *  has buckets, so the chains stay short. Like the lists themselves, a table isn't thread-safe.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "list-internal.h"
+
+/* How many buckets a new table starts with (always a power of 2) */
+#define LIST_INTERN_MIN_BUCKETS 64
+
+/* DEFINITION OF INTERN_STR_T STRUCT */
+/* One string in the table, with its characters stored right after the struct */
+typedef struct INTERN_STR{
+    struct INTERN_STR *next;    /* the next entry in the same bucket */
+    size_t hash;
+    size_t len;                 /* strlen(str), so a lookup never reads past a shorter entry */
+    long refs;
+    char str[];
+} intern_str_t;
+
+/* intern_entry(): string parameter, return the entry holding it. The string must have come from
+   a table: the entry sits right in front of its characters */
+static intern_str_t *intern_entry(const char *s){
+    return (intern_str_t *) (s - offsetof(intern_str_t, str));
+}
+
+/* intern_hash(): string and length * parameters, return the string's hash (FNV-1a), and put its
+   length in *len since we had to walk it anyway. The hash index (list-index.c) uses it too */
+size_t intern_hash(const char *s, size_t *len){
+    uint64_t h = 14695981039346656037ull;
+    const unsigned char *p = (const unsigned char *) s;
+    for(; *p != '\0'; p++){
+        h = (h ^ *p) * 1099511628211ull;
+    }
+    *len = (size_t) (p - (const unsigned char *) s);
+    return (size_t) h;
+}
+
+/* intern_grow(): table * parameter, no return value; double the bucket array and move every entry
+   to its new bucket. If there's no memory for that, the table just stays as it is (slower, but
+   still right) */
+static void intern_grow(list_intern_t *t){
+    size_t nbuckets = t->nbuckets * 2;
+    intern_str_t **buckets = calloc(nbuckets, sizeof(intern_str_t *));
+    if(buckets == NULL){
+        return;
+    }
+    for(size_t i = 0; i < t->nbuckets; i++){
+        intern_str_t *e = t->buckets[i];
+        while(e != NULL){
+            intern_str_t *next = e->next;
+            size_t b = e->hash & (nbuckets - 1);
+            e->next = buckets[b];
+            buckets[b] = e;
+            e = next;
+        }
+    }
+    free(t->buckets);
+    t->buckets = buckets;
+    t->nbuckets = nbuckets;
+}
+
+/* list_intern_new(): no parameters, return a pointer to a new, empty string table, or NULL if
+   space can't be allocated */
+list_intern_t *list_intern_new(){
+    list_intern_t *t = malloc(sizeof(list_intern_t));
+    if(t == NULL){
+        return NULL;
+    }
+    t->buckets = calloc(LIST_INTERN_MIN_BUCKETS, sizeof(intern_str_t *));
+    if(t->buckets == NULL){
+        free(t);
+        return NULL;
+    }
+    t->nbuckets = LIST_INTERN_MIN_BUCKETS;
+    t->count = 0;
+    t->users = 1;
+    return t;
+}
+
+/* intern_drop(): table * parameter, no return value; one fewer user. The last one frees the table
+   (by then every list using it is gone, so every string is too) */
+void intern_drop(list_intern_t *t){
+    if(t == NULL || --t->users > 0){
+        return;
+    }
+    for(size_t i = 0; i < t->nbuckets; i++){
+        intern_str_t *e = t->buckets[i];
+        while(e != NULL){
+            intern_str_t *next = e->next;
+            free(e);
+            e = next;
+        }
+    }
+    free(t->buckets);
+    free(t);
+}
+
+/* list_intern_free(): table * parameter, no return value; let go of a table made with
+   list_intern_new. Lists still using it keep it alive until they're freed too */
+void list_intern_free(list_intern_t *t){
+    intern_drop(t);
+}
+
+/* intern_lookup(): string, hash, length and table * parameters, return the entry holding that
+   string, or NULL if there isn't one */
+static intern_str_t *intern_lookup(const char *s, size_t hash, size_t len, list_intern_t *t){
+    for(intern_str_t *e = t->buckets[hash & (t->nbuckets - 1)]; e != NULL; e = e->next){
+        if(e->hash == hash && e->len == len && memcmp(e->str, s, len) == 0){
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* intern_acquire(): string, table * and bool * parameters, return the table's copy of the string
+   with one more reference to it, or NULL if it's new and space can't be allocated. *added says
+   whether a new copy had to be made */
+char *intern_acquire(const char *s, list_intern_t *t, bool *added){
+    size_t len;
+    size_t hash = intern_hash(s, &len);
+    intern_str_t *e = intern_lookup(s, hash, len, t);
+    *added = e == NULL;
+    if(e == NULL){
+        e = malloc(sizeof(intern_str_t) + len + 1);
+        if(e == NULL){
+            return NULL;
+        }
+        e->hash = hash;
+        e->len = len;
+        e->refs = 0;
+        memcpy(e->str, s, len + 1);
+        size_t b = hash & (t->nbuckets - 1);
+        e->next = t->buckets[b];
+        t->buckets[b] = e;
+        if(++t->count > t->nbuckets){
+            intern_grow(t);
+        }
+    }
+    e->refs++;
+    return e->str;
+}
+
+/* intern_release(): string and table * parameters, return true if that was the last reference
+   and the string was freed. The string must be the table's own copy */
+bool intern_release(char *s, list_intern_t *t){
+    intern_str_t *e = intern_entry(s);
+    if(--e->refs > 0){
+        return false;
+    }
+    /* unhook it from its bucket's chain */
+    intern_str_t **link = &t->buckets[e->hash & (t->nbuckets - 1)];
+    while(*link != e){
+        link = &(*link)->next;
+    }
+    *link = e->next;
+    t->count--;
+    free(e);
+    return true;
+}
+
+/* list_intern_find(): string and table * parameters, return the table's copy of the string (which
+   compares equal, by pointer, to every value of that string in lists using the table), or NULL
+   if no list holds that string right now. Nothing is added to the table */
+const char *list_intern_find(const char *s, list_intern_t *t){
+    if(s == NULL || t == NULL){
+        return NULL;
+    }
+    size_t len;
+    size_t hash = intern_hash(s, &len);
+    intern_str_t *e = intern_lookup(s, hash, len, t);
+    return e != NULL ? e->str : NULL;
+}
+
+/* list_intern_count(): table * parameter, return how many different strings it holds */
+size_t list_intern_count(list_intern_t *t){
+    return t != NULL ? t->count : 0;
+}
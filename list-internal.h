@@ -0,0 +1,327 @@
+/*
+ *  This file (list-internal.h) is a header file that only the list's own .c files include. Each
+ *  list mode other than LIST_CHAIN lives in its own .c file, and the functions in list.h call
+ *  into it when a list uses that mode. list-parallel.c (the bulk traversal functions) and
+ *  list-simd.c (search kernels) use it too. It also has the layouts of the structs list_t only
+ *  points at (node pools, unrolled nodes, string tables, hash indexes and skip layers).
+ *  Users of the list should stick to list.h.
+ *
+ */
+
+#ifndef LIST_INTERNAL_H
+#define LIST_INTERNAL_H
+
+#include "list.h"
+
+/* LAYOUTS OF THE STRUCTS LIST_T POINTS AT */
+/* (list.h only declares these) */
+
+/* DEFINITION OF NODE_BLOCK_T STRUCT */
+/* Rather than calling malloc once per node, each list carves its nodes out of bigger 'blocks' of
+   memory. A block remembers how many nodes it holds, how many have been handed out so far, and
+   the next block so we can free them all at the end */
+typedef struct NODE_BLOCK{
+    struct NODE_BLOCK *next;
+    size_t capacity;
+    size_t used;
+    node_t nodes[];     /* a 'flexible array member': the nodes live right after the struct */
+} node_block_t;
+
+/* DEFINITION OF NODE_POOL_T STRUCT */
+/* A pool is the list's node allocator. Nodes that get removed are put on the free list (chained
+   through their own 'next' pointers) so the next push or append can reuse them.
+   Once lists start trading nodes (list_concat, list_splice, list_split_at), a node may live in a
+   different list than the pool it came from, so those lists share one pool: 'refs' counts the
+   lists using it, and the blocks are only freed when the last one is done. When two lists with
+   different pools trade nodes, one pool takes over the other's blocks and the emptied pool
+   remembers where they went in 'merged_into' */
+struct NODE_POOL{
+    node_block_t *blocks;       /* every block we've allocated, newest first */
+    node_block_t *blocks_tail;  /* the oldest block, so another pool's blocks can be added on */
+    node_t *free_nodes;         /* removed nodes waiting to be reused */
+    node_t *free_tail;          /* the last of those, for the same reason */
+    int refs;
+    struct NODE_POOL *merged_into;
+    arena_t *arena;             /* where blocks come from, or NULL for malloc */
+#ifdef LIST_STATS
+    list_stats_t stats;         /* only allocs is used: the blocks this pool asked malloc for */
+#endif
+};
+
+/* DEFINITION OF UNODE_T STRUCT */
+/* An 'unrolled' node holds a small array of values instead of just one, so a list of n values
+   only needs about n / LIST_UNROLL_SIZE nodes (and that many prev/next pointers). The used slots
+   are always next to each other: they start at 'first' and there are 'count' of them */
+struct UNODE{
+    struct UNODE *prev;
+    struct UNODE *next;
+    int first;
+    int count;
+    /* one-byte value_type_t tags, kept apart from the values: a search for one type only has to
+       read these 16 bytes, not the 128 bytes of values */
+    int8_t tags[LIST_UNROLL_SIZE];
+    value_t vals[LIST_UNROLL_SIZE];
+};
+
+/* DEFINITION OF LIST_INTERN_T STRUCT */
+/* A string table: one shared copy of each different string, for every list that uses the table
+   (see list-intern.c). 'users' counts those lists, plus one for whoever made the table with
+   list_intern_new until they call list_intern_free */
+struct LIST_INTERN{
+    struct INTERN_STR **buckets;
+    size_t nbuckets;
+    size_t count;       /* how many different strings it holds */
+    int users;
+};
+
+/* DEFINITION OF LIST_INDEX_T STRUCT */
+/* A hash index of a list's nodes by value, so finding one doesn't mean walking the list (see
+   list-index.c). Each slot holds a node (NULL if the slot is free) and the hash of its value;
+   'stale' means the list changed in a way the index didn't keep up with, and it has to be built
+   again before it can be used */
+typedef struct{
+    size_t hash;
+    node_t *node;
+} list_index_slot_t;
+
+struct LIST_INDEX{
+    list_index_slot_t *slots;
+    size_t mask;        /* how many slots there are, minus one (there's always a power of 2) */
+    size_t count;       /* how many of them hold a node */
+    bool stale;
+};
+
+/* DEFINITION OF SKIP_ENTRY_T, SKIP_BLOCK_T AND LIST_SKIP_T STRUCTS */
+/* A skip layer: a few levels of linked lists over a list's nodes, each with about a quarter of
+   the entries of the level below, so list_get can skip most of the chain (see list-skip.c). An
+   entry knows how many nodes on its 'width' it is from the next entry on its level, and 'down'
+   is the same node's entry one level lower. Index i is at position base + i; each level knows
+   where its first and last entries are */
+#define LIST_SKIP_LEVELS 16
+#define LIST_SKIP_BLOCK 256
+
+typedef struct SKIP_ENTRY{
+    struct SKIP_ENTRY *next;
+    struct SKIP_ENTRY *prev;
+    struct SKIP_ENTRY *down;
+    node_t *node;
+    long width;
+} skip_entry_t;
+
+typedef struct SKIP_BLOCK{
+    struct SKIP_BLOCK *next;
+    int used;
+    skip_entry_t entries[LIST_SKIP_BLOCK];
+} skip_block_t;
+
+struct LIST_SKIP{
+    skip_entry_t *first[LIST_SKIP_LEVELS];
+    skip_entry_t *last[LIST_SKIP_LEVELS];
+    long first_pos[LIST_SKIP_LEVELS];
+    long last_pos[LIST_SKIP_LEVELS];
+    long base;
+    int levels;                 /* how many levels have been used */
+    uint64_t rng;               /* where the random heights come from */
+    bool stale;                 /* the list changed in a way the layer didn't follow */
+    skip_block_t *blocks;
+    skip_entry_t *free_entries;
+};
+
+/* COUNTERS */
+/* LIST_STAT_ADD(x, field, n) adds n to x's stats.field, and LIST_STAT_GROW(l) records a new
+   largest size. Without -DLIST_STATS they turn into nothing, and 'n' is never even evaluated,
+   so it's fine to pass something like strlen(s) + 1 */
+#ifdef LIST_STATS
+#define LIST_STAT_ADD(x, field, n) ((x)->stats.field += (n))
+#define LIST_STAT_GROW(l) \
+    do{ if((l)->size > (l)->stats.max_size) (l)->stats.max_size = (l)->size; }while(0)
+#else
+#define LIST_STAT_ADD(x, field, n) ((void) (x))
+#define LIST_STAT_GROW(l) ((void) 0)
+#endif
+
+/* SHARED HELPERS (linkedlist-ref.c) */
+
+/* list_park_str(): list * and malloc'd string parameters, return the string after handing it to
+   the list to hold until the next removal (see popped_str in list.h) */
+char *list_park_str(list_t *, char *);
+
+/* list_release_nodes(): list * and two node * parameters, no return value; give a run of nodes
+   that are already out of the list, chained together through 'next' from the first to the last,
+   back to the list's pool. Whatever they owned must be dealt with first */
+void list_release_nodes(list_t *, node_t *, node_t *);
+
+/* The four ways a string gets into or out of a list, for lists with or without a string table:
+       - list_copy_str(): list * and string parameters, return the list's own copy of the string
+         (malloc'd, or a new reference to the table's copy), or NULL if space can't be allocated
+       - list_own_str(): list * and malloc'd string parameters, return the string the list should
+         keep after being handed that one: the string itself, or the table's copy (and then the
+         given one is freed). NULL if space can't be allocated; the string is still the caller's
+       - list_export_str(): list * and string parameters, return a string the caller can keep and
+         free, in place of one the list is giving up: the string itself, or a malloc'd copy of the
+         table's (whose reference is dropped). NULL if space can't be allocated; nothing changes
+       - list_free_str(): list * and string parameters, no return value; free the list's string,
+         or drop its reference to the table's copy */
+char *list_copy_str(list_t *, const char *);
+char *list_own_str(list_t *, char *);
+char *list_export_str(list_t *, char *);
+void list_free_str(list_t *, char *);
+
+/* list_walk(): list *, callback and extra pointer parameters, no return value; call the callback
+   on every value from front to back, whatever the list's mode */
+void list_walk(list_t *, void (*)(value_t, value_type_t, void *), void *);
+
+/* STRING TABLES (list-intern.c) */
+
+/* intern_acquire(): string, table * and bool * parameters, return the table's copy of the string
+   with one more reference, or NULL if space can't be allocated; *added says if it was new */
+char *intern_acquire(const char *, list_intern_t *, bool *);
+/* intern_release(): string and table * parameters, return true if that was the last reference and
+   the string is gone */
+bool intern_release(char *, list_intern_t *);
+/* intern_drop(): table * parameter, no return value; one fewer list (or owner) using the table */
+void intern_drop(list_intern_t *);
+/* intern_hash(): string and length * parameters, return the string's hash, and put its length in
+   *len */
+size_t intern_hash(const char *, size_t *);
+
+/* HASH INDEX (list-index.c) */
+/* All of these but index_find take the list's index pointer, and do nothing if it's NULL */
+
+/* index_new(): no parameters, return a new index, empty and stale, or NULL if space can't be
+   allocated */
+list_index_t *index_new();
+/* index_free(): index * parameter, no return value */
+void index_free(list_index_t *);
+/* index_add(): index * and node * parameters, no return value; the node was just linked in */
+void index_add(list_index_t *, node_t *);
+/* index_remove(): index * and node * parameters, no return value; the node is about to be unlinked
+   (its value has to still be readable, so call this before giving up a string) */
+void index_remove(list_index_t *, node_t *);
+/* index_forget(): index * parameter, no return value; mark the index stale, after a change it
+   didn't follow */
+void index_forget(list_index_t *);
+/* index_find(): value, type, list * and bool * parameters, return a node holding the value, or
+   NULL; *usable is false if there's no index to ask, and the list has to be searched instead */
+node_t *index_find(value_t, value_type_t, list_t *, bool *);
+/* value_equal(): two values with their types, return true if they're the same value */
+bool value_equal(value_t, value_type_t, value_t, value_type_t);
+
+/* SKIP LAYER (list-skip.c) */
+/* These do nothing for a list without a skip layer (or a stale one) */
+
+/* skip_new(): no parameters, return a new skip layer, empty and stale, or NULL if space can't be
+   allocated */
+list_skip_t *skip_new();
+/* skip_free(): skip layer * parameter, no return value */
+void skip_free(list_skip_t *);
+/* skip_forget(): skip layer * parameter, no return value; mark the layer stale */
+void skip_forget(list_skip_t *);
+/* skip_inserted(): list *, node * and index parameters, no return value; the node was just linked
+   in at that index, and l->size counts it */
+void skip_inserted(list_t *, node_t *, int);
+/* skip_removed(): list *, node * and index parameters, no return value; the node at that index is
+   about to be unlinked, and l->size still counts it */
+void skip_removed(list_t *, node_t *, int);
+/* skip_node_at(): index, walk length and list * parameters, return the node at that index, or NULL
+   if the caller should walk there along the chain instead */
+node_t *skip_node_at(int, int, list_t *);
+
+/* LIST_UNROLLED MODE (list-unrolled.c) */
+/* These mirror the functions in list.h, but they can assume the list pointer is good and that
+   the list really is unrolled */
+
+bool ulist_init(list_t *);
+void ulist_free(list_t *);
+void ulist_push(value_t, value_type_t, list_t *);
+void ulist_append(value_t, value_type_t, list_t *);
+bool ulist_push_owned(char *, list_t *);
+bool ulist_append_owned(char *, list_t *);
+/* the bool says whether a string should be handed to the caller (true) or parked (false) */
+value_t ulist_remove_first(list_t *, bool);
+value_t ulist_remove_last(list_t *, bool);
+value_t ulist_get(int, list_t *);
+value_type_t ulist_get_type(int, list_t *);
+int ulist_count_type(value_type_t, list_t *);
+/* the starting index must be valid */
+int ulist_find_type(value_type_t, int, list_t *);
+int ulist_find_int(int, int, list_t *);
+int ulist_find_char(char, int, list_t *);
+/* true if the value (compared with value_equal) is anywhere in the list */
+bool ulist_contains(value_t, value_type_t, list_t *);
+/* moves all of the second list's values to the end of the first */
+void ulist_concat(list_t *, list_t *);
+/* moves the values from the index onward into the second list, which must be empty */
+bool ulist_split(list_t *, int, list_t *);
+/* calls the function on every value from front to back, passing the extra pointer along */
+void ulist_foreach(list_t *, void (*)(value_t, value_type_t, void *), void *);
+/* sorts the values (the list holds at least two); false if the temporary array can't be
+   allocated */
+bool ulist_sort(list_cmp_fn, void *, list_t *);
+/* unlinks every node that has no values left (list_filter empties nodes without unlinking them) */
+void ulist_drop_empty(list_t *);
+
+/* LIST_RING MODE (list-ring.c) */
+/* The same idea again: the list pointer is good and the list really is a ring. Indices are
+   checked by the caller, except in rlist_remove_at, which hands back a NULL value for a bad one */
+
+bool rlist_init(list_t *);
+void rlist_free(list_t *);
+/* true if there's room for that many more values now, so adding them won't allocate */
+bool rlist_reserve(list_t *, int);
+/* pushing and appending are inserting at index 0 and at the size */
+bool rlist_insert_at(int, value_t, value_type_t, list_t *);
+bool rlist_insert_owned(int, char *, list_t *);
+/* the bool says whether a string should be handed to the caller (true) or parked (false) */
+value_t rlist_remove_at(int, list_t *, bool);
+/* removes the value at the index, freeing its string */
+void rlist_discard_at(int, list_t *);
+value_t rlist_get(int, list_t *);
+value_type_t rlist_get_type(int, list_t *);
+int rlist_count_type(value_type_t, list_t *);
+int rlist_find_type(value_type_t, int, list_t *);
+int rlist_find_int(int, int, list_t *);
+int rlist_find_char(char, int, list_t *);
+/* the index of the first value equal to this one (compared with value_equal), or -1 */
+int rlist_find_value(value_t, value_type_t, list_t *);
+/* moves all of the second list's values to the end of the first; false if there's no memory */
+bool rlist_concat(list_t *, list_t *);
+/* moves the values from the index onward into the second list, which must be empty */
+bool rlist_split(list_t *, int, list_t *);
+void rlist_foreach(list_t *, void (*)(value_t, value_type_t, void *), void *);
+bool rlist_sort(list_cmp_fn, void *, list_t *);
+/* moves the values to a smaller array if most of the slots are empty (after list_filter) */
+void rlist_fit(list_t *);
+
+/* SORTING (list-sort.c) */
+
+/* one value on its way through sort_items */
+typedef struct{
+    value_t val;
+    value_type_t type;
+} sort_item_t;
+
+/* sort_items(): item array, spare array of the same length, count, comparator and extra pointer
+   parameters, return whichever of the two arrays ends up holding the items, stably sorted. This
+   is how lists that keep their values in arrays (unrolled and ring lists) sort a copy of them */
+sort_item_t *sort_items(sort_item_t *, sort_item_t *, size_t, list_cmp_fn, void *);
+
+/* SEARCH KERNELS (list-simd.c) */
+/* Each returns a mask with bit i set when slot i of the node holds a matching value */
+
+unsigned int unode_match_type(const unode_t *, value_type_t);
+unsigned int unode_match_int(const unode_t *, int);
+unsigned int unode_match_char(const unode_t *, char);
+
+/* which kernels to use: the best the CPU can do (the default), or a particular kind, for
+   comparing them (see bench-simd.c) */
+#define LIST_SIMD_SCALAR 0
+#define LIST_SIMD_SSE2 1
+#define LIST_SIMD_AVX2 2
+#define LIST_SIMD_BEST LIST_SIMD_AVX2
+
+/* list_simd_use(): level parameter, return the level actually in use (lower if the CPU can't do
+   the one asked for) */
+int list_simd_use(int);
+
+#endif /* LIST_INTERNAL_H */
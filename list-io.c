@@ -0,0 +1,304 @@
+/*
+ *  This file (list-io.c) holds list_save, list_load and the read-only list views for the linked
+ *  list demo.
+ *
+ *  A saved list is one file with four parts, one after the other:
+ *      - a header (list_file_header_t below): what kind of file this is, how many values it
+ *        holds, and how big its string heap is
+ *      - the type tags, one byte per value, padded with zeros to a multiple of 8 bytes
+ *      - the values, 8 bytes each: a char, int or bool is widened to 64 bits, and a string is
+ *        replaced by where it starts in the string heap
+ *      - the string heap: every string, with its null terminator, one after the other
+ *  The numbers are written the way this machine stores them in memory, so a file can only be
+ *  read back on a machine that agrees (the header says which way that was).
+ *
+ *  Because every part has a fixed place, a list_view_t can map the file straight into memory with
+ *  mmap and answer list_view_get(i) by looking at position i of each part: nothing is copied or
+ *  allocated per value, and strings point right into the mapped heap.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "list-internal.h"
+
+/* DEFINITION OF LIST_FILE_HEADER_T STRUCT */
+/* The first 32 bytes of a saved list */
+typedef struct{
+    char magic[4];          /* always "LST1" */
+    uint32_t byte_order;    /* LIST_FILE_BYTE_ORDER, as the saving machine stored it */
+    uint64_t count;         /* how many values */
+    uint64_t heap_bytes;    /* how big the string heap is */
+    uint64_t reserved;      /* zero for now; keeps the tags starting on an 8-byte boundary */
+} list_file_header_t;
+
+#define LIST_FILE_MAGIC "LST1"
+/* reads back as 0x04030201 on a machine that stores numbers the other way around */
+#define LIST_FILE_BYTE_ORDER 0x01020304u
+
+/* Values are gathered in batches of this many before being written (or appended, when loading) */
+#define LIST_IO_BATCH 512
+
+/* tags_bytes(): value count parameter, return how many bytes the tags take, padding included */
+static size_t tags_bytes(size_t count){
+    return (count + 7) & ~(size_t) 7;
+}
+
+/* SAVING */
+
+/* Saving goes through the list three times, once per part, and each pass sends its bytes through
+   one of these so that write() is called once per buffer-full instead of once per value */
+typedef struct{
+    int fd;
+    bool failed;
+    size_t used;
+    uint64_t heap_at;       /* where the next string goes in the heap */
+    char buf[LIST_IO_BATCH * sizeof(uint64_t)];
+} list_writer_t;
+
+/* writer_flush(): writer * parameter, no return value; write out everything buffered so far.
+   write() may write less than it was asked to, or be interrupted, so we keep going until it's
+   all written (or something really goes wrong) */
+static void writer_flush(list_writer_t *w){
+    size_t done = 0;
+    while(!w->failed && done < w->used){
+        ssize_t n = write(w->fd, w->buf + done, w->used - done);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            w->failed = true;
+        }else{
+            done += (size_t) n;
+        }
+    }
+    w->used = 0;
+}
+
+/* writer_put(): writer *, bytes and length parameters, no return value */
+static void writer_put(list_writer_t *w, const void *bytes, size_t len){
+    const char *p = bytes;
+    while(len > 0 && !w->failed){
+        if(w->used == sizeof(w->buf)){
+            writer_flush(w);
+        }
+        size_t room = sizeof(w->buf) - w->used;
+        size_t n = len < room ? len : room;
+        memcpy(w->buf + w->used, p, n);
+        w->used += n;
+        p += n;
+        len -= n;
+    }
+}
+
+/* the callbacks for the three passes, and one to add up the heap's size beforehand */
+
+static void count_heap(value_t v, value_type_t t, void *arg){
+    if(t == VAL_STR){
+        *(uint64_t *) arg += strlen(v.sval) + 1;
+    }
+}
+
+static void put_tag(value_t v, value_type_t t, void *arg){
+    (void) v;
+    int8_t tag = (int8_t) t;
+    writer_put(arg, &tag, 1);
+}
+
+static void put_value(value_t v, value_type_t t, void *arg){
+    list_writer_t *w = arg;
+    uint64_t bits = 0;
+    switch(t){
+        case VAL_CHAR: bits = (uint64_t) (int64_t) v.cval; break;
+        case VAL_INT: bits = (uint64_t) (int64_t) v.ival; break;
+        case VAL_BOOL: bits = v.bval; break;
+        case VAL_STR:
+            bits = w->heap_at;
+            w->heap_at += strlen(v.sval) + 1;
+            break;
+        default: break;
+    }
+    writer_put(w, &bits, sizeof(bits));
+}
+
+static void put_string(value_t v, value_type_t t, void *arg){
+    if(t == VAL_STR){
+        writer_put(arg, v.sval, strlen(v.sval) + 1);
+    }
+}
+
+/* list_save(): file descriptor and list * parameters, return true if the whole list was written
+   to the file (starting wherever the file's position is). The file isn't closed */
+bool list_save(int fd, list_t *l){
+    if(!l || fd < 0){
+        return false;
+    }
+    list_writer_t writer;
+    list_writer_t *w = &writer;
+    w->fd = fd;
+    w->failed = false;
+    w->used = 0;
+    w->heap_at = 0;
+
+    list_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LIST_FILE_MAGIC, sizeof(header.magic));
+    header.byte_order = LIST_FILE_BYTE_ORDER;
+    header.count = (uint64_t) l->size;
+    list_walk(l, count_heap, &header.heap_bytes);
+    writer_put(w, &header, sizeof(header));
+
+    list_walk(l, put_tag, w);
+    static const char zeros[8] = {0};
+    writer_put(w, zeros, tags_bytes(l->size) - (size_t) l->size);
+    list_walk(l, put_value, w);
+    list_walk(l, put_string, w);
+    writer_flush(w);
+
+    return !w->failed;
+}
+
+/* VIEWS */
+
+/* list_view_open(): file path parameter, return a pointer to a read-only view of the list saved
+   in that file, or NULL if it can't be opened or isn't a saved list (or is damaged) */
+list_view_t *list_view_open(const char *path){
+    if(!path){
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return NULL;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(list_file_header_t)){
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t) st.st_size;
+    /* the mapping stays good after the file is closed */
+    void *base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED){
+        return NULL;
+    }
+
+    /* check the header, then that the parts add up to exactly the file's size */
+    const list_file_header_t *header = base;
+    uint64_t count = header->count;
+    uint64_t heap_bytes = header->heap_bytes;
+    size_t body = len - sizeof(list_file_header_t);
+    if(memcmp(header->magic, LIST_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+       header->byte_order != LIST_FILE_BYTE_ORDER || count > (uint64_t) INT32_MAX ||
+       heap_bytes > body ||
+       tags_bytes(count) + count * sizeof(uint64_t) != body - heap_bytes){
+        munmap(base, len);
+        return NULL;
+    }
+    const int8_t *tags = (const int8_t *) (header + 1);
+    const uint64_t *vals = (const uint64_t *) (tags + tags_bytes(count));
+    const char *heap = (const char *) (vals + count);
+
+    /* every tag must be a real type, and every string must start inside the heap; since the
+       heap has to end in a null terminator, every string also ends inside it */
+    bool good = heap_bytes == 0 || heap[heap_bytes - 1] == '\0';
+    for(uint64_t i = 0; good && i < count; i++){
+        if(tags[i] < VAL_CHAR || tags[i] > VAL_STR || (tags[i] == VAL_STR && vals[i] >= heap_bytes)){
+            good = false;
+        }
+    }
+    list_view_t *view = good ? malloc(sizeof(list_view_t)) : NULL;
+    if(view == NULL){
+        munmap(base, len);
+        return NULL;
+    }
+    view->base = base;
+    view->len = len;
+    view->size = (int) count;
+    view->tags = tags;
+    view->vals = vals;
+    view->heap = heap;
+    return view;
+}
+
+/* list_view_close(): list_view * parameter, no return value; unmap the file and free the view.
+   Strings from list_view_get are no good afterwards */
+void list_view_close(list_view_t *view){
+    if(!view){
+        return;
+    }
+    munmap(view->base, view->len);
+    free(view);
+}
+
+/* list_view_size(): list_view * parameter, return how many values it holds */
+int list_view_size(const list_view_t *view){
+    return view ? view->size : 0;
+}
+
+/* list_view_get_type(): int and list_view * parameters, return the type at the given index
+   (VAL_NONE if there's no such index) */
+value_type_t list_view_get_type(int index, const list_view_t *view){
+    if(!view || index < 0 || index >= view->size){
+        return VAL_NONE;
+    }
+    return view->tags[index];
+}
+
+/* list_view_get(): int and list_view * parameters, return the value at the given index. A string
+   points into the mapped file, so it's read-only and lasts until list_view_close */
+value_t list_view_get(int index, const list_view_t *view){
+    value_t v;
+    v.sval = NULL;
+    if(!view || index < 0 || index >= view->size){
+        return v;
+    }
+    uint64_t bits = view->vals[index];
+    switch(view->tags[index]){
+        case VAL_CHAR: v.cval = (char) bits; break;
+        case VAL_INT: v.ival = (int) (int64_t) bits; break;
+        case VAL_BOOL: v.bval = bits != 0; break;
+        case VAL_STR: v.sval = (char *) view->heap + bits; break;
+        default: break;
+    }
+    return v;
+}
+
+/* LOADING */
+
+/* list_load(): file path parameter, return a pointer to a new (LIST_CHAIN) list holding the
+   values saved in that file, or NULL if it can't be read or any space can't be allocated. The
+   file is read through a view, and the values are added in batches with list_append_array */
+list_t *list_load(const char *path){
+    list_view_t *view = list_view_open(path);
+    if(view == NULL){
+        return NULL;
+    }
+    list_t *l = list_new_with_capacity(view->size);
+    if(l == NULL){
+        list_view_close(view);
+        return NULL;
+    }
+    value_t vals[LIST_IO_BATCH];
+    value_type_t types[LIST_IO_BATCH];
+    for(int i = 0; i < view->size; i += LIST_IO_BATCH){
+        size_t n = (size_t) (view->size - i) < LIST_IO_BATCH ? (size_t) (view->size - i) : LIST_IO_BATCH;
+        for(size_t j = 0; j < n; j++){
+            vals[j] = list_view_get(i + (int) j, view);
+            types[j] = view->tags[i + j];
+        }
+        if(list_append_array(vals, types, n, l) != n){
+            list_free(l);
+            list_view_close(view);
+            return NULL;
+        }
+    }
+    list_view_close(view);
+    return l;
+}
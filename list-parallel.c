@@ -0,0 +1,482 @@
+/*
+ *  This file (list-parallel.c) holds list_reduce, list_map_inplace and list_filter for the linked
+ *  list demo.
+ *
+ *  Doing something to every value with a list_get loop is slow, because list_get has to find its
+ *  way to each index. These functions walk the nodes directly instead, once. On top of that, a big
+ *  list is cut into a few pieces ("chunks") that separate threads handle at the same time:
+ *      - for a LIST_CHAIN list, one quick walk along the 'next' pointers finds where each chunk
+ *        starts; the chunks hold (nearly) the same number of values.
+ *      - for a LIST_UNROLLED list the same walk only has to visit one node per LIST_UNROLL_SIZE
+ *        values, and each chunk is a run of whole nodes.
+ *      - a LIST_RING list needs no walk at all: a chunk is just a range of indices.
+ *  The threads only ever touch the nodes of their own chunk. Anything that affects the whole list
+ *  (joining results, relinking around removed nodes, handing nodes back to the pool, which isn't
+ *  thread-safe) is done by the calling thread once every chunk is finished, going through the
+ *  chunks in order. The number of chunks depends only on the list's size, so the answer comes out
+ *  the same no matter how many CPUs there are.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>     /* sysconf(), to ask how many CPUs there are */
+
+#include "list-internal.h"
+
+/* which of the three functions a chunk is doing */
+typedef enum{
+    JOB_REDUCE,
+    JOB_MAP,
+    JOB_FILTER
+} job_kind_t;
+
+/* the parts of a call that every chunk shares */
+typedef struct{
+    job_kind_t kind;
+    unsigned int mask;
+    void *arg;
+    list_reduce_fn reduce;
+    list_map_fn map;
+    list_keep_fn keep;
+    value_t init;
+    list_t *list;           /* how a filter's strings are freed, and where a ring's values are */
+} job_t;
+
+/* One chunk: where it starts and how long it is (in values for a chain or ring list, in nodes for
+   an unrolled one), plus what came out of it */
+typedef struct{
+    const job_t *job;
+    list_mode_t mode;
+    node_t *first;          /* NULL: starts wherever the chunk before it ended */
+    unode_t *ufirst;
+    int start;              /* a ring list's chunks start at an index instead */
+    int count;
+    node_t *after;          /* the node right after the chunk, once it has run */
+    value_t result;         /* JOB_REDUCE */
+    int removed;            /* JOB_FILTER, from here down */
+    long long str_bytes;    /* string bytes freed */
+    long long str_frees;    /* heap strings freed */
+    node_t *kept_first;     /* the chunk's remaining nodes, linked to each other... */
+    node_t *kept_last;      /* ...but not yet to the rest of the list */
+    node_t *dead_first;     /* removed nodes, chained through 'next' */
+    node_t *dead_last;
+} chunk_t;
+
+/* job_wants(): job * and value type parameters, return true if the job's mask includes the type */
+static bool job_wants(const job_t *job, value_type_t t){
+    return t >= 0 && (job->mask & LIST_TYPE_BIT(t)) != 0;
+}
+
+/* chunk_free_str(): chunk * and string parameters, no return value; free a removed value's string
+   (unless it lives inside its node or in an arena) and count it. A string table's copy is only
+   let go of, and that's never done by more than one thread (see list_filter) */
+static void chunk_free_str(chunk_t *c, char *s, bool in_node){
+    list_t *l = c->job->list;
+    c->str_bytes += strlen(s) + 1;
+    if(l->intern != NULL){
+        intern_release(s, l->intern);
+    }else if(!in_node && l->arena == NULL){
+        free(s);
+        c->str_frees++;
+    }
+}
+
+/* chunk_run_chain(): chunk * parameter, no return value; do the job on a chunk of a chain list */
+static void chunk_run_chain(chunk_t *c){
+    const job_t *job = c->job;
+    node_t *n = c->first;
+    for(int i = 0; i < c->count; i++){
+        node_t *next = n->next;     /* saved first: a filter relinks 'n' below */
+        value_type_t t = n->type;
+        bool wanted = job_wants(job, t);
+        switch(job->kind){
+            case JOB_REDUCE:
+                if(wanted){
+                    c->result = job->reduce(c->result, n->val, t, job->arg);
+                }
+                break;
+            case JOB_MAP:
+                if(wanted){
+                    char *s = n->val.sval;
+                    job->map(&n->val, t, job->arg);
+                    if(t == VAL_STR){
+                        n->val.sval = s;    /* the string itself may change, the pointer can't */
+                    }
+                }
+                break;
+            case JOB_FILTER:
+                if(wanted && !job->keep(n->val, t, job->arg)){
+                    if(t == VAL_STR){
+                        chunk_free_str(c, n->val.sval, n->val.sval == n->small_str);
+                    }
+                    if(c->dead_first == NULL){
+                        c->dead_first = n;
+                    }else{
+                        c->dead_last->next = n;
+                    }
+                    c->dead_last = n;
+                    c->removed++;
+                }else{
+                    if(c->kept_first == NULL){
+                        c->kept_first = n;
+                    }else{
+                        c->kept_last->next = n;
+                        n->prev = c->kept_last;
+                    }
+                    c->kept_last = n;
+                }
+                break;
+        }
+        n = next;
+    }
+    c->after = n;
+}
+
+/* chunk_run_unrolled(): chunk * parameter, no return value; do the job on a chunk of an unrolled
+   list. A filter squeezes each node's remaining values together, and leaves emptied nodes for
+   ulist_drop_empty */
+static void chunk_run_unrolled(chunk_t *c){
+    const job_t *job = c->job;
+    unode_t *n = c->ufirst;
+    for(int i = 0; i < c->count; i++, n = n->next){
+        int end = n->first + n->count;
+        int kept = n->first;
+        for(int s = n->first; s < end; s++){
+            value_type_t t = n->tags[s];
+            bool wanted = job_wants(job, t);
+            switch(job->kind){
+                case JOB_REDUCE:
+                    if(wanted){
+                        c->result = job->reduce(c->result, n->vals[s], t, job->arg);
+                    }
+                    break;
+                case JOB_MAP:
+                    if(wanted){
+                        char *str = n->vals[s].sval;
+                        job->map(&n->vals[s], t, job->arg);
+                        if(t == VAL_STR){
+                            n->vals[s].sval = str;
+                        }
+                    }
+                    break;
+                case JOB_FILTER:
+                    if(wanted && !job->keep(n->vals[s], t, job->arg)){
+                        if(t == VAL_STR){
+                            chunk_free_str(c, n->vals[s].sval, false);
+                        }
+                        c->removed++;
+                    }else{
+                        n->vals[kept] = n->vals[s];
+                        n->tags[kept] = n->tags[s];
+                        kept++;
+                    }
+                    break;
+            }
+        }
+        if(job->kind == JOB_FILTER){
+            n->count = kept - n->first;
+        }
+    }
+}
+
+/* chunk_run_ring(): chunk * parameter, no return value; do the job on a chunk of a ring list. A
+   filter moves the values it keeps down to the start of the chunk; list_filter closes the gaps
+   between chunks afterwards */
+static void chunk_run_ring(chunk_t *c){
+    const job_t *job = c->job;
+    list_t *l = job->list;
+    int mask = l->rcap - 1;
+    int kept = c->start;
+    for(int i = c->start; i < c->start + c->count; i++){
+        int s = (l->rhead + i) & mask;
+        value_type_t t = l->rtags[s];
+        bool wanted = job_wants(job, t);
+        switch(job->kind){
+            case JOB_REDUCE:
+                if(wanted){
+                    c->result = job->reduce(c->result, l->rvals[s], t, job->arg);
+                }
+                break;
+            case JOB_MAP:
+                if(wanted){
+                    char *str = l->rvals[s].sval;
+                    job->map(&l->rvals[s], t, job->arg);
+                    if(t == VAL_STR){
+                        l->rvals[s].sval = str;
+                    }
+                }
+                break;
+            case JOB_FILTER:
+                if(wanted && !job->keep(l->rvals[s], t, job->arg)){
+                    if(t == VAL_STR){
+                        chunk_free_str(c, l->rvals[s].sval, false);
+                    }
+                    c->removed++;
+                }else{
+                    int k = (l->rhead + kept) & mask;
+                    l->rvals[k] = l->rvals[s];
+                    l->rtags[k] = l->rtags[s];
+                    kept++;
+                }
+                break;
+        }
+    }
+}
+
+/* chunk_run(): chunk * parameter, no return value; do the job on the chunk */
+static void chunk_run(chunk_t *c){
+    if(c->first == NULL && c->mode == LIST_CHAIN){
+        c->first = c[-1].after;     /* only happens when chunks run in order (see above) */
+    }
+    if(c->mode == LIST_UNROLLED){
+        chunk_run_unrolled(c);
+    }else if(c->mode == LIST_RING){
+        chunk_run_ring(c);
+    }else{
+        chunk_run_chain(c);
+    }
+}
+
+/* A thread (other than the caller) works through every chunk whose number is its own number plus
+   a multiple of the thread count */
+typedef struct{
+    chunk_t *chunks;
+    int nchunks;
+    int first;
+    int step;
+} runner_t;
+
+static void *runner_run(void *arg){
+    runner_t *r = arg;
+    for(int i = r->first; i < r->nchunks; i += r->step){
+        chunk_run(&r->chunks[i]);
+    }
+    return NULL;
+}
+
+/* list_chunk_count(): list * parameter, return how many chunks the list is cut into (1 means no
+   threads at all). Only the size decides this, so results are the same on every machine */
+static int list_chunk_count(list_t *l){
+    int n = l->size / LIST_PARALLEL_MIN;
+    if(n > LIST_PARALLEL_MAX_CHUNKS){
+        n = LIST_PARALLEL_MAX_CHUNKS;
+    }
+    return n < 1 ? 1 : n;
+}
+
+/* list_make_chunks(): list *, job *, chunk array, chunk count and bool parameters, no return value;
+   find where each chunk starts, with one walk along the list. When the chunks are going to run one
+   after the other anyway, a chain list can skip that walk (find_starts false): each chunk then
+   starts where the one before it stopped */
+static void list_make_chunks(list_t *l, const job_t *job, chunk_t *chunks, int nchunks,
+                             bool find_starts){
+    for(int i = 0; i < nchunks; i++){
+        memset(&chunks[i], 0, sizeof(chunk_t));
+        chunks[i].job = job;
+        chunks[i].mode = l->mode;
+        chunks[i].result = job->init;
+    }
+    if(l->mode == LIST_UNROLLED){
+        /* cut between nodes, once a chunk holds its share of the values */
+        unode_t *n = l->uheader->next;
+        int seen = 0;
+        for(int i = 0; i < nchunks; i++){
+            int goal = (int) ((long long) l->size * (i + 1) / nchunks);
+            chunks[i].ufirst = n;
+            while(n != l->uheader && (seen < goal || i == nchunks - 1)){
+                seen += n->count;
+                chunks[i].count++;
+                n = n->next;
+            }
+        }
+        LIST_STAT_ADD(l, traversed, l->size / LIST_UNROLL_SIZE);
+        return;
+    }
+    if(l->mode == LIST_RING){
+        for(int i = 0; i < nchunks; i++){
+            chunks[i].start = (int) ((long long) l->size * i / nchunks);
+            chunks[i].count = (int) ((long long) l->size * (i + 1) / nchunks) - chunks[i].start;
+        }
+        return;
+    }
+    node_t *n = l->header->next;
+    for(int i = 0; i < nchunks; i++){
+        int start = (int) ((long long) l->size * i / nchunks);
+        int end = (int) ((long long) l->size * (i + 1) / nchunks);
+        chunks[i].first = n;
+        chunks[i].count = end - start;
+        if(!find_starts){
+            n = NULL;       /* chunk_run fills it in from the chunk before */
+        }else if(i < nchunks - 1){
+            for(int k = 0; k < end - start; k++){
+                n = n->next;
+            }
+        }
+    }
+    LIST_STAT_ADD(l, traversed, find_starts && nchunks > 1 ? l->size : 0);
+}
+
+/* list_run_job(): list *, job * and chunk count parameters, return the chunks (in list order) once
+   all of them are done, or NULL if there was no room for them. The caller frees the array */
+static chunk_t *list_run_job(list_t *l, const job_t *job, int nchunks){
+    chunk_t *chunks = malloc(nchunks * sizeof(chunk_t));
+    if(chunks == NULL){
+        return NULL;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cpus < nchunks ? (int) (cpus < 1 ? 1 : cpus) : nchunks;
+    list_make_chunks(l, job, chunks, nchunks, nthreads > 1);
+
+    pthread_t threads[LIST_PARALLEL_MAX_CHUNKS];
+    runner_t runners[LIST_PARALLEL_MAX_CHUNKS];
+    bool started[LIST_PARALLEL_MAX_CHUNKS] = { false };
+    /* thread 0 is the caller itself, so one chunk-runner fewer has to be started */
+    for(int i = 1; i < nthreads; i++){
+        runners[i] = (runner_t){ chunks, nchunks, i, nthreads };
+        started[i] = pthread_create(&threads[i], NULL, runner_run, &runners[i]) == 0;
+    }
+    for(int i = 0; i < nchunks; i++){
+        int owner = i % nthreads;
+        if(owner == 0 || !started[owner]){
+            chunk_run(&chunks[i]);      /* ours, or a thread that couldn't be started */
+        }
+    }
+    for(int i = 1; i < nthreads; i++){
+        if(started[i]){
+            pthread_join(threads[i], NULL);
+        }
+    }
+    LIST_STAT_ADD(l, traversed, l->size);
+    return chunks;
+}
+
+/* list_run_or_serial(): list *, job *, a spare chunk, a chunk count * and whether the list may be
+   split parameters, return the finished chunks and their count: split up if the list is big
+   enough (and splitting is allowed), or just 'one' chunk otherwise (also if the chunk array
+   couldn't be allocated) */
+static chunk_t *list_run_or_serial(list_t *l, const job_t *job, chunk_t *one, int *nchunks,
+                                   bool may_split){
+    *nchunks = may_split ? list_chunk_count(l) : 1;
+    chunk_t *chunks = *nchunks > 1 ? list_run_job(l, job, *nchunks) : NULL;
+    if(chunks == NULL){
+        *nchunks = 1;
+        list_make_chunks(l, job, one, 1, true);
+        chunk_run(one);
+        LIST_STAT_ADD(l, traversed, l->size);
+        chunks = one;
+    }
+    return chunks;
+}
+
+/* list_reduce(): reduce callback, combine callback, starting value, type mask, extra pointer and
+   list * parameters, return the result of folding every matching value into the starting value */
+value_t list_reduce(list_reduce_fn reduce, list_combine_fn combine, value_t init, unsigned int mask,
+                    void *arg, list_t *l){
+    if(l == NULL || reduce == NULL || l->size == 0){
+        return init;
+    }
+    job_t job = { JOB_REDUCE, mask, arg, reduce, NULL, NULL, init, l };
+    chunk_t one;
+    int nchunks;
+    /* without a way to join the chunks' results, the list has to be done in one go */
+    chunk_t *chunks = list_run_or_serial(l, &job, &one, &nchunks, combine != NULL);
+    value_t result = chunks[0].result;
+    for(int i = 1; i < nchunks; i++){
+        result = combine(result, chunks[i].result, arg);
+    }
+    if(chunks != &one){
+        free(chunks);
+    }
+    return result;
+}
+
+/* list_map_inplace(): map callback, type mask, extra pointer and list * parameters, no return
+   value; call the callback on every matching value so it can change it */
+void list_map_inplace(list_map_fn map, unsigned int mask, void *arg, list_t *l){
+    if(l == NULL || map == NULL || l->size == 0){
+        return;
+    }
+    /* a string table's strings are shared with other values, so they must not change */
+    if(l->intern != NULL){
+        mask &= ~LIST_TYPE_BIT(VAL_STR);
+    }
+    value_t unused = { .ival = 0 };
+    job_t job = { JOB_MAP, mask, arg, NULL, map, NULL, unused, l };
+    chunk_t one;
+    int nchunks;
+    chunk_t *chunks = list_run_or_serial(l, &job, &one, &nchunks, true);
+    if(chunks != &one){
+        free(chunks);
+    }
+    /* the values may have changed, so the index can't be trusted */
+    index_forget(l->index);
+}
+
+/* list_filter(): keep callback, type mask, extra pointer and list * parameters, return how many
+   values were removed */
+int list_filter(list_keep_fn keep, unsigned int mask, void *arg, list_t *l){
+    if(l == NULL || keep == NULL || l->size == 0){
+        return 0;
+    }
+    value_t unused = { .ival = 0 };
+    job_t job = { JOB_FILTER, mask, arg, NULL, NULL, keep, unused, l };
+    chunk_t one;
+    int nchunks;
+    /* a string table can't be changed by several threads at once, so a list with one is
+       filtered by just this thread */
+    chunk_t *chunks = list_run_or_serial(l, &job, &one, &nchunks, l->intern == NULL);
+
+    /* put the pieces back together, in order */
+    int removed = 0;
+    for(int i = 0; i < nchunks; i++){
+        removed += chunks[i].removed;
+        LIST_STAT_ADD(l, str_bytes, -chunks[i].str_bytes);
+        LIST_STAT_ADD(l, frees, chunks[i].str_frees);
+    }
+    if(l->mode == LIST_UNROLLED){
+        ulist_drop_empty(l);
+    }else if(l->mode == LIST_RING){
+        /* slide each chunk's kept values down to right after the ones kept before them */
+        int slot_mask = l->rcap - 1;
+        int to = 0;
+        for(int i = 0; i < nchunks; i++){
+            int kept = chunks[i].count - chunks[i].removed;
+            if(to != chunks[i].start){
+                for(int k = 0; k < kept; k++){
+                    int d = (l->rhead + to + k) & slot_mask;
+                    int s = (l->rhead + chunks[i].start + k) & slot_mask;
+                    l->rvals[d] = l->rvals[s];
+                    l->rtags[d] = l->rtags[s];
+                }
+            }
+            to += kept;
+        }
+    }else{
+        node_t *last = l->header;
+        for(int i = 0; i < nchunks; i++){
+            if(chunks[i].kept_first != NULL){
+                last->next = chunks[i].kept_first;
+                chunks[i].kept_first->prev = last;
+                last = chunks[i].kept_last;
+            }
+            if(chunks[i].dead_first != NULL){
+                list_release_nodes(l, chunks[i].dead_first, chunks[i].dead_last);
+            }
+        }
+        last->next = l->header;
+        l->header->prev = last;
+        l->cache_node = NULL;
+        index_forget(l->index);
+        skip_forget(l->skip);
+    }
+    l->size -= removed;
+    if(l->mode == LIST_RING){
+        rlist_fit(l);
+    }
+    if(chunks != &one){
+        free(chunks);
+    }
+    return removed;
+}
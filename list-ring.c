@@ -0,0 +1,472 @@
+/*
+ *  This file (list-ring.c) holds the LIST_RING mode for the linked list demo.
+ *
+ *  A ring list isn't linked at all: it has no nodes, just one array of values and a second array
+ *  of their type tags (right after the first, in the same allocation), used as a circle. The
+ *  first value can sit in any slot ('rhead'); the values after it follow in the next slots,
+ *  wrapping around from the last slot to slot 0. So:
+ *      - pushing is stepping rhead back one slot and writing there, and appending is writing the
+ *        slot after the last value: no allocation, no pointers to fix
+ *      - popping and removing the last value are the same steps backwards
+ *      - the value at any index is one addition and one '&' away, so list_get never walks
+ *      - going through the values in order reads neighbouring slots, which the CPU's cache is
+ *        very good at
+ *
+ *  When every slot is full the values move to an array twice as big, and when fewer than a
+ *  quarter of the slots are used they move to one half as big; either way a push or a pop costs
+ *  O(1) on average. The number of slots is always a power of 2, so 'wrapping around' is just
+ *  '& (rcap - 1)' instead of a division.
+ *
+ *  What a ring list is bad at is the middle: inserting or removing there means shifting every
+ *  value on one side of it by one slot. We shift whichever side is shorter, so that's at most
+ *  half of the list, but it's still O(n) where a chain with a skip layer takes O(log n).
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>     /* for INT_MAX */
+
+#include "list-internal.h"
+
+/* ring_slot(): list * and index parameters, return the slot holding that index */
+static inline int ring_slot(const list_t *l, int index){
+    return (l->rhead + index) & (l->rcap - 1);
+}
+
+/* ring_run(): list *, index, count and int * parameters, return the slot holding that index, and
+   put in *len how many of the 'count' indices starting there sit in the slots right after it,
+   before the array wraps around. Anything that works on a stretch of values does it in (at most
+   two) such runs, so that the inner loops are plain array loops */
+static int ring_run(const list_t *l, int index, int count, int *len){
+    int slot = ring_slot(l, index);
+    int room = l->rcap - slot;
+    *len = count < room ? count : room;
+    return slot;
+}
+
+/* ring_resize(): list * and capacity parameters, return true if the values now live in a new
+   array with that many slots (which must be enough for them), starting at slot 0 */
+static bool ring_resize(list_t *l, int cap){
+    value_t *vals = malloc((size_t) cap * (sizeof(value_t) + sizeof(int8_t)));
+    if(vals == NULL){
+        return false;
+    }
+    LIST_STAT_ADD(l, allocs, 1);
+    int8_t *tags = (int8_t *) (vals + cap);
+    for(int i = 0; i < l->size; ){
+        int len;
+        int slot = ring_run(l, i, l->size - i, &len);
+        memcpy(&vals[i], &l->rvals[slot], len * sizeof(value_t));
+        memcpy(&tags[i], &l->rtags[slot], len * sizeof(int8_t));
+        i += len;
+    }
+    if(l->rvals != NULL){
+        free(l->rvals);
+        LIST_STAT_ADD(l, frees, 1);
+    }
+    l->rvals = vals;
+    l->rtags = tags;
+    l->rhead = 0;
+    l->rcap = cap;
+    return true;
+}
+
+/* ring_reserve(): list * and count parameters, return true if there are free slots for at least
+   that many more values (doubling the array as often as it takes), false if there's no memory */
+static bool ring_reserve(list_t *l, int extra){
+    int cap = l->rcap;
+    if(extra <= cap - l->size){
+        return true;
+    }
+    while(extra > cap - l->size){
+        if(cap > INT_MAX / 2){
+            return false;
+        }
+        cap *= 2;
+    }
+    return ring_resize(l, cap);
+}
+
+/* ring_fit(): list * parameter, no return value; after values were removed, move them to a
+   smaller array if three quarters of the slots are empty. If that fails the list just keeps the
+   bigger one */
+static void ring_fit(list_t *l){
+    int cap = l->rcap;
+    while(cap > LIST_RING_MIN && l->size < cap / 4){
+        cap /= 2;
+    }
+    if(cap != l->rcap){
+        ring_resize(l, cap);
+    }
+}
+
+/* ring_move(): two list *, two index and count parameters, no return value; copy 'count' values
+   (and tags) starting at index 'si' of src into the slots for index 'di' onwards of dst. The two
+   must be different lists, and dst must have the room; neither list's size changes */
+static void ring_move(list_t *dst, int di, const list_t *src, int si, int count){
+    while(count > 0){
+        int dlen, slen;
+        int d = ring_run(dst, di, count, &dlen);
+        int s = ring_run(src, si, count, &slen);
+        int len = dlen < slen ? dlen : slen;
+        memcpy(&dst->rvals[d], &src->rvals[s], len * sizeof(value_t));
+        memcpy(&dst->rtags[d], &src->rtags[s], len * sizeof(int8_t));
+        di += len;
+        si += len;
+        count -= len;
+    }
+}
+
+/* ring_swap(): two list * parameters, no return value; trade the two lists' arrays (and sizes) */
+static void ring_swap(list_t *a, list_t *b){
+    list_t keep = *a;
+    a->rvals = b->rvals;
+    a->rtags = b->rtags;
+    a->rhead = b->rhead;
+    a->rcap = b->rcap;
+    a->size = b->size;
+    b->rvals = keep.rvals;
+    b->rtags = keep.rtags;
+    b->rhead = keep.rhead;
+    b->rcap = keep.rcap;
+    b->size = keep.size;
+}
+
+/* ring_open(): list * and index parameters, return the slot for a new value at that index, after
+   shifting the values before it one slot towards the front, or the ones from it onwards one slot
+   towards the back (whichever are fewer). There must be a free slot; the size goes up by one.
+   At either end nothing needs shifting at all */
+static int ring_open(list_t *l, int index){
+    int mask = l->rcap - 1;
+    if(index < l->size - index){
+        l->rhead = (l->rhead - 1) & mask;
+        for(int i = 0; i < index; i++){
+            int to = (l->rhead + i) & mask;
+            int from = (to + 1) & mask;
+            l->rvals[to] = l->rvals[from];
+            l->rtags[to] = l->rtags[from];
+        }
+    }else{
+        for(int i = l->size; i > index; i--){
+            int to = (l->rhead + i) & mask;
+            int from = (to - 1) & mask;
+            l->rvals[to] = l->rvals[from];
+            l->rtags[to] = l->rtags[from];
+        }
+    }
+    l->size++;
+    LIST_STAT_GROW(l);
+    return ring_slot(l, index);
+}
+
+/* ring_close(): list * and index parameters, no return value; the reverse of ring_open: the value
+   at that index is gone (whatever it owned was dealt with already), so the shorter side shifts
+   over to fill its slot */
+static void ring_close(list_t *l, int index){
+    int mask = l->rcap - 1;
+    if(index < l->size - 1 - index){
+        for(int i = index; i > 0; i--){
+            int to = (l->rhead + i) & mask;
+            int from = (to - 1) & mask;
+            l->rvals[to] = l->rvals[from];
+            l->rtags[to] = l->rtags[from];
+        }
+        l->rhead = (l->rhead + 1) & mask;
+    }else{
+        for(int i = index; i < l->size - 1; i++){
+            int to = (l->rhead + i) & mask;
+            int from = (to + 1) & mask;
+            l->rvals[to] = l->rvals[from];
+            l->rtags[to] = l->rtags[from];
+        }
+    }
+    l->size--;
+    ring_fit(l);
+}
+
+/* rlist_init(): list * parameter, return true if the list's first (LIST_RING_MIN-slot) array was
+   allocated */
+bool rlist_init(list_t *l){
+    l->rvals = NULL;
+    l->rtags = NULL;
+    l->rhead = 0;
+    l->rcap = 0;
+    return ring_resize(l, LIST_RING_MIN);
+}
+
+/* rlist_free(): list * parameter, no return value; free every string and the array (the list
+   structure itself is left to list_free) */
+void rlist_free(list_t *l){
+    for(int i = 0; i < l->size; ){
+        int len;
+        int slot = ring_run(l, i, l->size - i, &len);
+        for(int k = slot; k < slot + len; k++){
+            if(l->rtags[k] == VAL_STR){
+                list_free_str(l, l->rvals[k].sval);
+            }
+        }
+        i += len;
+    }
+    free(l->rvals);
+}
+
+/* rlist_reserve(): list * and count parameters, return true if that many more values can be added
+   without the array having to grow (list_append_array reserves a whole run at once) */
+bool rlist_reserve(list_t *l, int extra){
+    return ring_reserve(l, extra);
+}
+
+/* ring_copy_value(): value, type, value * and list * parameters, return true if *out now holds the
+   list's own copy of the value (strings get their own copy, just like in the classic list) */
+static bool ring_copy_value(value_t v, value_type_t t, value_t *out, list_t *l){
+    switch(t){
+        case VAL_CHAR:
+        case VAL_INT:
+        case VAL_BOOL:
+            *out = v;
+            return true;
+        case VAL_STR:
+            out->sval = list_copy_str(l, v.sval);
+            if(out->sval == NULL){
+                return false;
+            }
+            LIST_STAT_ADD(l, str_bytes, strlen(v.sval) + 1);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* The slot is made sure of before a string is copied, so that running out of memory for one
+   never leaves the other behind */
+
+bool rlist_insert_at(int index, value_t v, value_type_t t, list_t *l){
+    if(!ring_reserve(l, 1) || !ring_copy_value(v, t, &v, l)){
+        return false;
+    }
+    int slot = ring_open(l, index);
+    l->rvals[slot] = v;
+    l->rtags[slot] = t;
+    return true;
+}
+
+bool rlist_insert_owned(int index, char *s, list_t *l){
+    if(!ring_reserve(l, 1)){
+        return false;
+    }
+    s = list_own_str(l, s);
+    if(s == NULL){
+        return false;
+    }
+    LIST_STAT_ADD(l, str_bytes, strlen(s) + 1);
+    int slot = ring_open(l, index);
+    l->rvals[slot].sval = s;
+    l->rtags[slot] = VAL_STR;
+    return true;
+}
+
+value_t rlist_remove_at(int index, list_t *l, bool owned){
+    value_t ret_val;
+    ret_val.sval = NULL;
+    if(index < 0 || index >= l->size){
+        return ret_val;
+    }
+    int slot = ring_slot(l, index);
+    ret_val = l->rvals[slot];
+    if(l->rtags[slot] == VAL_STR){
+        ret_val.sval = owned ? list_export_str(l, ret_val.sval) : list_park_str(l, ret_val.sval);
+        if(ret_val.sval == NULL){
+            return ret_val;     /* out of memory: the value stays where it is */
+        }
+        LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(ret_val.sval) + 1));
+    }
+    ring_close(l, index);
+    return ret_val;
+}
+
+void rlist_discard_at(int index, list_t *l){
+    int slot = ring_slot(l, index);
+    if(l->rtags[slot] == VAL_STR){
+        LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(l->rvals[slot].sval) + 1));
+        list_free_str(l, l->rvals[slot].sval);
+    }
+    ring_close(l, index);
+}
+
+value_t rlist_get(int index, list_t *l){
+    return l->rvals[ring_slot(l, index)];
+}
+
+value_type_t rlist_get_type(int index, list_t *l){
+    return l->rtags[ring_slot(l, index)];
+}
+
+/* The searches go through the tags (and values) one run of slots at a time. The tags are packed
+   together, one byte each, so a search for a type only reads a byte per value */
+
+int rlist_count_type(value_type_t t, list_t *l){
+    int found = 0;
+    for(int i = 0; i < l->size; ){
+        int len;
+        const int8_t *tags = &l->rtags[ring_run(l, i, l->size - i, &len)];
+        for(int k = 0; k < len; k++){
+            found += tags[k] == t;
+        }
+        i += len;
+    }
+    return found;
+}
+
+int rlist_find_type(value_type_t t, int start, list_t *l){
+    for(int i = start; i < l->size; ){
+        int len;
+        const int8_t *tags = &l->rtags[ring_run(l, i, l->size - i, &len)];
+        for(int k = 0; k < len; k++){
+            if(tags[k] == t){
+                return i + k;
+            }
+        }
+        i += len;
+    }
+    return -1;
+}
+
+int rlist_find_int(int x, int start, list_t *l){
+    for(int i = start; i < l->size; ){
+        int len;
+        int slot = ring_run(l, i, l->size - i, &len);
+        const int8_t *tags = &l->rtags[slot];
+        const value_t *vals = &l->rvals[slot];
+        for(int k = 0; k < len; k++){
+            if(tags[k] == VAL_INT && vals[k].ival == x){
+                return i + k;
+            }
+        }
+        i += len;
+    }
+    return -1;
+}
+
+int rlist_find_char(char c, int start, list_t *l){
+    for(int i = start; i < l->size; ){
+        int len;
+        int slot = ring_run(l, i, l->size - i, &len);
+        const int8_t *tags = &l->rtags[slot];
+        const value_t *vals = &l->rvals[slot];
+        for(int k = 0; k < len; k++){
+            if(tags[k] == VAL_CHAR && vals[k].cval == c){
+                return i + k;
+            }
+        }
+        i += len;
+    }
+    return -1;
+}
+
+int rlist_find_value(value_t v, value_type_t t, list_t *l){
+    if(t == VAL_INT){
+        return rlist_find_int(v.ival, 0, l);
+    }
+    if(t == VAL_CHAR){
+        return rlist_find_char(v.cval, 0, l);
+    }
+    int i = rlist_find_type(t, 0, l);
+    while(i >= 0 && !value_equal(rlist_get(i, l), t, v, t)){
+        i = i + 1 < l->size ? rlist_find_type(t, i + 1, l) : -1;
+    }
+    return i;
+}
+
+/* Two ring lists can't just be relinked like chains, so the shorter one's values get copied: onto
+   the end of dst, or (when src is longer) in front of src's values, after which the two lists
+   trade arrays. Either way only min(dst->size, src->size) values move */
+bool rlist_concat(list_t *dst, list_t *src){
+    if(src->size > dst->size){
+        if(!ring_reserve(src, dst->size)){
+            return false;
+        }
+        src->rhead = (src->rhead - dst->size) & (src->rcap - 1);
+        src->size += dst->size;
+        ring_move(src, 0, dst, 0, dst->size);
+        ring_swap(dst, src);
+    }else{
+        if(!ring_reserve(dst, src->size)){
+            return false;
+        }
+        ring_move(dst, dst->size, src, 0, src->size);
+        dst->size += src->size;
+    }
+    LIST_STAT_GROW(dst);
+    src->size = 0;
+    src->rhead = 0;
+    ring_fit(src);
+    return true;
+}
+
+/* The same trick the other way around: whichever part is shorter gets copied into the new list's
+   array, and if that was the part that stays, the lists trade arrays afterwards */
+bool rlist_split(list_t *l, int index, list_t *tail){
+    int moved = l->size - index;
+    if(moved <= index){
+        if(!ring_reserve(tail, moved)){
+            return false;
+        }
+        ring_move(tail, 0, l, index, moved);
+        tail->size = moved;
+        l->size = index;
+    }else{
+        if(!ring_reserve(tail, index)){
+            return false;
+        }
+        ring_move(tail, 0, l, 0, index);
+        tail->size = index;
+        ring_swap(l, tail);
+        /* tail has l's old array now: its values start where the moved part did */
+        tail->rhead = ring_slot(tail, index);
+        tail->size = moved;
+    }
+    LIST_STAT_GROW(tail);
+    ring_fit(l);
+    return true;
+}
+
+void rlist_foreach(list_t *l, void (*fn)(value_t, value_type_t, void *), void *arg){
+    for(int i = 0; i < l->size; ){
+        int len;
+        int slot = ring_run(l, i, l->size - i, &len);
+        for(int k = slot; k < slot + len; k++){
+            fn(l->rvals[k], l->rtags[k], arg);
+        }
+        i += len;
+    }
+}
+
+/* Like an unrolled list, a ring list sorts a copy of its values (see sort_items in list-sort.c)
+   and puts them back in the same slots */
+bool rlist_sort(list_cmp_fn cmp, void *arg, list_t *l){
+    size_t n = (size_t) l->size;
+    sort_item_t *items = malloc(2 * n * sizeof(sort_item_t));
+    if(items == NULL){
+        return false;
+    }
+    LIST_STAT_ADD(l, allocs, 1);
+    for(int i = 0; i < l->size; i++){
+        int slot = ring_slot(l, i);
+        items[i].val = l->rvals[slot];
+        items[i].type = l->rtags[slot];
+    }
+    sort_item_t *sorted = sort_items(items, items + n, n, cmp, arg);
+    for(int i = 0; i < l->size; i++){
+        int slot = ring_slot(l, i);
+        l->rvals[slot] = sorted[i].val;
+        l->rtags[slot] = (int8_t) sorted[i].type;
+    }
+    free(items);
+    LIST_STAT_ADD(l, frees, 1);
+    return true;
+}
+
+void rlist_fit(list_t *l){
+    ring_fit(l);
+}
@@ -0,0 +1,181 @@
+/*
+ *  This file (list-simd.c) holds the search kernels behind list_count_type, list_find_type,
+ *  list_find_int and list_find_char for LIST_UNROLLED lists.
+ *
+ *  A kernel looks at one whole unode_t and answers with a bit mask: bit i is set when slot i holds
+ *  a value we're looking for. Since an unrolled node keeps its 16 type tags next to each other,
+ *  and its 16 values right after, a CPU with SIMD ("single instruction, multiple data")
+ *  instructions can check many slots with one instruction instead of one slot at a time:
+ *      - SSE2 compares 16 bytes at once. Every x86-64 CPU has it.
+ *      - AVX2 compares 32 bytes at once. Newer CPUs have it, so we ask the CPU at run time
+ *        before using it.
+ *  Everywhere else (or when asked to, see list_simd_use) a plain loop does the same job.
+ *
+ *  Int and char searches compare the first 4 bytes of each value_t (every member of a union starts
+ *  at its first byte): all 4 of them for an ival, and just the one that holds the cval for a char.
+ *  Slots with another type hold other bits there, which is why the tags are checked too.
+ *
+ */
+
+#include <string.h>
+#include <stdatomic.h>    /* C11 atomics, for the kernel pointers */
+
+#include "list-internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LIST_HAVE_X86 1
+#include <immintrin.h>  /* the SSE2 and AVX2 'intrinsics': C functions that are really one instruction */
+#endif
+
+_Static_assert(LIST_UNROLL_SIZE == 16, "the kernels below check exactly 16 slots");
+_Static_assert(sizeof(value_t) == 8, "the kernels below expect 8-byte values");
+
+/* unode_used_bits(): node * parameter, return a mask with a bit for every slot holding a value */
+static unsigned int unode_used_bits(const unode_t *n){
+    return ((1u << n->count) - 1) << n->first;
+}
+
+/* SCALAR KERNELS */
+
+static unsigned int match_type_scalar(const unode_t *n, value_type_t t){
+    unsigned int bits = 0;
+    for(int i = n->first; i < n->first + n->count; i++){
+        bits |= (unsigned int) (n->tags[i] == t) << i;
+    }
+    return bits;
+}
+
+/* the first 4 bytes of slot i, after masking with 'keep', must equal 'key' (and its tag must be
+   'tag') */
+static unsigned int match_low32_scalar(const unode_t *n, value_type_t tag, uint32_t key,
+                                       uint32_t keep){
+    unsigned int bits = 0;
+    for(int i = n->first; i < n->first + n->count; i++){
+        uint32_t low;
+        memcpy(&low, &n->vals[i], sizeof(low));
+        bits |= (unsigned int) (n->tags[i] == tag && (low & keep) == key) << i;
+    }
+    return bits;
+}
+
+#ifdef LIST_HAVE_X86
+
+/* SSE2 KERNELS */
+
+static unsigned int match_type_sse2(const unode_t *n, value_type_t t){
+    __m128i tags = _mm_loadu_si128((const __m128i *) n->tags);
+    __m128i same = _mm_cmpeq_epi8(tags, _mm_set1_epi8((char) t));
+    return (unsigned int) _mm_movemask_epi8(same) & unode_used_bits(n);
+}
+
+static unsigned int match_low32_sse2(const unode_t *n, value_type_t tag, uint32_t key,
+                                     uint32_t keep){
+    __m128i want = _mm_set1_epi32((int) key);
+    __m128i mask = _mm_set1_epi32((int) keep);
+    unsigned int bits = 0;
+    for(int i = 0; i < 4; i++){
+        /* two loads hold four values; the shuffle picks out the low 4 bytes of each */
+        __m128 a = _mm_loadu_ps((const float *) &n->vals[4 * i]);
+        __m128 b = _mm_loadu_ps((const float *) &n->vals[4 * i + 2]);
+        __m128i low = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i same = _mm_cmpeq_epi32(_mm_and_si128(low, mask), want);
+        bits |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(same)) << (4 * i);
+    }
+    return bits & match_type_sse2(n, tag);
+}
+
+/* AVX2 KERNEL */
+/* the tags are only 16 bytes, so match_type has nothing to gain from AVX2 */
+
+__attribute__((target("avx2")))
+static unsigned int match_low32_avx2(const unode_t *n, value_type_t tag, uint32_t key,
+                                     uint32_t keep){
+    __m256i want = _mm256_set1_epi32((int) key);
+    __m256i mask = _mm256_set1_epi32((int) keep);
+    unsigned int bits = 0;
+    for(int i = 0; i < 2; i++){
+        /* eight values; after the shuffle their low halves are in the order 0 1 4 5 2 3 6 7,
+           and the permute puts them back in order */
+        __m256 a = _mm256_loadu_ps((const float *) &n->vals[8 * i]);
+        __m256 b = _mm256_loadu_ps((const float *) &n->vals[8 * i + 4]);
+        __m256i low = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        low = _mm256_permute4x64_epi64(low, _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i same = _mm256_cmpeq_epi32(_mm256_and_si256(low, mask), want);
+        bits |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(same)) << (8 * i);
+    }
+    return bits & match_type_sse2(n, tag);
+}
+
+#endif /* LIST_HAVE_X86 */
+
+/* DISPATCH */
+/* The kernels in use, picked the first time one is needed. Searches can run on several threads
+   at once, so the pointers are atomic: two threads picking at the same time both store the same
+   thing, and a thread never sees half a pointer. Relaxed loads and stores are enough, since the
+   pointers only ever point at code, never at data another thread wrote */
+
+typedef unsigned int (*match_type_fn)(const unode_t *, value_type_t);
+typedef unsigned int (*match_low32_fn)(const unode_t *, value_type_t, uint32_t, uint32_t);
+
+static _Atomic(match_type_fn) match_type = NULL;
+static _Atomic(match_low32_fn) match_low32 = NULL;
+
+/* use_kernels(): the two kernels to use, no return value */
+static void use_kernels(match_type_fn type_kernel, match_low32_fn low32_kernel){
+    atomic_store_explicit(&match_type, type_kernel, memory_order_relaxed);
+    atomic_store_explicit(&match_low32, low32_kernel, memory_order_relaxed);
+}
+
+/* list_simd_use(): level parameter (LIST_SIMD_BEST, _SCALAR, _SSE2 or _AVX2), return the level
+   actually in use afterwards, which is lower than the one asked for if the CPU can't do it */
+int list_simd_use(int level){
+#ifdef LIST_HAVE_X86
+    __builtin_cpu_init();
+    if(level >= LIST_SIMD_AVX2 && __builtin_cpu_supports("avx2")){
+        use_kernels(match_type_sse2, match_low32_avx2);
+        return LIST_SIMD_AVX2;
+    }
+    if(level >= LIST_SIMD_SSE2 && __builtin_cpu_supports("sse2")){
+        use_kernels(match_type_sse2, match_low32_sse2);
+        return LIST_SIMD_SSE2;
+    }
+#else
+    (void) level;
+#endif
+    use_kernels(match_type_scalar, match_low32_scalar);
+    return LIST_SIMD_SCALAR;
+}
+
+/* load_low32(): no parameters, return the low32 kernel in use, picking one if none is yet */
+static match_low32_fn load_low32(void){
+    match_low32_fn kernel = atomic_load_explicit(&match_low32, memory_order_relaxed);
+    if(kernel == NULL){
+        list_simd_use(LIST_SIMD_BEST);
+        kernel = atomic_load_explicit(&match_low32, memory_order_relaxed);
+    }
+    return kernel;
+}
+
+unsigned int unode_match_type(const unode_t *n, value_type_t t){
+    match_type_fn kernel = atomic_load_explicit(&match_type, memory_order_relaxed);
+    if(kernel == NULL){
+        list_simd_use(LIST_SIMD_BEST);
+        kernel = atomic_load_explicit(&match_type, memory_order_relaxed);
+    }
+    return kernel(n, t);
+}
+
+unsigned int unode_match_int(const unode_t *n, int x){
+    return load_low32()(n, VAL_INT, (uint32_t) x, 0xffffffffu);
+}
+
+unsigned int unode_match_char(const unode_t *n, char c){
+    /* the cval is the first of the 4 bytes in memory, which is the low end of a uint32_t unless
+       the machine is big-endian */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint32_t key = (uint32_t) (unsigned char) c << 24, keep = 0xff000000u;
+#else
+    uint32_t key = (unsigned char) c, keep = 0xffu;
+#endif
+    return load_low32()(n, VAL_CHAR, key, keep);
+}
@@ -0,0 +1,446 @@
+/*
+ *  This file (list-skip.c) holds the skip layer that a LIST_CHAIN list can keep over its nodes
+ *  (see list_use_skip), so that finding the value at some index takes O(log n) steps instead of
+ *  walking up to half the list.
+ *
+ *  A skip layer is a few more linked lists stacked on top of the chain ("levels"). Every node
+ *  gets a random height: 0 for three nodes out of four, 1 for three out of sixteen, and so on,
+ *  and a node of height h has an entry in each of the lowest h levels. So each level holds about
+ *  a quarter of the entries of the one below it, and each entry remembers how many nodes it is
+ *  from the next entry on its level (its 'width'). To find index i we start on the top level,
+ *  move right while that doesn't overshoot, drop a level, and repeat; at the bottom there are
+ *  only a few nodes left to walk along the chain. That's O(log n) steps, on average.
+ *
+ *  Rather than indices, the layer keeps 'positions': index i is at position base + i. A push
+ *  gives the new node position base - 1 and makes that the new base, and a pop moves base on by
+ *  one, so neither has to change anything else. Each level also knows where its first and last
+ *  entries are, which is all that pushing, appending and popping at either end need: those cost
+ *  one step per level the node is tall, which is O(1) on average. Only inserting or removing in
+ *  the middle has to move the positions after it, which means fixing one width per level.
+ *
+ *  Other changes (list_concat, list_filter, list_sort, a cursor's insert in the middle...) mark
+ *  the layer 'stale', and it's built again from the chain the next time it's needed, the same way
+ *  the hash index in list-index.c is.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "list-internal.h"
+
+/* A list needs to be this far from the nearest end (or list_get's cached position) before
+   list_get bothers with the skip layer; shorter walks are quicker along the chain itself */
+#define LIST_SKIP_MIN_WALK 32
+
+/* ENTRIES */
+/* Entries are carved out of blocks, like the nodes themselves, and freed all at once */
+
+/* skip_entry_new(): skip layer * and node * parameters, return a new entry for that node, or NULL
+   if space can't be allocated */
+static skip_entry_t *skip_entry_new(list_skip_t *s, node_t *n){
+    skip_entry_t *e = s->free_entries;
+    if(e != NULL){
+        s->free_entries = e->next;
+    }else{
+        if(s->blocks == NULL || s->blocks->used == LIST_SKIP_BLOCK){
+            skip_block_t *b = malloc(sizeof(skip_block_t));
+            if(b == NULL){
+                return NULL;
+            }
+            b->next = s->blocks;
+            b->used = 0;
+            s->blocks = b;
+        }
+        e = &s->blocks->entries[s->blocks->used++];
+    }
+    e->node = n;
+    e->next = NULL;
+    e->prev = NULL;
+    e->down = NULL;
+    e->width = 0;
+    return e;
+}
+
+/* skip_entry_free(): skip layer * and entry * parameters, no return value */
+static void skip_entry_free(list_skip_t *s, skip_entry_t *e){
+    e->next = s->free_entries;
+    s->free_entries = e;
+}
+
+/* skip_clear(): skip layer * parameter, no return value; forget every entry (keeping the blocks
+   to use again) and every level */
+static void skip_clear(list_skip_t *s){
+    for(skip_block_t *b = s->blocks; b != NULL; b = b->next){
+        b->used = 0;
+    }
+    s->free_entries = NULL;
+    for(int k = 0; k < LIST_SKIP_LEVELS; k++){
+        s->first[k] = NULL;
+        s->last[k] = NULL;
+        s->first_pos[k] = 0;
+        s->last_pos[k] = 0;
+    }
+    s->levels = 0;
+    s->base = 0;
+}
+
+/* skip_height(): skip layer * parameter, return a random height for a new node: each level up
+   is a 1 in 4 chance (two random bits both being 0). The random numbers come from a little
+   'xorshift' generator, so every list's layer is the same from run to run */
+static int skip_height(list_skip_t *s){
+    uint64_t x = s->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    s->rng = x;
+    int h = 0;
+    while(h < LIST_SKIP_LEVELS && (x & 3) == 0){
+        h++;
+        x >>= 2;
+    }
+    return h;
+}
+
+/* skip_new(): no parameters, return a new empty (and stale) skip layer, or NULL if space can't be
+   allocated */
+list_skip_t *skip_new(){
+    list_skip_t *s = malloc(sizeof(list_skip_t));
+    if(s == NULL){
+        return NULL;
+    }
+    s->blocks = NULL;
+    s->rng = 0x9e3779b97f4a7c15ull;
+    skip_clear(s);
+    s->stale = true;
+    return s;
+}
+
+/* skip_free(): skip layer * parameter, no return value */
+void skip_free(list_skip_t *s){
+    if(s == NULL){
+        return;
+    }
+    skip_block_t *b = s->blocks;
+    while(b != NULL){
+        skip_block_t *next = b->next;
+        free(b);
+        b = next;
+    }
+    free(s);
+}
+
+/* skip_forget(): skip layer * parameter (NULL is fine), no return value */
+void skip_forget(list_skip_t *s){
+    if(s != NULL){
+        s->stale = true;
+    }
+}
+
+/* ADDING NODES */
+
+/* skip_tower(): skip layer *, node * and height parameters, return the node's entries from the
+   bottom level up (in tower[]), linked to each other through 'down'; false if space ran out, and
+   then the layer is stale */
+static bool skip_tower(list_skip_t *s, node_t *n, int h, skip_entry_t **tower){
+    for(int k = 0; k < h; k++){
+        tower[k] = skip_entry_new(s, n);
+        if(tower[k] == NULL){
+            s->stale = true;
+            return false;
+        }
+        tower[k]->down = k > 0 ? tower[k - 1] : NULL;
+    }
+    if(h > s->levels){
+        s->levels = h;
+    }
+    return true;
+}
+
+/* skip_add_front(): the new node goes before every other one */
+static void skip_add_front(list_skip_t *s, node_t *n){
+    int h = skip_height(s);
+    skip_entry_t *tower[LIST_SKIP_LEVELS];
+    s->base--;
+    if(!skip_tower(s, n, h, tower)){
+        return;
+    }
+    for(int k = 0; k < h; k++){
+        skip_entry_t *e = tower[k];
+        e->next = s->first[k];
+        if(e->next != NULL){
+            e->width = s->first_pos[k] - s->base;
+            e->next->prev = e;
+        }else{
+            s->last[k] = e;
+            s->last_pos[k] = s->base;
+        }
+        s->first[k] = e;
+        s->first_pos[k] = s->base;
+    }
+}
+
+/* skip_add_back(): the new node, at position pos, comes after every node with an entry */
+static void skip_add_back(list_skip_t *s, node_t *n, long pos){
+    int h = skip_height(s);
+    skip_entry_t *tower[LIST_SKIP_LEVELS];
+    if(!skip_tower(s, n, h, tower)){
+        return;
+    }
+    for(int k = 0; k < h; k++){
+        skip_entry_t *e = tower[k];
+        e->prev = s->last[k];
+        if(e->prev != NULL){
+            e->prev->next = e;
+            e->prev->width = pos - s->last_pos[k];
+        }else{
+            s->first[k] = e;
+            s->first_pos[k] = pos;
+        }
+        s->last[k] = e;
+        s->last_pos[k] = pos;
+    }
+}
+
+/* skip_path(): skip layer *, position and two array parameters, no return value; find, on every
+   level, the last entry before that position (NULL if there isn't one) and where it is */
+static void skip_path(list_skip_t *s, long pos, skip_entry_t **before, long *before_pos){
+    skip_entry_t *cur = NULL;
+    long cur_pos = 0;
+    for(int k = LIST_SKIP_LEVELS - 1; k >= 0; k--){
+        if(k >= s->levels){
+            before[k] = NULL;
+            continue;
+        }
+        if(cur == NULL && s->first[k] != NULL && s->first_pos[k] < pos){
+            cur = s->first[k];
+            cur_pos = s->first_pos[k];
+        }
+        if(cur != NULL){
+            while(cur->next != NULL && cur_pos + cur->width < pos){
+                cur_pos += cur->width;
+                cur = cur->next;
+            }
+        }
+        before[k] = cur;
+        before_pos[k] = cur_pos;
+        if(cur != NULL){
+            cur = cur->down;
+        }
+    }
+}
+
+/* skip_add_middle(): the new node goes at position pos, and everything from there on moves up
+   one */
+static void skip_add_middle(list_skip_t *s, node_t *n, long pos){
+    skip_entry_t *before[LIST_SKIP_LEVELS];
+    long before_pos[LIST_SKIP_LEVELS];
+    skip_path(s, pos, before, before_pos);
+    int h = skip_height(s);
+    skip_entry_t *tower[LIST_SKIP_LEVELS];
+    if(!skip_tower(s, n, h, tower)){
+        return;
+    }
+    for(int k = 0; k < s->levels; k++){
+        skip_entry_t *b = before[k];
+        skip_entry_t *after = b != NULL ? b->next : s->first[k];
+        /* where the next entry is once it has moved up */
+        long after_pos = b != NULL ? before_pos[k] + b->width + 1 : s->first_pos[k] + 1;
+        if(after != NULL){
+            s->last_pos[k]++;
+        }
+        if(k < h){
+            skip_entry_t *e = tower[k];
+            e->prev = b;
+            e->next = after;
+            if(after != NULL){
+                e->width = after_pos - pos;
+                after->prev = e;
+            }else{
+                s->last[k] = e;
+                s->last_pos[k] = pos;
+            }
+            if(b != NULL){
+                b->next = e;
+                b->width = pos - before_pos[k];
+            }else{
+                s->first[k] = e;
+                s->first_pos[k] = pos;
+            }
+        }else if(after != NULL){
+            if(b != NULL){
+                b->width++;
+            }else{
+                s->first_pos[k]++;
+            }
+        }
+    }
+}
+
+/* skip_inserted(): list *, node * and int parameters, no return value; the node was just linked
+   into the list at that index (l->size already counts it). Inserting at the front, or after
+   every node with an entry (appending), is O(1) on average */
+void skip_inserted(list_t *l, node_t *n, int index){
+    list_skip_t *s = l->skip;
+    if(s == NULL || s->stale){
+        return;
+    }
+    long pos = s->base + index;
+    if(index == 0){
+        skip_add_front(s, n);
+    }else if(s->last[0] == NULL || pos > s->last_pos[0]){
+        skip_add_back(s, n, pos);
+    }else{
+        skip_add_middle(s, n, pos);
+    }
+}
+
+/* REMOVING NODES */
+
+/* skip_remove_front(): the node at the front is going */
+static void skip_remove_front(list_skip_t *s, node_t *n){
+    /* a node's entries are always the first ones on their levels, from the bottom up */
+    for(int k = 0; k < s->levels && s->first[k] != NULL && s->first[k]->node == n; k++){
+        skip_entry_t *e = s->first[k];
+        s->first[k] = e->next;
+        if(e->next != NULL){
+            e->next->prev = NULL;
+            s->first_pos[k] = s->base + e->width;
+        }else{
+            s->last[k] = NULL;
+        }
+        skip_entry_free(s, e);
+    }
+    s->base++;
+}
+
+/* skip_remove_back(): the node with the last entries on their levels is going */
+static void skip_remove_back(list_skip_t *s, node_t *n){
+    for(int k = 0; k < s->levels && s->last[k] != NULL && s->last[k]->node == n; k++){
+        skip_entry_t *e = s->last[k];
+        s->last[k] = e->prev;
+        if(e->prev != NULL){
+            s->last_pos[k] -= e->prev->width;
+            e->prev->next = NULL;
+            e->prev->width = 0;
+        }else{
+            s->first[k] = NULL;
+        }
+        skip_entry_free(s, e);
+    }
+}
+
+/* skip_remove_middle(): the node at position pos is going, and everything after it moves down
+   one */
+static void skip_remove_middle(list_skip_t *s, node_t *n, long pos){
+    skip_entry_t *before[LIST_SKIP_LEVELS];
+    long before_pos[LIST_SKIP_LEVELS];
+    skip_path(s, pos, before, before_pos);
+    for(int k = 0; k < s->levels; k++){
+        skip_entry_t *b = before[k];
+        skip_entry_t *e = b != NULL ? b->next : s->first[k];
+        if(e != NULL && e->node == n){
+            /* the node has an entry here: take it out, and the entries on either side join up */
+            if(e->next != NULL){
+                e->next->prev = b;
+                s->last_pos[k]--;
+            }else{
+                s->last[k] = b;
+                s->last_pos[k] = before_pos[k];
+            }
+            if(b != NULL){
+                b->next = e->next;
+                b->width = e->next != NULL ? b->width + e->width - 1 : 0;
+            }else{
+                s->first[k] = e->next;
+                s->first_pos[k] = pos + e->width - 1;
+            }
+            skip_entry_free(s, e);
+        }else if(e != NULL){
+            /* it doesn't, so just everything after it moves down */
+            s->last_pos[k]--;
+            if(b != NULL){
+                b->width--;
+            }else{
+                s->first_pos[k]--;
+            }
+        }
+    }
+}
+
+/* skip_removed(): list *, node * and int parameters, no return value; the node at that index is
+   about to be unlinked (l->size still counts it). Removing from the front, or a node at or after
+   the last entries, is O(1) on average */
+void skip_removed(list_t *l, node_t *n, int index){
+    list_skip_t *s = l->skip;
+    if(s == NULL || s->stale){
+        return;
+    }
+    long pos = s->base + index;
+    if(index == 0){
+        skip_remove_front(s, n);
+    }else if(s->last[0] == NULL || pos > s->last_pos[0]){
+        /* nothing with an entry is at or after it, so nothing has to change */
+    }else if(pos == s->last_pos[0]){
+        skip_remove_back(s, n);
+    }else{
+        skip_remove_middle(s, n, pos);
+    }
+}
+
+/* FINDING NODES */
+
+/* skip_rebuild(): list * parameter, return true if the layer was built again from the chain */
+static bool skip_rebuild(list_t *l){
+    list_skip_t *s = l->skip;
+    skip_clear(s);
+    s->stale = false;
+    long pos = 0;
+    for(node_t *curr_node = l->header->next; curr_node != l->header; curr_node = curr_node->next){
+        skip_add_back(s, curr_node, pos++);
+        if(s->stale){
+            return false;
+        }
+    }
+    return true;
+}
+
+/* skip_node_at(): int, int and list * parameters, return the node at that index, found through
+   the skip layer; or NULL if it isn't worth it (the walk along the chain, whose length is the
+   second int, is short anyway) or the list has no layer that can be used */
+node_t *skip_node_at(int index, int walk, list_t *l){
+    list_skip_t *s = l->skip;
+    if(s == NULL || walk < LIST_SKIP_MIN_WALK || (s->stale && !skip_rebuild(l))){
+        return NULL;
+    }
+    long pos = s->base + index;
+    skip_entry_t *cur = NULL;
+    long cur_pos = 0;
+    for(int k = s->levels - 1; k >= 0; k--){
+        if(cur == NULL){
+            if(s->first[k] == NULL || s->first_pos[k] > pos){
+                continue;
+            }
+            cur = s->first[k];
+            cur_pos = s->first_pos[k];
+        }
+        while(cur->next != NULL && cur_pos + cur->width <= pos){
+            cur_pos += cur->width;
+            cur = cur->next;
+        }
+        if(k > 0){
+            cur = cur->down;
+        }
+    }
+    node_t *curr_node;
+    if(cur == NULL){
+        curr_node = l->header->next;
+        cur_pos = s->base;
+    }else{
+        curr_node = cur->node;
+    }
+    LIST_STAT_ADD(l, traversed, pos - cur_pos);
+    for(; cur_pos < pos; cur_pos++){
+        curr_node = curr_node->next;
+    }
+    return curr_node;
+}
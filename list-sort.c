@@ -0,0 +1,249 @@
+/*
+ *  This file (list-sort.c) holds list_sort and the comparators that come with it.
+ *
+ *  A chain is sorted with a bottom-up merge sort that only changes the nodes' next and prev
+ *  pointers: no value is copied and nothing is allocated, so strings (and cursors) stay exactly
+ *  where they are, in nodes that have just moved. It works like counting in binary. bins[i] is
+ *  either empty or a sorted run made of 2^i pieces of the list; each piece (a stretch of nodes
+ *  that are already in order, often just one) gets merged with bins[0], then the result with
+ *  bins[1], and so on until it reaches an empty bin, just like a carry. At the end the bins are
+ *  merged together. Every merge takes from the run
+ *  that came earlier in the list when two values compare equal, which is what makes it stable.
+ *
+ *  While sorting, the runs are plain singly linked lists ending in NULL; the prev pointers and
+ *  the header are fixed up in one pass at the end.
+ *
+ */
+
+#include <string.h>
+
+#include "list-internal.h"
+
+/* COMPARATORS */
+
+/* cmp_types(): two value types, return how they're ordered across types: by value_type_t, so
+   chars come first, then ints, bools and strings */
+static int cmp_types(value_type_t ta, value_type_t tb){
+    return (ta > tb) - (ta < tb);
+}
+
+/* list_cmp_char(): two values with their types and an (unused) extra pointer, return how they
+   compare: chars by their (unsigned) character codes. Anything else is ordered by type, and two
+   values of some other type count as equal, so they keep their order */
+int list_cmp_char(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    (void) arg;
+    if(ta != VAL_CHAR || tb != VAL_CHAR){
+        return cmp_types(ta, tb);
+    }
+    unsigned char ca = (unsigned char) a.cval;
+    unsigned char cb = (unsigned char) b.cval;
+    return (ca > cb) - (ca < cb);
+}
+
+/* list_cmp_int(): the same as list_cmp_char, for ints (smallest first) */
+int list_cmp_int(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    (void) arg;
+    if(ta != VAL_INT || tb != VAL_INT){
+        return cmp_types(ta, tb);
+    }
+    /* not a.ival - b.ival, which overflows for values far apart */
+    return (a.ival > b.ival) - (a.ival < b.ival);
+}
+
+/* list_cmp_bool(): the same as list_cmp_char, for bools (false first) */
+int list_cmp_bool(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    (void) arg;
+    if(ta != VAL_BOOL || tb != VAL_BOOL){
+        return cmp_types(ta, tb);
+    }
+    return (int) a.bval - (int) b.bval;
+}
+
+/* list_cmp_str(): the same as list_cmp_char, for strings (in strcmp order). Strings from one
+   string table are equal exactly when their pointers are, so that's checked first */
+int list_cmp_str(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    (void) arg;
+    if(ta != VAL_STR || tb != VAL_STR){
+        return cmp_types(ta, tb);
+    }
+    if(a.sval == b.sval){
+        return 0;
+    }
+    return strcmp(a.sval, b.sval);
+}
+
+/* list_cmp_value(): two values with their types and an (unused) extra pointer, return how they
+   compare: by type first (see cmp_types), then with the comparator for that type */
+int list_cmp_value(value_t a, value_type_t ta, value_t b, value_type_t tb, void *arg){
+    if(ta != tb){
+        return cmp_types(ta, tb);
+    }
+    switch(ta){
+        case VAL_CHAR: return list_cmp_char(a, ta, b, tb, arg);
+        case VAL_INT: return list_cmp_int(a, ta, b, tb, arg);
+        case VAL_BOOL: return list_cmp_bool(a, ta, b, tb, arg);
+        case VAL_STR: return list_cmp_str(a, ta, b, tb, arg);
+        default: return 0;
+    }
+}
+
+/* SORTING A CHAIN */
+
+/* Enough bins for any list: bins[i] holds 2^i pieces, and a list holds at most INT_MAX nodes */
+#define LIST_SORT_BINS 32
+
+/* merge_runs(): two sorted runs, comparator and extra pointer, return the start of one sorted run
+   holding both. 'a' must be the run that came first in the list */
+static node_t *merge_runs(node_t *a, node_t *b, list_cmp_fn cmp, void *arg){
+    node_t head;
+    node_t *tail = &head;
+    while(a != NULL && b != NULL){
+        /* the nodes are all over memory, so start fetching the next ones while we compare */
+        __builtin_prefetch(a->next);
+        __builtin_prefetch(b->next);
+        /* <= 0: on a tie, the earlier value goes first */
+        if(cmp(a->val, a->type, b->val, b->type, arg) <= 0){
+            tail->next = a;
+            a = a->next;
+        }else{
+            tail->next = b;
+            b = b->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = a != NULL ? a : b;
+    return head.next;
+}
+
+/* chain_sort(): comparator, extra pointer and list * parameters, no return value */
+static void chain_sort(list_cmp_fn cmp, void *arg, list_t *l){
+    node_t *bins[LIST_SORT_BINS] = { NULL };
+    int used_bins = 0;
+    /* cut the list loose from its header, so the last node's next is NULL */
+    l->header->prev->next = NULL;
+    node_t *curr_node = l->header->next;
+    while(curr_node != NULL){
+        /* take as many nodes as are already in order, not just one: a list that's (nearly)
+           sorted already is then only a few runs long, and done in about one pass */
+        node_t *run = curr_node;
+        node_t *run_end = curr_node;
+        curr_node = curr_node->next;
+        while(curr_node != NULL &&
+              cmp(run_end->val, run_end->type, curr_node->val, curr_node->type, arg) <= 0){
+            run_end = curr_node;
+            curr_node = curr_node->next;
+        }
+        run_end->next = NULL;
+        /* carry the new run up through the full bins. Every bin holds values from before the
+           run, so it goes first */
+        int i = 0;
+        for(; i < used_bins && bins[i] != NULL; i++){
+            run = merge_runs(bins[i], run, cmp, arg);
+            bins[i] = NULL;
+        }
+        if(i == used_bins){
+            used_bins++;
+        }
+        bins[i] = run;
+    }
+    /* the higher a bin, the earlier its values were in the list */
+    node_t *sorted = NULL;
+    for(int i = 0; i < used_bins; i++){
+        if(bins[i] != NULL){
+            sorted = sorted == NULL ? bins[i] : merge_runs(bins[i], sorted, cmp, arg);
+        }
+    }
+    /* put the prev pointers back and close the circle through the header again */
+    node_t *prev = l->header;
+    for(curr_node = sorted; curr_node != NULL; curr_node = curr_node->next){
+        prev->next = curr_node;
+        curr_node->prev = prev;
+        prev = curr_node;
+    }
+    prev->next = l->header;
+    l->header->prev = prev;
+}
+
+/* SORTING AN ARRAY */
+/* Unrolled and ring lists don't have a node per value to relink, so they copy their values out
+   into an array of sort_item_t, sort that, and copy the values back in order. The array is sorted
+   with a bottom-up merge sort too: runs of SORT_RUN values sorted by insertion first, then merged
+   in pairs, doubling the run length each time, until one run is left */
+
+#define SORT_RUN 16
+
+/* merge_items(): source array, the ends of its two runs, destination array, comparator and extra
+   pointer, no return value; merge src[lo..mid) and src[mid..hi) into dst[lo..hi), taking from the
+   first run on a tie */
+static void merge_items(const sort_item_t *src, size_t lo, size_t mid, size_t hi,
+                        sort_item_t *dst, list_cmp_fn cmp, void *arg){
+    size_t i = lo, j = mid, k = lo;
+    while(i < mid && j < hi){
+        if(cmp(src[i].val, src[i].type, src[j].val, src[j].type, arg) <= 0){
+            dst[k++] = src[i++];
+        }else{
+            dst[k++] = src[j++];
+        }
+    }
+    while(i < mid){
+        dst[k++] = src[i++];
+    }
+    while(j < hi){
+        dst[k++] = src[j++];
+    }
+}
+
+/* sort_items(): item array, spare array, count, comparator and extra pointer parameters, return
+   whichever of the two arrays ends up holding the items in order */
+sort_item_t *sort_items(sort_item_t *src, sort_item_t *dst, size_t n, list_cmp_fn cmp, void *arg){
+    for(size_t lo = 0; lo < n; lo += SORT_RUN){
+        size_t hi = lo + SORT_RUN < n ? lo + SORT_RUN : n;
+        for(size_t i = lo + 1; i < hi; i++){
+            sort_item_t item = src[i];
+            size_t j = i;
+            for(; j > lo && cmp(src[j - 1].val, src[j - 1].type, item.val, item.type, arg) > 0; j--){
+                src[j] = src[j - 1];
+            }
+            src[j] = item;
+        }
+    }
+    for(size_t width = SORT_RUN; width < n; width *= 2){
+        for(size_t lo = 0; lo < n; lo += 2 * width){
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            merge_items(src, lo, mid, hi, dst, cmp, arg);
+        }
+        sort_item_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    return src;
+}
+
+/* list_sort(): comparator, extra pointer and list * parameters, return true if the list is now
+   sorted from smallest to largest by the comparator (list_cmp_value if it's NULL). Equal values
+   keep the order they had. A chain is sorted by relinking its nodes, so it can't fail; unrolled
+   and ring lists need a temporary array, so they can run out of memory (and then aren't
+   changed) */
+bool list_sort(list_cmp_fn cmp, void *arg, list_t *l){
+    if(!l){
+        return false;
+    }
+    if(cmp == NULL){
+        cmp = list_cmp_value;
+    }
+    if(l->size < 2){
+        return true;
+    }
+    if(l->mode == LIST_UNROLLED){
+        return ulist_sort(cmp, arg, l);
+    }
+    if(l->mode == LIST_RING){
+        return rlist_sort(cmp, arg, l);
+    }
+    chain_sort(cmp, arg, l);
+    /* the values aren't at their old indices anymore */
+    l->cache_node = NULL;
+    skip_forget(l->skip);
+    return true;
+}
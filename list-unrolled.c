@@ -0,0 +1,520 @@
+/*
+ *  This file (list-unrolled.c) holds the LIST_UNROLLED mode for the linked list demo.
+ *
+ *  An unrolled list is still a doubly-linked, circular list with a header node, exactly like the
+ *  classic one in linkedlist-ref.c. The difference is that each unode_t carries an array of up to
+ *  LIST_UNROLL_SIZE values. Walking the list then means reading neighbouring array slots most of
+ *  the time, which the CPU's cache is very good at, instead of following a pointer per value.
+ *
+ *  Inside a node the used slots always sit next to each other, starting at 'first'. Appending
+ *  fills a node from the left, and pushing to the front fills a brand new node from the right,
+ *  so neither end ever has to shift values around.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "list-internal.h"
+
+/* unode_new(): list * parameter, return an empty node (the spare one if we have it), or NULL if
+   space can't be allocated */
+static unode_t *unode_new(list_t *l){
+    unode_t *n = l->uspare;
+    if(n != NULL){
+        l->uspare = NULL;
+    }else{
+        n = malloc(sizeof(unode_t));
+        if(n == NULL){
+            return NULL;
+        }
+        LIST_STAT_ADD(l, allocs, 1);
+    }
+    n->first = 0;
+    n->count = 0;
+    return n;
+}
+
+/* unode_retire(): list * and node * parameters, no return value; unlink an empty node and keep
+   it as the spare (or free it if we already have one) */
+static void unode_retire(list_t *l, unode_t *n){
+    if(l->ucache_node == n){
+        l->ucache_node = NULL;
+    }
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    if(l->uspare == NULL){
+        l->uspare = n;
+    }else{
+        LIST_STAT_ADD(l, frees, 1);
+        free(n);
+    }
+}
+
+/* ulist_init(): list * parameter, return true if the list's unrolled header was set up */
+bool ulist_init(list_t *l){
+    l->uheader = malloc(sizeof(unode_t));
+    if(l->uheader == NULL){
+        return false;
+    }
+    l->uheader->prev = l->uheader;
+    l->uheader->next = l->uheader;
+    l->uheader->first = 0;
+    l->uheader->count = 0;
+    l->uspare = NULL;
+    return true;
+}
+
+/* ulist_free(): list * parameter, no return value; free every node and string of the list (the
+   list structure itself is left to list_free) */
+void ulist_free(list_t *l){
+    unode_t *n = l->uheader->next;
+    while(n != l->uheader){
+        unode_t *next = n->next;
+        for(int i = n->first; i < n->first + n->count; i++){
+            if(n->tags[i] == VAL_STR){
+                list_free_str(l, n->vals[i].sval);
+            }
+        }
+        free(n);
+        n = next;
+    }
+    free(l->uheader);
+    free(l->uspare);
+}
+
+/* ulist_copy_value(): value, type, slot and list * parameters, return true if the value was stored
+   in the slot (strings get their own copy, just like in the classic list) */
+static bool ulist_copy_value(value_t v, value_type_t t, value_t *slot, list_t *l){
+    switch(t){
+        case VAL_CHAR:
+        case VAL_INT:
+        case VAL_BOOL:
+            *slot = v;
+            return true;
+        case VAL_STR:
+            slot->sval = list_copy_str(l, v.sval);
+            if(slot->sval == NULL){
+                return false;
+            }
+            LIST_STAT_ADD(l, str_bytes, strlen(v.sval) + 1);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* ulist_front_slot(): list * parameter, return the index of a free slot right before the first
+   value (in the first node, or in a fresh node we link in), or -1 if we're out of memory. The
+   node the slot belongs to is the list's first node afterwards */
+static int ulist_front_slot(list_t *l){
+    unode_t *n = l->uheader->next;
+    if(n == l->uheader || n->first == 0){
+        n = unode_new(l);
+        if(n == NULL){
+            return -1;
+        }
+        /* a node made for the front fills up from the right */
+        n->first = LIST_UNROLL_SIZE;
+        n->next = l->uheader->next;
+        n->prev = l->uheader;
+        l->uheader->next->prev = n;
+        l->uheader->next = n;
+    }
+    return n->first - 1;
+}
+
+/* ulist_back_slot(): list * parameter, the same as above but right after the last value */
+static int ulist_back_slot(list_t *l){
+    unode_t *n = l->uheader->prev;
+    if(n == l->uheader || n->first + n->count == LIST_UNROLL_SIZE){
+        n = unode_new(l);
+        if(n == NULL){
+            return -1;
+        }
+        n->prev = l->uheader->prev;
+        n->next = l->uheader;
+        l->uheader->prev->next = n;
+        l->uheader->prev = n;
+    }
+    return n->first + n->count;
+}
+
+/* ulist_drop_if_empty(): list * and node * parameters, no return value; retire the node if the
+   slot we just tried to fill didn't work out and it has nothing in it */
+static void ulist_drop_if_empty(list_t *l, unode_t *n){
+    if(n->count == 0){
+        unode_retire(l, n);
+    }
+}
+
+/* ulist_pushed_front(): list * and node * parameters, no return value; a value was just added to
+   the given (first) node, so every other node's values moved back by one */
+static void ulist_pushed_front(list_t *l, unode_t *n){
+    if(l->ucache_node != NULL && l->ucache_node != n){
+        l->ucache_base++;
+    }
+}
+
+void ulist_push(value_t v, value_type_t t, list_t *l){
+    int slot = ulist_front_slot(l);
+    if(slot < 0){
+        return;
+    }
+    unode_t *n = l->uheader->next;
+    if(!ulist_copy_value(v, t, &n->vals[slot], l)){
+        ulist_drop_if_empty(l, n);
+        return;
+    }
+    n->tags[slot] = t;
+    n->first = slot;
+    n->count++;
+    l->size++;
+    LIST_STAT_GROW(l);
+    ulist_pushed_front(l, n);
+}
+
+void ulist_append(value_t v, value_type_t t, list_t *l){
+    int slot = ulist_back_slot(l);
+    if(slot < 0){
+        return;
+    }
+    unode_t *n = l->uheader->prev;
+    if(!ulist_copy_value(v, t, &n->vals[slot], l)){
+        ulist_drop_if_empty(l, n);
+        return;
+    }
+    n->tags[slot] = t;
+    n->count++;
+    l->size++;
+    LIST_STAT_GROW(l);
+}
+
+bool ulist_push_owned(char *s, list_t *l){
+    int slot = ulist_front_slot(l);
+    if(slot < 0){
+        return false;
+    }
+    unode_t *n = l->uheader->next;
+    s = list_own_str(l, s);
+    if(s == NULL){
+        ulist_drop_if_empty(l, n);
+        return false;
+    }
+    n->vals[slot].sval = s;
+    LIST_STAT_ADD(l, str_bytes, strlen(s) + 1);
+    n->tags[slot] = VAL_STR;
+    n->first = slot;
+    n->count++;
+    l->size++;
+    LIST_STAT_GROW(l);
+    ulist_pushed_front(l, n);
+    return true;
+}
+
+bool ulist_append_owned(char *s, list_t *l){
+    int slot = ulist_back_slot(l);
+    if(slot < 0){
+        return false;
+    }
+    unode_t *n = l->uheader->prev;
+    s = list_own_str(l, s);
+    if(s == NULL){
+        ulist_drop_if_empty(l, n);
+        return false;
+    }
+    n->vals[slot].sval = s;
+    LIST_STAT_ADD(l, str_bytes, strlen(s) + 1);
+    n->tags[slot] = VAL_STR;
+    n->count++;
+    l->size++;
+    LIST_STAT_GROW(l);
+    return true;
+}
+
+/* ulist_take(): list *, node *, slot, ownership and value * parameters, return false if a string
+   couldn't be handed over (out of memory: nothing changes then); otherwise put the value in that
+   slot in *out, with a string either handed over or parked in the list */
+static bool ulist_take(list_t *l, unode_t *n, int slot, bool owned, value_t *out){
+    value_t ret_val = n->vals[slot];
+    if(n->tags[slot] == VAL_STR){
+        ret_val.sval = owned ? list_export_str(l, ret_val.sval) : list_park_str(l, ret_val.sval);
+        if(ret_val.sval == NULL){
+            return false;
+        }
+        LIST_STAT_ADD(l, str_bytes, -(long long) (strlen(ret_val.sval) + 1));
+    }
+    *out = ret_val;
+    return true;
+}
+
+value_t ulist_remove_first(list_t *l, bool owned){
+    unode_t *n = l->uheader->next;
+    if(n == l->uheader){
+        value_t null_val;
+        null_val.sval = NULL;
+        return null_val;
+    }
+    value_t ret_val;
+    if(!ulist_take(l, n, n->first, owned, &ret_val)){
+        ret_val.sval = NULL;
+        return ret_val;
+    }
+    n->first++;
+    n->count--;
+    l->size--;
+    if(l->ucache_node != NULL && l->ucache_node != n){
+        l->ucache_base--;
+    }
+    if(n->count == 0){
+        unode_retire(l, n);
+    }
+    return ret_val;
+}
+
+value_t ulist_remove_last(list_t *l, bool owned){
+    unode_t *n = l->uheader->prev;
+    if(n == l->uheader){
+        value_t null_val;
+        null_val.sval = NULL;
+        return null_val;
+    }
+    value_t ret_val;
+    if(!ulist_take(l, n, n->first + n->count - 1, owned, &ret_val)){
+        ret_val.sval = NULL;
+        return ret_val;
+    }
+    n->count--;
+    l->size--;
+    if(n->count == 0){
+        unode_retire(l, n);
+    }
+    return ret_val;
+}
+
+/* ulist_slot_at(): int, list * and int * parameters, return the node holding the given index
+   (which must be valid) and put the slot within that node in *slot. We skip whole nodes at a
+   time, starting from the front, the back, or the node we found last time, whichever is closest.
+   Like the classic list, this makes going through every index in order cheap */
+static unode_t *ulist_slot_at(int index, list_t *l, int *slot){
+    unode_t *n;
+    int base;
+    int from_back = l->size - 1 - index;
+    if(l->ucache_node != NULL && abs(index - l->ucache_base) < (index < from_back ? index : from_back)){
+        n = l->ucache_node;
+        base = l->ucache_base;
+    }else if(index <= from_back){
+        n = l->uheader->next;
+        base = 0;
+    }else{
+        n = l->uheader->prev;
+        base = l->size - n->count;
+    }
+    while(index >= base + n->count){
+        base += n->count;
+        n = n->next;
+        LIST_STAT_ADD(l, traversed, 1);
+    }
+    while(index < base){
+        n = n->prev;
+        base -= n->count;
+        LIST_STAT_ADD(l, traversed, 1);
+    }
+    l->ucache_node = n;
+    l->ucache_base = base;
+    *slot = n->first + (index - base);
+    return n;
+}
+
+value_t ulist_get(int index, list_t *l){
+    int slot;
+    unode_t *n = ulist_slot_at(index, l, &slot);
+    return n->vals[slot];
+}
+
+value_type_t ulist_get_type(int index, list_t *l){
+    int slot;
+    unode_t *n = ulist_slot_at(index, l, &slot);
+    return n->tags[slot];
+}
+
+/* The searches below hand whole nodes to the kernels in list-simd.c, which answer with a bit per
+   matching slot, so finding a match inside a node is just finding the lowest set bit */
+
+int ulist_count_type(value_type_t t, list_t *l){
+    int found = 0;
+    for(unode_t *n = l->uheader->next; n != l->uheader; n = n->next){
+        found += __builtin_popcount(unode_match_type(n, t));
+    }
+    return found;
+}
+
+/* ulist_find_match(): int, list *, kernel and key parameters, return the index of the first slot
+   at or after the given index that the kernel matches, or -1. 'key' is an int, a char or a
+   value_type_t, depending on the kernel, so it's passed as a pointer */
+static int ulist_find_match(int start, list_t *l,
+                            unsigned int (*match)(const unode_t *, const void *), const void *key){
+    int slot;
+    unode_t *n = ulist_slot_at(start, l, &slot);
+    int base = l->ucache_base;
+    /* slots before the starting one don't count, in the first node only */
+    unsigned int skip = (1u << slot) - 1;
+    for(; n != l->uheader; n = n->next){
+        unsigned int bits = match(n, key) & ~skip;
+        if(bits != 0){
+            return base + (__builtin_ctz(bits) - n->first);
+        }
+        base += n->count;
+        skip = 0;
+    }
+    return -1;
+}
+
+static unsigned int match_type_key(const unode_t *n, const void *key){
+    return unode_match_type(n, *(const value_type_t *) key);
+}
+
+static unsigned int match_int_key(const unode_t *n, const void *key){
+    return unode_match_int(n, *(const int *) key);
+}
+
+static unsigned int match_char_key(const unode_t *n, const void *key){
+    return unode_match_char(n, *(const char *) key);
+}
+
+int ulist_find_type(value_type_t t, int start, list_t *l){
+    return ulist_find_match(start, l, match_type_key, &t);
+}
+
+int ulist_find_int(int x, int start, list_t *l){
+    return ulist_find_match(start, l, match_int_key, &x);
+}
+
+int ulist_find_char(char c, int start, list_t *l){
+    return ulist_find_match(start, l, match_char_key, &c);
+}
+
+bool ulist_contains(value_t v, value_type_t t, list_t *l){
+    /* ints and chars have search kernels of their own */
+    if(t == VAL_INT){
+        return ulist_find_int(v.ival, 0, l) >= 0;
+    }
+    if(t == VAL_CHAR){
+        return ulist_find_char(v.cval, 0, l) >= 0;
+    }
+    /* for the rest, the tags alone rule out most slots */
+    for(unode_t *n = l->uheader->next; n != l->uheader; n = n->next){
+        for(unsigned int m = unode_match_type(n, t); m != 0; m &= m - 1){
+            int i = __builtin_ctz(m);
+            if(value_equal(n->vals[i], t, v, t)){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ulist_concat(list_t *dst, list_t *src){
+    unode_t *first = src->uheader->next;
+    unode_t *last = src->uheader->prev;
+    first->prev = dst->uheader->prev;
+    dst->uheader->prev->next = first;
+    last->next = dst->uheader;
+    dst->uheader->prev = last;
+    dst->size += src->size;
+    LIST_STAT_GROW(dst);
+    src->uheader->next = src->uheader;
+    src->uheader->prev = src->uheader;
+    src->size = 0;
+    src->ucache_node = NULL;
+}
+
+bool ulist_split(list_t *l, int index, list_t *tail){
+    if(index == l->size){
+        return true;
+    }
+    int slot;
+    unode_t *n = ulist_slot_at(index, l, &slot);
+    if(slot != n->first){
+        /* the split falls inside a node: its second half moves into a node of its own */
+        unode_t *half = unode_new(tail);
+        if(half == NULL){
+            return false;
+        }
+        int moved = n->first + n->count - slot;
+        memcpy(half->tags, &n->tags[slot], moved * sizeof(n->tags[0]));
+        memcpy(half->vals, &n->vals[slot], moved * sizeof(n->vals[0]));
+        half->count = moved;
+        n->count -= moved;
+        half->prev = n;
+        half->next = n->next;
+        n->next->prev = half;
+        n->next = half;
+        n = half;
+    }
+    /* now n and everything after it moves to the new list */
+    unode_t *last = l->uheader->prev;
+    n->prev->next = l->uheader;
+    l->uheader->prev = n->prev;
+    n->prev = tail->uheader;
+    tail->uheader->next = n;
+    last->next = tail->uheader;
+    tail->uheader->prev = last;
+    tail->size = l->size - index;
+    l->size = index;
+    LIST_STAT_GROW(tail);
+    l->ucache_node = NULL;
+    return true;
+}
+
+void ulist_foreach(list_t *l, void (*fn)(value_t, value_type_t, void *), void *arg){
+    for(unode_t *n = l->uheader->next; n != l->uheader; n = n->next){
+        for(int i = n->first; i < n->first + n->count; i++){
+            fn(n->vals[i], n->tags[i], arg);
+        }
+    }
+}
+
+/* An unrolled list's values sit in arrays, not in nodes of their own, so there's nothing to relink:
+   they're copied out, sorted (see sort_items in list-sort.c), and copied back into the same
+   slots */
+bool ulist_sort(list_cmp_fn cmp, void *arg, list_t *l){
+    size_t n = (size_t) l->size;
+    sort_item_t *items = malloc(2 * n * sizeof(sort_item_t));
+    if(items == NULL){
+        return false;
+    }
+    LIST_STAT_ADD(l, allocs, 1);
+    size_t k = 0;
+    for(unode_t *u = l->uheader->next; u != l->uheader; u = u->next){
+        for(int i = u->first; i < u->first + u->count; i++){
+            items[k].val = u->vals[i];
+            items[k].type = u->tags[i];
+            k++;
+        }
+    }
+    sort_item_t *sorted = sort_items(items, items + n, n, cmp, arg);
+    k = 0;
+    for(unode_t *u = l->uheader->next; u != l->uheader; u = u->next){
+        for(int i = u->first; i < u->first + u->count; i++){
+            u->vals[i] = sorted[k].val;
+            u->tags[i] = (int8_t) sorted[k].type;
+            k++;
+        }
+    }
+    free(items);
+    LIST_STAT_ADD(l, frees, 1);
+    return true;
+}
+
+void ulist_drop_empty(list_t *l){
+    unode_t *n = l->uheader->next;
+    while(n != l->uheader){
+        unode_t *next = n->next;
+        ulist_drop_if_empty(l, n);
+        n = next;
+    }
+    /* nodes lost values, so the cached node's starting index is probably wrong too */
+    l->ucache_node = NULL;
+}
@@ -7,17 +7,34 @@
  *
  *  This file (list.h) is a header file for the linked list demo.
  *  Contents:
- *      - value_t union (line 22)
- *      - value_type_t enum (line 31)
- *      - node_t struct (line 41)
- *      - list_t struct (line 51)
- *      - function prototypes for lists (line 58)
+ *      - value_t union
+ *      - value_type_t enum
+ *      - node_t struct
+ *      - list_stats_t struct
+ *      - list_mode_t enum (and LIST_UNROLL_SIZE and LIST_RING_MIN)
+ *      - node_pool_t, unode_t, list_intern_t, list_index_t and list_skip_t, which list_t points
+ *        at (they're defined in list-internal.h)
+ *      - list_t struct
+ *      - list_cursor_t struct
+ *      - type masks and callback types for list_reduce, list_map_inplace, list_filter and list_sort
+ *      - list_view_t struct
+ *      - list_sink_fn callback type, for list_write
+ *      - function prototypes for lists
  *
  */
 
+/* This 'include guard' makes sure the contents of this file are only seen once, even if several
+   files (or one file, several times) include it */
+#ifndef LIST_H
+#define LIST_H
+
 /* This line includes the standard boolean library - C doesn't have booleans as a primitive, so we
    have to bring them in with a standard header file */
 #include <stdbool.h> 
+#include <stddef.h>     /* for size_t */
+#include <stdint.h>     /* for int8_t, a one-byte integer */
+
+#include "arena.h"      /* for lists whose memory comes from an arena (list_new_in_arena) */
 
 /* DEFINITION OF VALUE_T UNION */
 /* Our linked list will contain four types of values: chars, ints, bools, or strings */
@@ -38,28 +55,183 @@ typedef enum{
     VAL_NONE = -1
 } value_type_t; /* our nodes will contain these so they know their value's type */
 
+/* Strings shorter than this (counting the null terminator) are stored right inside the node
+   instead of in their own malloc'd buffer */
+#define LIST_SSO_SIZE 15
+
 /* DEFINITION OF NODE_T STRUCT */
 /* Our list nodes will need to contain their values and point to their previous and next nodes */
 typedef struct NODE{
     /* we have to use the type 'struct NODE' since we haven't defined node_t yet */
     struct NODE *prev;
     value_t val;
-    value_type_t type;
     struct NODE *next;
+    /* room for a short string; when it's used, val.sval just points here */
+    char small_str[LIST_SSO_SIZE];
+    /* the value_type_t, squeezed into one byte. A whole enum is 4 bytes and the compiler would
+       pad it out to 8, so this saves a fifth of every node (40 bytes instead of 48) */
+    int8_t type;
 } node_t; /* don't worry, node_t * is still a valid type for prev and next now that it's defined */
 
+/* DEFINITION OF LIST_STATS_T STRUCT */
+/* When the list is compiled with -DLIST_STATS, every list keeps count of what it's been doing.
+   Without that flag none of the counting code exists at all, and list_stats() returns zeros */
+typedef struct{
+    long long allocs;       /* malloc calls made for this list (node blocks, strings, ...) */
+    long long frees;        /* free calls made for this list while it was alive */
+    long long str_bytes;    /* bytes of string data (terminators included) the list holds now */
+    long long traversed;    /* nodes stepped over by list_get and list_get_type */
+    int max_size;           /* the most values the list has ever held at once */
+} list_stats_t;
+
+/* DEFINITION OF LIST_MODE_T ENUM */
+/* A list can store its values in one of a few ways ('modes'); every list function works the
+   same no matter which one you pick, only the speed and memory use change */
+typedef enum{
+    LIST_CHAIN,     /* one value per node_t: the classic linked list described above */
+    LIST_UNROLLED,  /* up to LIST_UNROLL_SIZE values per unode_t (see list-internal.h) */
+    LIST_RING       /* no nodes at all: one growable array of values, used as a circle (see
+                       list-ring.c) */
+} list_mode_t;
+
+/* How many values fit in one node of an unrolled list */
+#define LIST_UNROLL_SIZE 16
+
+/* How many slots a ring list's array starts out with (it never has fewer) */
+#define LIST_RING_MIN 16
+
+/* THE LIST'S INNER WORKINGS */
+/* list_t points at a few more structs: its node pool, the nodes of an unrolled list, a string
+   table, a hash index and a skip layer. Only the list's own .c files look inside them, so their
+   definitions are in list-internal.h; here we just promise they exist, which is all a pointer
+   needs */
+typedef struct NODE_POOL node_pool_t;
+typedef struct UNODE unode_t;
+typedef struct LIST_INTERN list_intern_t;
+typedef struct LIST_INDEX list_index_t;
+typedef struct LIST_SKIP list_skip_t;
+
 /* DEFINITION OF LIST_T STRUCT */
 /* Our lists are doubly-linked and have a reference to the header node and an int size */
 typedef struct{
     node_t *header;
     int size;
+    node_pool_t *pool;  /* where this list's nodes come from (see list-internal.h) */
+    /* list_get remembers the last node it found (and its index) so that walking through the
+       list with increasing indices doesn't start from scratch every time; NULL means 'unknown' */
+    node_t *cache_node;
+    int cache_index;
+    /* list_pop and list_remove_last hand back strings that the list still owns: a long string's
+       buffer is parked here, a short one is copied into popped_small */
+    char *popped_str;
+    char popped_small[LIST_SSO_SIZE];
+    list_mode_t mode;
+    /* only used by LIST_UNROLLED lists: their own header node (header is NULL for them) and one
+       empty node kept around so a list that keeps crossing a node boundary doesn't thrash */
+    unode_t *uheader;
+    unode_t *uspare;
+    /* the unrolled version of list_get's memory: a node, and the index of its first value */
+    unode_t *ucache_node;
+    int ucache_base;
+    /* only used by LIST_RING lists: 'rcap' slots (always a power of 2) of values, and as many
+       one-byte value_type_t tags right after them, in the same allocation. The value at index i is
+       in slot (rhead + i) & (rcap - 1), so the values wrap around from the last slot to slot 0 */
+    value_t *rvals;
+    int8_t *rtags;
+    int rhead;
+    int rcap;
+    /* the string table this list's strings live in, or NULL if every string is its own copy */
+    list_intern_t *intern;
+    /* the arena this list, its nodes and its strings live in, or NULL if they come from malloc */
+    arena_t *arena;
+    /* a LIST_CHAIN list's hash index (see list_use_index), or NULL if it doesn't keep one */
+    list_index_t *index;
+    /* a LIST_CHAIN list's skip layer (see list_use_skip), or NULL if it doesn't keep one */
+    list_skip_t *skip;
+#ifdef LIST_STATS
+    list_stats_t stats; /* see list_stats_t above */
+#endif
 } list_t;
 
+/* DEFINITION OF LIST_CURSOR_T STRUCT */
+/* A cursor is a bookmark in a list: it remembers a node, so moving to the neighbouring value or
+   inserting/removing right there doesn't require walking from one end like list_get does. When
+   the cursor is on the list's header it's 'past the end'. A ring list has no nodes, so its
+   cursors remember an index instead (node is NULL, and an index equal to the size is 'past the
+   end') */
+typedef struct{
+    list_t *list;
+    node_t *node;
+    int index;
+} list_cursor_t;
+
+/* TYPE MASKS AND CALLBACK TYPES */
+/* A type mask picks out some of the value types: LIST_TYPE_BIT(VAL_INT) | LIST_TYPE_BIT(VAL_BOOL)
+   means 'ints and bools'. The callbacks below all get an extra void * that is passed along
+   untouched, so they can use data of their own without any global variables */
+#define LIST_TYPE_BIT(t) (1u << (t))
+#define LIST_ALL_TYPES (LIST_TYPE_BIT(VAL_CHAR) | LIST_TYPE_BIT(VAL_INT) | \
+                        LIST_TYPE_BIT(VAL_BOOL) | LIST_TYPE_BIT(VAL_STR))
+
+/* folds one more value into a running result: (result so far, value, type, extra) -> result */
+typedef value_t (*list_reduce_fn)(value_t, value_t, value_type_t, void *);
+/* joins two running results, the earlier part of the list first: (earlier, later, extra) */
+typedef value_t (*list_combine_fn)(value_t, value_t, void *);
+/* changes a value where it sits: (value *, type, extra) */
+typedef void (*list_map_fn)(value_t *, value_type_t, void *);
+/* decides whether a value stays in the list: (value, type, extra) -> true to keep it */
+typedef bool (*list_keep_fn)(value_t, value_type_t, void *);
+
+/* orders two values: (a, a's type, b, b's type, extra) -> negative if a goes before b, positive
+   if after, 0 if either way is fine */
+typedef int (*list_cmp_fn)(value_t, value_type_t, value_t, value_type_t, void *);
+
+/* Lists with at least this many values per thread are worked on by several threads at once */
+#define LIST_PARALLEL_MIN 65536
+/* ...split into at most this many pieces */
+#define LIST_PARALLEL_MAX_CHUNKS 8
+
+/* DEFINITION OF LIST_VIEW_T STRUCT */
+/* A view is a list saved with list_save, mapped into memory as it is (see list-io.c). It can be
+   read like a list, but never changed; it doesn't have any nodes at all, just the file's arrays of
+   tags and values and its strings */
+typedef struct{
+    void *base;             /* where the file is mapped, and how long it is */
+    size_t len;
+    int size;
+    const int8_t *tags;
+    const uint64_t *vals;   /* a string's 'value' is where it starts in 'heap' */
+    const char *heap;
+} list_view_t;
+
+/* LIST_SINK_FN CALLBACK TYPE */
+/* Where list_write sends its text: (text, length, extra) -> true to keep going. The text isn't
+   null-terminated */
+typedef bool (*list_sink_fn)(const char *, size_t, void *);
+
 /* FUNCTION PROTOTYPES FOR LISTS */
 
 /* list_new(): no parameters, return a pointer to a new list or NULL if space can't be allocated */
 list_t *list_new();
 
+/* list_new_with_capacity(): int parameter, return a pointer to a new list that already has room
+   for that many nodes (so the first 'capacity' pushes/appends don't need to allocate), or NULL if
+   space can't be allocated */
+list_t *list_new_with_capacity(int);
+
+/* list_new_mode(): list_mode_t parameter, return a pointer to a new list that stores its values
+   the given way, or NULL if space can't be allocated */
+list_t *list_new_mode(list_mode_t);
+
+/* list_new_in_arena(): arena * parameter, return a pointer to a new LIST_CHAIN list that gets all
+   of its memory (the list itself, its nodes and its strings) from the arena, or NULL if space
+   can't be allocated. Such a list is never freed piece by piece: list_free does nothing, and
+   rewinding or resetting the arena throws away the whole list at once. Strings handed to
+   list_push_owned are copied into the arena (and the original freed), and strings from the _owned
+   removals are malloc'd copies as usual. It can't use a string table, and it can only trade
+   nodes with lists in the same arena */
+list_t *list_new_in_arena(arena_t *);
+
 /* list_free(): list * parameter, no return value; free all space used by this list */
 void list_free(list_t *);
 
@@ -71,12 +243,49 @@ void list_push(value_t, value_type_t, list_t *);
    end of the list */
 void list_append(value_t, value_type_t, list_t *);
 
-/* list_pop(): list * parameter, return the value from the front of the list and remove it */
+/* list_pop(): list * parameter, return the value from the front of the list and remove it. A
+   string returned this way still belongs to the list: it stays valid until the next list_pop,
+   list_remove_last or list_free on that list, and shouldn't be freed by the caller */
 value_t list_pop(list_t *);
 
-/* list_remove_last(): list * parameter, return the value from the end of the list and remove it */
+/* list_remove_last(): list * parameter, return the value from the end of the list and remove it
+   (strings follow the same rule as list_pop) */
 value_t list_remove_last(list_t *);
 
+/* list_push_owned(): string and list * parameters, return true if the string was added to the
+   front of the list. The string must come from malloc; the list keeps it as-is instead of making
+   a copy, and frees it later. If this returns false, the string is still the caller's */
+bool list_push_owned(char *, list_t *);
+
+/* list_append_owned(): string and list * parameters, return true if the string was added to the
+   end of the list (same rules as list_push_owned) */
+bool list_append_owned(char *, list_t *);
+
+/* list_pop_owned(): list * parameter, like list_pop, but a returned string belongs to the caller
+   (who must free it) instead of to the list */
+value_t list_pop_owned(list_t *);
+
+/* list_remove_last_owned(): list * parameter, like list_remove_last, but a returned string
+   belongs to the caller (who must free it) instead of to the list */
+value_t list_remove_last_owned(list_t *);
+
+/* list_append_array(): values, types, count and list * parameters, return how many of the values
+   were added to the end of the list (all of them, unless we run out of memory or hit a bad type).
+   Much faster than calling list_append once per value */
+size_t list_append_array(const value_t *, const value_type_t *, size_t, list_t *);
+
+/* list_append_array_type(): values, type, count and list * parameters; list_append_array for when
+   every value has the same type */
+size_t list_append_array_type(const value_t *, value_type_t, size_t, list_t *);
+
+/* list_pop_n(): value array, type array (may be NULL), count and list * parameters, return how
+   many values (at most the count) were removed from the front and stored in the arrays, in the
+   order list_pop would return them. Unlike list_pop, strings belong to the caller afterwards */
+size_t list_pop_n(value_t *, value_type_t *, size_t, list_t *);
+
+/* list_remove_last_n(): the same as list_pop_n, but from the end of the list */
+size_t list_remove_last_n(value_t *, value_type_t *, size_t, list_t *);
+
 /* list_size(): list * parameter, return its size */
 int list_size(list_t *);
 
@@ -86,5 +295,274 @@ value_t list_get(int, list_t *);
 /* list_get_type(): int and list * parameters, returns the value type at the given index */
 value_type_t list_get_type(int, list_t *);
 
-/* list_print(): list * parameter, no return value; print the given list */
-void list_print(list_t *);
\ No newline at end of file
+/* list_count_type(): value type and list * parameters, return how many values of that type the
+   list holds */
+int list_count_type(value_type_t, list_t *);
+
+/* list_find_type(): value type, int and list * parameters, return the index of the first value of
+   that type at or after the given index, or -1 if there isn't one */
+int list_find_type(value_type_t, int, list_t *);
+
+/* list_find_int(): int, int and list * parameters, return the index of the first VAL_INT equal to
+   the first int at or after the given index, or -1 if there isn't one */
+int list_find_int(int, int, list_t *);
+
+/* list_find_char(): char, int and list * parameters, return the index of the first VAL_CHAR equal
+   to the char at or after the given index, or -1 if there isn't one */
+int list_find_char(char, int, list_t *);
+
+/* list_stats(): list * parameter, return the list's counters (all zeros unless the list was
+   compiled with -DLIST_STATS) */
+list_stats_t list_stats(list_t *);
+
+/* list_concat(): two list * parameters, return true if every value of the second list was moved
+   to the end of the first (the second list is left empty). No values are copied; the nodes are
+   just relinked (two ring lists have no nodes to relink, so the shorter list's values are copied
+   into the longer one's array). Both lists must use the same mode, the same string table (or
+   none), and the same arena (or none) */
+bool list_concat(list_t *, list_t *);
+
+/* list_splice(): list *, node *, list *, node * and node * parameters, return true if the nodes
+   from 'first' to 'last' (in that order, inclusive) were moved out of the second list and put
+   right before 'pos' in the first one (pos can be the header, meaning 'at the end'). The lists
+   may be the same list, as long as pos isn't one of the nodes being moved. Only for LIST_CHAIN
+   lists using the same string table and arena (or none); takes time proportional to the number
+   of nodes moved, since the sizes have to be kept right */
+bool list_splice(list_t *, node_t *, list_t *, node_t *, node_t *);
+
+/* list_split_at(): int and list * parameters, return a new list holding every value from the
+   given index onward (those values are moved out of the given list), or NULL on error. An index
+   equal to the size gives back an empty list. The new list uses the same string table */
+list_t *list_split_at(list_t *, int);
+
+/* CURSOR FUNCTIONS */
+/* These work on LIST_CHAIN and LIST_RING lists; for unrolled lists list_cursor_begin gives back a
+   cursor that is already past the end and that the other functions ignore. A ring list's cursor
+   is just an index, so it stays on the same value only as long as the list is changed through
+   that cursor (pushing or popping some other way moves every value, but not the cursor) */
+
+/* list_cursor_begin(): list * parameter, return a cursor on the first value (past the end if the
+   list is empty) */
+list_cursor_t list_cursor_begin(list_t *);
+
+/* list_cursor_at(): int and list * parameters, return a cursor on the value at the given index
+   (past the end if there isn't one) */
+list_cursor_t list_cursor_at(int, list_t *);
+
+/* list_cursor_valid(): cursor * parameter, return true if the cursor is on a value */
+bool list_cursor_valid(list_cursor_t *);
+
+/* list_cursor_next(): cursor * parameter, no return value; move to the next value. From the last
+   value it moves past the end, and from past the end it wraps around to the first value */
+void list_cursor_next(list_cursor_t *);
+
+/* list_cursor_prev(): cursor * parameter, no return value; move to the previous value (wrapping
+   the same way) */
+void list_cursor_prev(list_cursor_t *);
+
+/* list_cursor_get(): cursor * parameter, return the value under the cursor */
+value_t list_cursor_get(list_cursor_t *);
+
+/* list_cursor_type(): cursor * parameter, return the type of the value under the cursor (VAL_NONE
+   past the end) */
+value_type_t list_cursor_type(list_cursor_t *);
+
+/* list_cursor_insert_before(): cursor *, value and value type parameters, return true if the value
+   was added right before the cursor (past the end, that means appending). The cursor doesn't
+   move */
+bool list_cursor_insert_before(list_cursor_t *, value_t, value_type_t);
+
+/* list_cursor_insert_after(): cursor *, value and value type parameters, return true if the value
+   was added right after the cursor (past the end, that means pushing). The cursor doesn't move */
+bool list_cursor_insert_after(list_cursor_t *, value_t, value_type_t);
+
+/* list_cursor_erase(): cursor * parameter, return the value under the cursor and remove it; the
+   cursor moves on to the next value. Strings follow the same rule as list_pop */
+value_t list_cursor_erase(list_cursor_t *);
+
+/* BULK TRAVERSAL FUNCTIONS */
+/* These visit every value whose type is in the mask, front to back, without list_get's walking.
+   Big lists (see LIST_PARALLEL_MIN) are cut into pieces that separate threads work on at the
+   same time, so the callbacks must be safe to call from several threads at once. How a list is
+   cut depends only on the list, never on the machine, so the results are the same everywhere */
+
+/* list_reduce(): reduce callback, combine callback, starting value, type mask, extra pointer and
+   list * parameters, return the result of folding every matching value into the starting value
+   with the reduce callback. Each piece of a big list is folded on its own, starting from the
+   starting value, and the pieces' results are joined in order with the combine callback; so the
+   starting value must not change a result it's combined with (0 for a sum, say). A NULL combine
+   callback means the list is always folded by one thread, front to back */
+value_t list_reduce(list_reduce_fn, list_combine_fn, value_t, unsigned int, void *, list_t *);
+
+/* list_map_inplace(): map callback, type mask, extra pointer and list * parameters, no return
+   value; call the callback on every matching value so it can change it. Types can't change, and
+   neither can a string's pointer: the callback may edit a string's characters, as long as it
+   doesn't make it longer. In a list with a string table, strings are skipped */
+void list_map_inplace(list_map_fn, unsigned int, void *, list_t *);
+
+/* list_filter(): keep callback, type mask, extra pointer and list * parameters, return how many
+   values were removed: every value whose type is in the mask and for which the callback returns
+   false. Values of other types always stay. The order of what's left doesn't change. A list
+   with a string table is filtered by one thread */
+int list_filter(list_keep_fn, unsigned int, void *, list_t *);
+
+/* INDEXED ACCESS */
+/* list_get and list_get_type walk from whichever end (or the last position they found) is
+   closest, which is quick for nearby indices but O(n) for one in the middle. A list with a skip
+   layer gets there in O(log n) instead, whatever the index, and a ring list in O(1) */
+
+/* list_use_skip(): list * parameter, return true if the list keeps a skip layer from now on (it's
+   built the first time it's needed). Only LIST_CHAIN lists that don't live in an arena can have
+   one. Pushing, appending, popping and removing from the end keep it up to date in O(1) on
+   average, and list_insert_at and list_remove_at in O(log n); any other change in the middle of
+   the list (list_sort, list_filter, list_concat, a cursor's insert or erase...) makes the next
+   list_get build it again */
+bool list_use_skip(list_t *);
+
+/* list_insert_at(): int, value, value type and list * parameters, return true if the value was
+   added so that it's now at that index (0 to the list's size; the size means 'at the end'). In
+   the middle of an unrolled list this isn't supported, and returns false. A ring list shifts the
+   values on whichever side of the index has fewer of them by one slot */
+bool list_insert_at(int, value_t, value_type_t, list_t *);
+
+/* list_remove_at(): int and list * parameters, return the value at that index and remove it.
+   Strings follow the same rule as list_pop. In the middle of an unrolled list this isn't
+   supported, and nothing is removed */
+value_t list_remove_at(int, list_t *);
+
+/* LOOKING UP VALUES */
+/* A list can find a value by walking it, or much faster with a hash index. Values are the same
+   when their types are, and the part of value_t that type uses is equal (strings are compared by
+   their characters, not their pointers) */
+
+/* list_use_index(): list * parameter, return true if the list keeps a hash index of its values
+   from now on (it's built the first time it's needed). Only LIST_CHAIN lists that don't live in
+   an arena can have one. Pushing, appending, popping and removing from the end keep it up to date
+   as they go; bulk changes (list_concat, list_splice, list_split_at, list_filter,
+   list_map_inplace) make the next lookup build it again */
+bool list_use_index(list_t *);
+
+/* list_contains(): value, value type and list * parameters, return true if the value is in the
+   list. Expected O(1) with an index, O(n) without */
+bool list_contains(value_t, value_type_t, list_t *);
+
+/* list_find_node(): value, value type and list * parameters, return a node holding that value, or
+   NULL if there isn't one (or the list isn't a LIST_CHAIN list). Without an index it's the first
+   such node; with one, it can be any of them. The node stays good until it's removed from the
+   list */
+node_t *list_find_node(value_t, value_type_t, list_t *);
+
+/* list_remove_value(): value, value type and list * parameters, return true if the value was in
+   the list and one copy of it (the one list_find_node finds) was removed. Its string is freed
+   right away, since it isn't handed back. LIST_CHAIN and LIST_RING lists only */
+bool list_remove_value(value_t, value_type_t, list_t *);
+
+/* SORTING */
+/* Values of different types are always ordered by type, the way value_type_t lists them: chars,
+   then ints, bools and strings. The comparators below can be passed to list_sort (their extra
+   pointer isn't used); each one orders the values of its own type, and counts any two values of
+   another same type as equal, so sorting with list_cmp_int, say, puts the ints in order and leaves
+   the chars, bools and strings grouped by type but otherwise where they were */
+
+/* list_cmp_char(): chars by character code (as unsigned chars) */
+int list_cmp_char(value_t, value_type_t, value_t, value_type_t, void *);
+/* list_cmp_int(): ints from smallest to largest */
+int list_cmp_int(value_t, value_type_t, value_t, value_type_t, void *);
+/* list_cmp_bool(): false before true */
+int list_cmp_bool(value_t, value_type_t, value_t, value_type_t, void *);
+/* list_cmp_str(): strings in strcmp order */
+int list_cmp_str(value_t, value_type_t, value_t, value_type_t, void *);
+/* list_cmp_value(): every type in its own order, using the four comparators above */
+int list_cmp_value(value_t, value_type_t, value_t, value_type_t, void *);
+
+/* list_sort(): comparator, extra pointer and list * parameters, return true if the list was sorted
+   from smallest to largest (list_cmp_value is used if the comparator is NULL). The sort is stable:
+   equal values keep their order. A LIST_CHAIN list is sorted by relinking its nodes, without
+   allocating or copying anything, so cursors stay on the same values; an unrolled or ring list
+   sorts a temporary copy of its values, and returns false (unchanged) if there's no memory for
+   it */
+bool list_sort(list_cmp_fn, void *, list_t *);
+
+/* STRING TABLES */
+/* A list using a string table stores one shared copy of each different string instead of a copy
+   per value (see list-intern.c). Everything else works the same, except:
+       - its strings must never be changed, since other values share them (list_map_inplace
+         leaves them alone)
+       - strings from list_pop and list_remove_last are the table's; they stay valid until the
+         next removal, as usual
+       - strings from the _owned functions are fresh copies, as usual */
+
+/* list_intern_new(): no parameters, return a pointer to a new string table that lists can share,
+   or NULL if space can't be allocated */
+list_intern_t *list_intern_new();
+
+/* list_intern_free(): table * parameter, no return value; let go of a table from list_intern_new.
+   It's really freed once the lists using it are too */
+void list_intern_free(list_intern_t *);
+
+/* list_use_intern(): table * and list * parameters, return true if the (empty) list now keeps its
+   strings in that table. A NULL table gives the list a private table of its own. Fails if the list
+   isn't empty or lives in an arena, or if there's no memory for a private table */
+bool list_use_intern(list_intern_t *, list_t *);
+
+/* list_intern_of(): list * parameter, return the list's string table, or NULL if it has none */
+list_intern_t *list_intern_of(list_t *);
+
+/* list_intern_find(): string and table * parameters, return the table's copy of that string, or
+   NULL if no list holds it. Any value in a list using the table is that string exactly when its
+   pointer is equal to this one */
+const char *list_intern_find(const char *, list_intern_t *);
+
+/* list_intern_count(): table * parameter, return how many different strings it holds */
+size_t list_intern_count(list_intern_t *);
+
+/* SAVING AND LOADING */
+/* A saved list is a header, then every value's type, then every value, then the strings (see
+   list-io.c). Files are only meant to be read on the same kind of machine that wrote them */
+
+/* list_save(): file descriptor and list * parameters, return true if the whole list was written
+   to the file. The file isn't closed */
+bool list_save(int, list_t *);
+
+/* list_load(): file path parameter, return a pointer to a new LIST_CHAIN list holding the values
+   saved in that file, or NULL if it can't be read, isn't a saved list, or space can't be
+   allocated */
+list_t *list_load(const char *);
+
+/* list_view_open(): file path parameter, return a pointer to a read-only view of the list saved in
+   that file, or NULL on error. Opening a view doesn't copy or allocate anything per value */
+list_view_t *list_view_open(const char *);
+
+/* list_view_close(): list_view * parameter, no return value; unmap and free the view */
+void list_view_close(list_view_t *);
+
+/* list_view_size(): list_view * parameter, return how many values it holds */
+int list_view_size(const list_view_t *);
+
+/* list_view_get(): int and list_view * parameters, return the value at the given index, in O(1).
+   A string points into the mapped file: it must not be changed, and it's only good until
+   list_view_close */
+value_t list_view_get(int, const list_view_t *);
+
+/* list_view_get_type(): int and list_view * parameters, return the type at the given index
+   (VAL_NONE if there's no such index) */
+value_type_t list_view_get_type(int, const list_view_t *);
+
+/* FORMATTING */
+/* These make the same text list_print shows (without its newline), without calling printf */
+
+/* list_write(): sink callback, extra pointer and list * parameters, return true if the whole list
+   was sent to the sink as text. The text is gathered in a buffer and the sink only gets called
+   when the buffer is full and at the end; false means the sink asked to stop early */
+bool list_write(list_sink_fn, void *, list_t *);
+
+/* list_format(): list *, buffer and capacity parameters, return the length of the list's text.
+   Like snprintf, at most capacity - 1 characters go in the buffer, then a null terminator, so a
+   return value of the capacity or more means the text was cut short */
+size_t list_format(list_t *, char *, size_t);
+
+/* list_print(): list * parameter, no return value; print the given list (when the demo's
+   DEBUG_MODE is on), using list_write */
+void list_print(list_t *);
+
+#endif /* LIST_H */
@@ -0,0 +1,515 @@
+/*
+ *  This file (plist.c) holds the persistent list (plist_t) for the linked list demo.
+ *
+ *  Pushing is the easy half: a singly-linked list can grow at the front without changing anything
+ *  that's already there, so a new version just gets a new first cell pointing at the old one.
+ *
+ *  Appending to a singly-linked list would change the last cell, so appended values live in a
+ *  different shape: a tree with PLIST_WIDTH children per node whose leaves, left to right, hold
+ *  the values in order, plus one 'tail' leaf that isn't in the tree yet. Appending normally just
+ *  fills the next slot of the tail (no version can see that slot yet, so nothing it reads
+ *  changes). When the tail is full it goes into the tree by "path copying": the nodes from the
+ *  root down to where it goes are copied, the copies point at the new leaf, and every other node
+ *  is shared with the old version. That's at most one node per level, and it only happens once
+ *  every PLIST_WIDTH appends.
+ *
+ *  Nodes and cells are never changed once a version can see them (apart from their reference
+ *  counts, which are atomic), which is why readers don't need locks.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "plist.h"
+
+/* plist_copy_value(): value * destination, value and value type parameters, return false if the
+   type isn't one a list can hold or space for a string copy can't be allocated; store the value,
+   copying a string */
+static bool plist_copy_value(value_t *dst, value_t v, value_type_t t){
+    switch(t){
+        case VAL_CHAR:
+        case VAL_INT:
+        case VAL_BOOL:
+            *dst = v;
+            return true;
+        case VAL_STR:
+            if(v.sval != NULL){
+                size_t len = strlen(v.sval) + 1;
+                char *copy = malloc(len);
+                if(copy == NULL){
+                    return false;
+                }
+                memcpy(copy, v.sval, len);
+                v.sval = copy;
+            }
+            *dst = v;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* NODES AND CELLS */
+
+/* plist_leaf_new(): no parameters, return a new empty leaf (one reference) or NULL if space can't
+   be allocated */
+static plist_node_t *plist_leaf_new(void){
+    plist_node_t *n = malloc(sizeof(plist_node_t));
+    if(n == NULL){
+        return NULL;
+    }
+    atomic_init(&n->refs, 1);
+    atomic_init(&n->used, 0);
+    return n;
+}
+
+/* plist_branch_new(): no parameters, return a new branch with no children (one reference) or NULL
+   if space can't be allocated */
+static plist_node_t *plist_branch_new(void){
+    plist_node_t *n = plist_leaf_new();
+    if(n != NULL){
+        memset(n->kids, 0, sizeof(n->kids));
+    }
+    return n;
+}
+
+/* plist_retain(): node * parameter, no return value; count one more reference to the node. Taking
+   a reference needs no ordering: whoever hands it over already holds one */
+static void plist_retain(plist_node_t *n){
+    atomic_fetch_add_explicit(&n->refs, 1, memory_order_relaxed);
+}
+
+/* plist_node_release(): node * and level parameters, no return value; let go of one reference to
+   a node 'level' bits above the leaves, freeing it and letting go of its children (or strings)
+   if that was the last one */
+static void plist_node_release(plist_node_t *n, int level){
+    if(atomic_fetch_sub_explicit(&n->refs, 1, memory_order_acq_rel) != 1){
+        return;
+    }
+    if(level > 0){
+        for(int i = 0; i < PLIST_WIDTH && n->kids[i] != NULL; i++){
+            plist_node_release(n->kids[i], level - PLIST_BITS);
+        }
+    }else{
+        int used = atomic_load_explicit(&n->used, memory_order_relaxed);
+        for(int i = 0; i < used; i++){
+            if(n->types[i] == VAL_STR){
+                free(n->vals[i].sval);
+            }
+        }
+    }
+    free(n);
+}
+
+/* plist_cell_release(): cell * parameter, no return value; let go of one reference to the cell,
+   and keep going down the list for as long as that frees a cell (a loop rather than recursion,
+   since a list of pushes can be very long) */
+static void plist_cell_release(plist_cell_t *c){
+    while(c != NULL && atomic_fetch_sub_explicit(&c->refs, 1, memory_order_acq_rel) == 1){
+        plist_cell_t *next = c->next;
+        if(c->type == VAL_STR){
+            free(c->val.sval);
+        }
+        free(c);
+        c = next;
+    }
+}
+
+/* plist_leaf_copy(): leaf * and count parameters, return a new leaf holding copies of its first
+   'count' values, with slot 'count' already claimed (used = count + 1), or NULL if space can't
+   be allocated */
+static plist_node_t *plist_leaf_copy(const plist_node_t *src, int count){
+    plist_node_t *n = plist_leaf_new();
+    if(n == NULL){
+        return NULL;
+    }
+    for(int i = 0; i < count; i++){
+        if(!plist_copy_value(&n->vals[i], src->vals[i], src->types[i])){
+            atomic_store_explicit(&n->used, i, memory_order_relaxed);
+            plist_node_release(n, 0);
+            return NULL;
+        }
+        n->types[i] = src->types[i];
+    }
+    atomic_store_explicit(&n->used, count + 1, memory_order_relaxed);
+    return n;
+}
+
+/* THE TREE */
+
+/* plist_tree_path(): level and leaf * parameters, return a chain of new branches from 'level' down
+   to the leaf (which gains a reference), or NULL if space can't be allocated */
+static plist_node_t *plist_tree_path(int level, plist_node_t *leaf){
+    if(level == 0){
+        plist_retain(leaf);
+        return leaf;
+    }
+    plist_node_t *b = plist_branch_new();
+    if(b == NULL){
+        return NULL;
+    }
+    b->kids[0] = plist_tree_path(level - PLIST_BITS, leaf);
+    if(b->kids[0] == NULL){
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+/* plist_tree_put(): position, level, branch * and leaf * parameters, return a copy of the branch
+   (at 'level') with the leaf added at value position 'count', sharing every other child, or NULL
+   if space can't be allocated */
+static plist_node_t *plist_tree_put(int count, int level, const plist_node_t *node,
+                                    plist_node_t *leaf){
+    plist_node_t *copy = plist_branch_new();
+    if(copy == NULL){
+        return NULL;
+    }
+    int slot = (count >> level) & PLIST_MASK;
+    plist_node_t *kid;
+    if(level == PLIST_BITS){
+        plist_retain(leaf);
+        kid = leaf;
+    }else if(node->kids[slot] != NULL){
+        kid = plist_tree_put(count, level - PLIST_BITS, node->kids[slot], leaf);
+    }else{
+        kid = plist_tree_path(level - PLIST_BITS, leaf);
+    }
+    if(kid == NULL){
+        free(copy);
+        return NULL;
+    }
+    /* only now that nothing can fail does the copy take references to the shared children */
+    for(int i = 0; i < slot; i++){
+        plist_retain(node->kids[i]);
+        copy->kids[i] = node->kids[i];
+    }
+    copy->kids[slot] = kid;
+    return copy;
+}
+
+/* plist_tree_add(): plist * and shift * parameters, return a new root for the version's tree with
+   its (full) tail added as the last leaf, storing the new tree's shift, or NULL if space can't
+   be allocated */
+static plist_node_t *plist_tree_add(const plist_t *p, int *shift){
+    int count = p->size - p->pushed - p->tail_len;      /* values already in the tree */
+    if(p->root == NULL){
+        *shift = PLIST_BITS;
+        return plist_tree_path(PLIST_BITS, p->tail);
+    }
+    if((count >> PLIST_BITS) < (1 << p->shift)){
+        *shift = p->shift;
+        return plist_tree_put(count, p->shift, p->root, p->tail);
+    }
+    /* every leaf under the root is taken: the tree grows a level, with the old root on the left */
+    plist_node_t *root = plist_branch_new();
+    if(root == NULL){
+        return NULL;
+    }
+    root->kids[1] = plist_tree_path(p->shift, p->tail);
+    if(root->kids[1] == NULL){
+        free(root);
+        return NULL;
+    }
+    plist_retain(p->root);
+    root->kids[0] = p->root;
+    *shift = p->shift + PLIST_BITS;
+    return root;
+}
+
+/* plist_leaf_at(): index, plist * and slot * parameters, return the leaf holding the appended value
+   at the given index (counting from the first appended value), storing its slot there */
+static const plist_node_t *plist_leaf_at(int index, const plist_t *p, int *slot){
+    int count = p->size - p->pushed - p->tail_len;
+    *slot = index & PLIST_MASK;     /* the tree holds whole leaves, so this works for the tail */
+    if(index >= count){
+        return p->tail;
+    }
+    const plist_node_t *n = p->root;
+    for(int level = p->shift; level > 0; level -= PLIST_BITS){
+        n = n->kids[(index >> level) & PLIST_MASK];
+    }
+    return n;
+}
+
+/* VERSIONS */
+
+/* plist_version(): plist * parameter, return a new version with the same contents that holds its
+   own reference to each part (the caller replaces whichever part it changes), or NULL if space
+   can't be allocated */
+static plist_t *plist_version(const plist_t *p){
+    plist_t *next = malloc(sizeof(plist_t));
+    if(next == NULL){
+        return NULL;
+    }
+    atomic_init(&next->refs, 1);
+    next->size = p->size;
+    next->pushed = p->pushed;
+    next->shift = p->shift;
+    next->tail_len = p->tail_len;
+    next->front = p->front;
+    next->root = p->root;
+    next->tail = p->tail;
+    return next;
+}
+
+/* plist_new(): no parameters, return a pointer to a new empty version or NULL if space can't be
+   allocated */
+plist_t *plist_new(){
+    plist_t empty = { .size = 0 };
+    return plist_version(&empty);
+}
+
+/* plist_snapshot(): plist * parameter, return the same version with one more reference to it */
+plist_t *plist_snapshot(plist_t *p){
+    if(p != NULL){
+        atomic_fetch_add_explicit(&p->refs, 1, memory_order_relaxed);
+    }
+    return p;
+}
+
+/* plist_release(): plist * parameter, no return value; let go of one reference to the version */
+void plist_release(plist_t *p){
+    if(p == NULL || atomic_fetch_sub_explicit(&p->refs, 1, memory_order_acq_rel) != 1){
+        return;
+    }
+    plist_cell_release(p->front);
+    if(p->root != NULL){
+        plist_node_release(p->root, p->shift);
+    }
+    if(p->tail != NULL){
+        plist_node_release(p->tail, 0);
+    }
+    free(p);
+}
+
+/* plist_push(): value, value type, and plist * parameters, return a new version with the value at
+   the front, or NULL if space can't be allocated */
+plist_t *plist_push(value_t v, value_type_t t, plist_t *p){
+    if(p == NULL){
+        return NULL;
+    }
+    plist_cell_t *cell = malloc(sizeof(plist_cell_t));
+    if(cell == NULL){
+        return NULL;
+    }
+    plist_t *next = plist_version(p);
+    if(next == NULL || !plist_copy_value(&cell->val, v, t)){
+        free(next);
+        free(cell);
+        return NULL;
+    }
+    atomic_init(&cell->refs, 1);
+    cell->type = t;
+    cell->next = p->front;      /* the new cell takes over the version's reference to this */
+    if(p->front != NULL){
+        atomic_fetch_add_explicit(&p->front->refs, 1, memory_order_relaxed);
+    }
+    if(p->root != NULL){
+        plist_retain(p->root);
+    }
+    if(p->tail != NULL){
+        plist_retain(p->tail);
+    }
+    next->front = cell;
+    next->pushed++;
+    next->size++;
+    return next;
+}
+
+/* plist_append(): value, value type, and plist * parameters, return a new version with the value
+   at the back, or NULL if space can't be allocated */
+plist_t *plist_append(value_t v, value_type_t t, plist_t *p){
+    if(p == NULL){
+        return NULL;
+    }
+    value_t copy;
+    plist_t *next = plist_version(p);
+    if(next == NULL || !plist_copy_value(&copy, v, t)){
+        free(next);
+        return NULL;
+    }
+
+    plist_node_t *tail;
+    if(p->tail != NULL && p->tail_len < PLIST_WIDTH){
+        /* Room in the tail. If no one has used the slot after this version's last value, claim it
+           and share the leaf; if someone has (this isn't the newest version), copy the values
+           this version can see into a leaf of our own */
+        int expected = p->tail_len;
+        if(atomic_compare_exchange_strong_explicit(&p->tail->used, &expected, p->tail_len + 1,
+                                                   memory_order_acq_rel, memory_order_relaxed)){
+            tail = p->tail;
+            plist_retain(tail);
+        }else{
+            tail = plist_leaf_copy(p->tail, p->tail_len);
+        }
+        if(tail == NULL){
+            goto failed;
+        }
+        if(p->root != NULL){
+            plist_retain(p->root);
+        }
+        next->tail_len++;
+    }else{
+        /* no tail yet, or it's full: the full one goes into the tree and a new one starts */
+        tail = plist_leaf_new();
+        if(tail == NULL){
+            goto failed;
+        }
+        atomic_store_explicit(&tail->used, 1, memory_order_relaxed);
+        if(p->tail != NULL){
+            next->root = plist_tree_add(p, &next->shift);
+            if(next->root == NULL){
+                free(tail);
+                goto failed;
+            }
+        }
+        next->tail_len = 1;
+    }
+    tail->vals[next->tail_len - 1] = copy;
+    tail->types[next->tail_len - 1] = (int8_t) t;
+    next->tail = tail;
+    next->size++;
+    if(p->front != NULL){
+        atomic_fetch_add_explicit(&p->front->refs, 1, memory_order_relaxed);
+    }
+    return next;
+
+failed:
+    if(t == VAL_STR){
+        free(copy.sval);
+    }
+    free(next);
+    return NULL;
+}
+
+/* READING */
+
+/* plist_size(): plist * parameter, return how many values the version holds */
+int plist_size(const plist_t *p){
+    return p == NULL ? 0 : p->size;
+}
+
+/* plist_get(): int and plist * parameters, return the value at the given index */
+value_t plist_get(int index, const plist_t *p){
+    if(p == NULL || index < 0 || index >= p->size){
+        value_t null_val;
+        null_val.sval = NULL;
+        return null_val;
+    }
+    if(index < p->pushed){
+        const plist_cell_t *c = p->front;
+        while(index-- > 0){
+            c = c->next;
+        }
+        return c->val;
+    }
+    int slot;
+    const plist_node_t *leaf = plist_leaf_at(index - p->pushed, p, &slot);
+    return leaf->vals[slot];
+}
+
+/* plist_get_type(): int and plist * parameters, return the value type at the given index */
+value_type_t plist_get_type(int index, const plist_t *p){
+    if(p == NULL || index < 0 || index >= p->size){
+        return VAL_NONE;
+    }
+    if(index < p->pushed){
+        const plist_cell_t *c = p->front;
+        while(index-- > 0){
+            c = c->next;
+        }
+        return c->type;
+    }
+    int slot;
+    const plist_node_t *leaf = plist_leaf_at(index - p->pushed, p, &slot);
+    return (value_type_t) leaf->types[slot];
+}
+
+/* plist_foreach(): visit callback, extra pointer and plist * parameters, return how many values the
+   callback was called on. The tree is read a whole leaf at a time */
+int plist_foreach(plist_visit_fn visit, void *arg, const plist_t *p){
+    if(p == NULL || visit == NULL){
+        return 0;
+    }
+    int visited = 0;
+    for(const plist_cell_t *c = p->front; visited < p->pushed; c = c->next){
+        visited++;
+        if(!visit(c->val, c->type, arg)){
+            return visited;
+        }
+    }
+    int appended = p->size - p->pushed;
+    for(int i = 0; i < appended; i += PLIST_WIDTH){
+        int slot;
+        const plist_node_t *leaf = plist_leaf_at(i, p, &slot);
+        int end = appended - i < PLIST_WIDTH ? appended - i : PLIST_WIDTH;
+        for(slot = 0; slot < end; slot++){
+            visited++;
+            if(!visit(leaf->vals[slot], (value_type_t) leaf->types[slot], arg)){
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+/* plist_append_to(): visit callback that appends each value to the list_t in 'arg' */
+static bool plist_append_to(value_t v, value_type_t t, void *arg){
+    list_append(v, t, arg);
+    return true;
+}
+
+/* plist_to_list(): plist * parameter, return a new list_t holding a copy of the version's values.
+   list_append doesn't say when it runs out of space, so a short list means it did */
+list_t *plist_to_list(const plist_t *p){
+    list_t *l = list_new();
+    if(l == NULL){
+        return NULL;
+    }
+    plist_foreach(plist_append_to, l, p);
+    if(list_size(l) != plist_size(p)){
+        list_free(l);
+        return NULL;
+    }
+    return l;
+}
+
+/* SHARING VERSIONS BETWEEN THREADS */
+
+/* plist_share_init(): plist_share * and plist * parameters, no return value; start sharing the
+   version */
+void plist_share_init(plist_share_t *s, plist_t *p){
+    s->current = plist_snapshot(p);
+    pthread_mutex_init(&s->lock, NULL);
+}
+
+/* plist_share_set(): plist_share * and plist * parameters, no return value; make the version the
+   one plist_share_get hands out. The old version is let go of outside the lock, since that may
+   free a lot */
+void plist_share_set(plist_share_t *s, plist_t *p){
+    plist_snapshot(p);
+    pthread_mutex_lock(&s->lock);
+    plist_t *old = s->current;
+    s->current = p;
+    pthread_mutex_unlock(&s->lock);
+    plist_release(old);
+}
+
+/* plist_share_get(): plist_share * parameter, return a snapshot of the newest version. The lock
+   only stops the version from being let go of between reading the pointer and counting it */
+plist_t *plist_share_get(plist_share_t *s){
+    pthread_mutex_lock(&s->lock);
+    plist_t *p = plist_snapshot(s->current);
+    pthread_mutex_unlock(&s->lock);
+    return p;
+}
+
+/* plist_share_destroy(): plist_share * parameter, no return value; let go of the shared version
+   and the lock */
+void plist_share_destroy(plist_share_t *s){
+    plist_release(s->current);
+    s->current = NULL;
+    pthread_mutex_destroy(&s->lock);
+}
@@ -0,0 +1,158 @@
+/*
+ *  This file (plist.h) is the header file for the persistent list in the linked list demo.
+ *
+ *  A plist_t is a list that never changes once it's made. plist_push and plist_append don't
+ *  touch the list you give them: they return a new list ("version") with the value added, and the
+ *  old version stays exactly as it was. The two share almost all of their memory, so a new
+ *  version costs about as much as a list_append, and keeping an old one around (a "snapshot")
+ *  costs one counter increment instead of a copy of every value and string.
+ *
+ *  Because nothing in a version ever changes, any number of threads can read the same version at
+ *  once without locks. Memory is reclaimed by reference counting: every version and every node
+ *  counts who points at it, and is freed when the last of them lets go.
+ *
+ *  A writer that keeps appending looks like this:
+ *      plist_t *next = plist_append(v, VAL_INT, cur);
+ *      plist_release(cur);         (unless someone should still see the old version)
+ *      cur = next;
+ *
+ *  Contents:
+ *      - plist_node_t, plist_cell_t, plist_t and plist_share_t structs
+ *      - function prototypes for persistent lists
+ *
+ */
+
+#ifndef PLIST_H
+#define PLIST_H
+
+#include <stdint.h>
+#include <pthread.h>        /* POSIX threads: plist_share_t has a mutex */
+#include <stdatomic.h>      /* C11 atomics, for the reference counts */
+
+#include "list.h"
+
+/* Appended values live in a tree whose nodes each hold PLIST_WIDTH values (leaves) or children
+   (branches), so a million values are only four levels deep */
+#define PLIST_BITS 5
+#define PLIST_WIDTH (1 << PLIST_BITS)
+#define PLIST_MASK (PLIST_WIDTH - 1)
+
+/* DEFINITION OF PLIST_NODE_T STRUCT */
+/* A tree node. Leaves use 'vals' and 'types', branches use 'kids'. 'used' is how many slots of a
+   leaf have been filled: a version only ever reads the slots it was made with, so the newest
+   version can fill the next free slot in place instead of copying the leaf (see plist_append) */
+typedef struct PLIST_NODE{
+    atomic_int refs;
+    atomic_int used;
+    union{
+        struct PLIST_NODE *kids[PLIST_WIDTH];
+        struct{
+            value_t vals[PLIST_WIDTH];
+            int8_t types[PLIST_WIDTH];
+        };
+    };
+} plist_node_t;
+
+/* DEFINITION OF PLIST_CELL_T STRUCT */
+/* Pushed values go in a plain singly-linked list in front of the tree. Pushing makes one new
+   cell whose next is the old first cell, so every version shares the cells behind its own */
+typedef struct PLIST_CELL{
+    atomic_int refs;
+    value_type_t type;
+    value_t val;
+    struct PLIST_CELL *next;
+} plist_cell_t;
+
+/* DEFINITION OF PLIST_T STRUCT */
+/* One version of a persistent list: 'pushed' values in the cells starting at 'front', then the
+   tree under 'root' (NULL until the first leaf fills up; 'shift' is PLIST_BITS times its
+   height), then 'tail_len' values in 'tail', the leaf being filled. Only 'refs' ever changes */
+typedef struct{
+    atomic_int refs;
+    int size;
+    int pushed;
+    int shift;
+    int tail_len;
+    plist_cell_t *front;
+    plist_node_t *root;
+    plist_node_t *tail;
+} plist_t;
+
+/* DEFINITION OF PLIST_SHARE_T STRUCT */
+/* A place to publish the newest version for other threads. The lock is only held long enough to
+   swap or count a pointer, never while a version is being read */
+typedef struct{
+    plist_t *current;
+    pthread_mutex_t lock;
+} plist_share_t;
+
+/* plist_visit_fn: a callback for plist_foreach; gets a value, its type and the extra pointer, and
+   returns false to stop early */
+typedef bool (*plist_visit_fn)(value_t, value_type_t, void *);
+
+/* FUNCTION PROTOTYPES FOR PERSISTENT LISTS */
+
+/* plist_new(): no parameters, return a pointer to a new empty version or NULL if space can't be
+   allocated */
+plist_t *plist_new();
+
+/* plist_snapshot(): plist * parameter, return the same version with one more reference to it; it
+   takes one plist_release to let go of each. Takes O(1) time however long the list is */
+plist_t *plist_snapshot(plist_t *);
+
+/* plist_release(): plist * parameter, no return value; let go of one reference to the version,
+   freeing it (and whatever no other version shares) if that was the last one */
+void plist_release(plist_t *);
+
+/* plist_push(): value, value type, and plist * parameters, return a new version with the value
+   (strings are copied) at the front, or NULL if the type isn't VAL_CHAR, VAL_INT, VAL_BOOL or
+   VAL_STR or space can't be allocated. The old version is unchanged and still needs its own
+   plist_release */
+plist_t *plist_push(value_t, value_type_t, plist_t *);
+
+/* plist_append(): value, value type, and plist * parameters, return a new version with the value
+   (strings are copied) at the back, or NULL if the type isn't VAL_CHAR, VAL_INT, VAL_BOOL or
+   VAL_STR or space can't be allocated. The old version is unchanged and still needs its own
+   plist_release. Appending to the newest version is fastest; appending to an older one again
+   copies up to PLIST_WIDTH values (and their strings) */
+plist_t *plist_append(value_t, value_type_t, plist_t *);
+
+/* plist_size(): plist * parameter, return how many values the version holds */
+int plist_size(const plist_t *);
+
+/* plist_get(): int and plist * parameters, return the value at the given index (a NULL sval for a
+   bad index). Strings belong to the list: they stay valid as long as a version holding them does,
+   and must not be changed. Pushed values take O(index) to reach, appended ones O(log n) */
+value_t plist_get(int, const plist_t *);
+
+/* plist_get_type(): int and plist * parameters, return the value type at the given index (VAL_NONE
+   for a bad index) */
+value_type_t plist_get_type(int, const plist_t *);
+
+/* plist_foreach(): visit callback, extra pointer and plist * parameters, return how many values the
+   callback was called on; visit every value front to back until the callback returns false */
+int plist_foreach(plist_visit_fn, void *, const plist_t *);
+
+/* plist_to_list(): plist * parameter, return a new list_t holding a copy of every one of the
+   version's values, or NULL if space can't be allocated for all of them */
+list_t *plist_to_list(const plist_t *);
+
+/* FUNCTION PROTOTYPES FOR SHARING VERSIONS BETWEEN THREADS */
+
+/* plist_share_init(): plist_share * and plist * parameters, no return value; start sharing the
+   version (the share takes its own reference) */
+void plist_share_init(plist_share_t *, plist_t *);
+
+/* plist_share_set(): plist_share * and plist * parameters, no return value; make the version the
+   one plist_share_get hands out, letting go of the share's reference to the previous one */
+void plist_share_set(plist_share_t *, plist_t *);
+
+/* plist_share_get(): plist_share * parameter, return a snapshot of the newest version, which the
+   caller must plist_release when done with it */
+plist_t *plist_share_get(plist_share_t *);
+
+/* plist_share_destroy(): plist_share * parameter, no return value; let go of the shared version
+   and the lock. No other thread may be using the share anymore */
+void plist_share_destroy(plist_share_t *);
+
+#endif /* PLIST_H */
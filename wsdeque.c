@@ -0,0 +1,463 @@
+/*
+ *  This file (wsdeque.c) holds the work-stealing deque (wsdeque_t) and the thread pool (wpool_t)
+ *  built on it, for the linked list demo.
+ *
+ *  The deque is the Chase-Lev deque, in the C11 atomics version by Lê, Pop, Cohen and Zappa
+ *  Nardelli. The owner works at the 'bottom' end with plain loads and stores almost all the time;
+ *  only when the deque is down to its last value do the owner and the thieves race for it, and a
+ *  compare-and-swap on 'top' picks the winner. Thieves always race each other on 'top'.
+ *
+ *  The pool gives every worker thread one deque. A worker runs values from its own deque newest
+ *  first (so work a callback just submitted is probably still in the cache), and when that's
+ *  empty it steals the oldest value from a randomly chosen worker, or grabs a handful of values
+ *  from the inbox where values submitted from outside the pool wait.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>      /* sched_yield() */
+
+#include "wsdeque.h"
+
+/* each slot keeps a value_t's bits in a 64-bit atomic */
+_Static_assert(sizeof(value_t) <= sizeof(uint64_t), "value_t must fit in 64 bits");
+
+#define WS_FIRST_SIZE 64
+
+/* ws_array_new(): size parameter (a power of 2), return a new empty array or NULL if space can't
+   be allocated */
+static ws_array_t *ws_array_new(long size){
+    ws_array_t *a = malloc(sizeof(ws_array_t));
+    if(a == NULL){
+        return NULL;
+    }
+    a->vals = malloc(size * sizeof(a->vals[0]));
+    a->types = malloc(size * sizeof(a->types[0]));
+    if(a->vals == NULL || a->types == NULL){
+        free(a->vals);
+        free(a->types);
+        free(a);
+        return NULL;
+    }
+    a->size = size;
+    a->prev = NULL;
+    return a;
+}
+
+/* ws_store(): array *, position, value and value type parameters, no return value */
+static void ws_store(ws_array_t *a, long i, value_t v, value_type_t t){
+    uint64_t bits = 0;
+    memcpy(&bits, &v, sizeof(v));
+    atomic_store_explicit(&a->vals[i & (a->size - 1)], bits, memory_order_relaxed);
+    atomic_store_explicit(&a->types[i & (a->size - 1)], (int8_t) t, memory_order_relaxed);
+}
+
+/* ws_load(): array *, position, value * and value type * parameters, no return value */
+static void ws_load(ws_array_t *a, long i, value_t *v, value_type_t *t){
+    uint64_t bits = atomic_load_explicit(&a->vals[i & (a->size - 1)], memory_order_relaxed);
+    memcpy(v, &bits, sizeof(*v));
+    *t = atomic_load_explicit(&a->types[i & (a->size - 1)], memory_order_relaxed);
+}
+
+/* wsd_new(): no parameters, return a pointer to a new empty deque or NULL if space can't be
+   allocated */
+wsdeque_t *wsd_new(){
+    wsdeque_t *d = aligned_alloc(64, sizeof(wsdeque_t));
+    if(d == NULL){
+        return NULL;
+    }
+    ws_array_t *a = ws_array_new(WS_FIRST_SIZE);
+    if(a == NULL){
+        free(d);
+        return NULL;
+    }
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->array, a);
+    return d;
+}
+
+/* wsd_free(): wsdeque * parameter, no return value; free the deque and every array it has used */
+void wsd_free(wsdeque_t *d){
+    if(d == NULL){
+        return;
+    }
+    ws_array_t *a = atomic_load(&d->array);
+    while(a != NULL){
+        ws_array_t *prev = a->prev;
+        free(a->vals);
+        free(a->types);
+        free(a);
+        a = prev;
+    }
+    free(d);
+}
+
+/* wsd_push(): value, value type, and wsdeque * parameters, return true if the value was added to
+   the owner's end */
+bool wsd_push(value_t v, value_type_t t, wsdeque_t *d){
+    if(d == NULL){
+        return false;
+    }
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    if(b - top > a->size - 1){
+        /* full: copy everything into an array twice the size. The old one stays around (see
+           ws_array_t) because a thief may be reading from it right now */
+        ws_array_t *bigger = ws_array_new(2 * a->size);
+        if(bigger == NULL){
+            return false;
+        }
+        for(long i = top; i < b; i++){
+            value_t old_v;
+            value_type_t old_t;
+            ws_load(a, i, &old_v, &old_t);
+            ws_store(bigger, i, old_v, old_t);
+        }
+        bigger->prev = a;
+        atomic_store_explicit(&d->array, bigger, memory_order_release);
+        a = bigger;
+    }
+    ws_store(a, b, v, t);
+    /* the value must be in its slot before a thief can see the new 'bottom' */
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+/* wsd_pop(): wsdeque *, value * and value type * parameters, return false if the deque was empty;
+   otherwise take the newest value from the owner's end */
+bool wsd_pop(wsdeque_t *d, value_t *v, value_type_t *t){
+    if(d == NULL){
+        return false;
+    }
+    /* claim the bottom value first, then look at 'top': a thief that read 'bottom' before we
+       changed it may be going for the same value */
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if(top > b){
+        /* it was empty all along: put 'bottom' back */
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+    value_t val;
+    value_type_t type;
+    ws_load(a, b, &val, &type);
+    bool got = true;
+    if(top == b){
+        /* the last value: thieves may want it too, so race them for it on 'top' */
+        got = atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                      memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    if(got){
+        *v = val;
+        if(t != NULL){
+            *t = type;
+        }
+    }
+    return got;
+}
+
+/* wsd_remove_last(): wsdeque *, value * and value type * parameters, return false if the deque was
+   empty or another thread took the value first; otherwise steal the oldest value */
+bool wsd_remove_last(wsdeque_t *d, value_t *v, value_type_t *t){
+    if(d == NULL){
+        return false;
+    }
+    long top = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if(top >= b){
+        return false;
+    }
+    /* read the value before claiming it: once 'top' moves on, the owner may reuse the slot */
+    ws_array_t *a = atomic_load_explicit(&d->array, memory_order_acquire);
+    value_t val;
+    value_type_t type;
+    ws_load(a, top, &val, &type);
+    if(!atomic_compare_exchange_strong_explicit(&d->top, &top, top + 1,
+                                                memory_order_seq_cst, memory_order_relaxed)){
+        return false;
+    }
+    *v = val;
+    if(t != NULL){
+        *t = type;
+    }
+    return true;
+}
+
+/* wsd_size(): wsdeque * parameter, return about how many values it holds right now */
+int wsd_size(wsdeque_t *d){
+    if(d == NULL){
+        return 0;
+    }
+    long b = atomic_load(&d->bottom);
+    long top = atomic_load(&d->top);
+    return b > top ? (int) (b - top) : 0;
+}
+
+/* THREAD POOL */
+
+/* the worker this thread is, if it's one of a pool's threads */
+static _Thread_local wpool_worker_t *wpool_self = NULL;
+
+/* the most values a worker takes from the inbox at a time */
+#define WPOOL_INBOX_BATCH 64
+
+/* wpool_finish(): wpool *, value and value type parameters, no return value; the value's callback
+   has run (or never will): free its string and count it as done */
+static void wpool_finish(wpool_t *p, value_t v, value_type_t t){
+    if(t == VAL_STR){
+        free(v.sval);
+    }
+    if(atomic_fetch_sub(&p->pending, 1) == 1){
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->all_done);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+/* wpool_from_inbox(): worker *, value * and value type * parameters, return true if the inbox had
+   something. Takes a fair share of the inbox at once: one value to run now, the rest pushed on
+   this worker's deque, where other workers can still steal them */
+static bool wpool_from_inbox(wpool_worker_t *w, value_t *v, value_type_t *t){
+    wpool_t *p = w->pool;
+    value_t vals[WPOOL_INBOX_BATCH];
+    value_type_t types[WPOOL_INBOX_BATCH];
+    pthread_mutex_lock(&p->lock);
+    size_t want = list_size(p->inbox) / p->nworkers + 1;
+    if(want > WPOOL_INBOX_BATCH){
+        want = WPOOL_INBOX_BATCH;
+    }
+    /* list_pop_n hands over ownership of strings, which is just what we want */
+    size_t got = list_pop_n(vals, types, want, p->inbox);
+    pthread_mutex_unlock(&p->lock);
+    if(got == 0){
+        return false;
+    }
+    /* push the rest newest-first, so this worker gets to them in the order they came in */
+    for(size_t i = got - 1; i > 0; i--){
+        if(!wsd_push(vals[i], types[i], w->deque)){
+            wpool_finish(p, vals[i], types[i]);     /* out of memory: drop it */
+        }
+    }
+    *v = vals[0];
+    *t = types[0];
+    return true;
+}
+
+/* wpool_find(): worker *, value * and value type * parameters, return true if we found a value to
+   run: from our own deque, stolen from another worker, or from the inbox, in that order */
+static bool wpool_find(wpool_worker_t *w, value_t *v, value_type_t *t){
+    wpool_t *p = w->pool;
+    if(wsd_pop(w->deque, v, t)){
+        return true;
+    }
+    if(p->nworkers > 1){
+        w->seed = w->seed * 1103515245u + 12345u;
+        int start = (w->seed >> 16) % p->nworkers;
+        for(int i = 0; i < p->nworkers; i++){
+            wpool_worker_t *victim = &p->workers[(start + i) % p->nworkers];
+            if(victim != w && wsd_remove_last(victim->deque, v, t)){
+                atomic_fetch_add_explicit(&w->stolen, 1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return wpool_from_inbox(w, v, t);
+}
+
+/* wpool_worker(): worker * parameter, return NULL; the loop every pool thread runs */
+static void *wpool_worker(void *arg){
+    wpool_worker_t *w = arg;
+    wpool_t *p = w->pool;
+    wpool_self = w;
+    while(!atomic_load(&p->stopping)){
+        value_t v;
+        value_type_t t;
+        if(wpool_find(w, &v, &t)){
+            p->fn(v, t, p, p->arg);
+            atomic_fetch_add_explicit(&w->ran, 1, memory_order_relaxed);
+            wpool_finish(p, v, t);
+            continue;
+        }
+        if(atomic_load(&p->pending) > 0){
+            sched_yield();      /* someone's still running, and may submit more */
+            continue;
+        }
+        /* nothing left anywhere: sleep until wpool_submit (or wpool_free) wakes us up */
+        pthread_mutex_lock(&p->lock);
+        atomic_fetch_add(&p->sleeping, 1);
+        while(atomic_load(&p->pending) == 0 && !atomic_load(&p->stopping)){
+            pthread_cond_wait(&p->work_ready, &p->lock);
+        }
+        atomic_fetch_sub(&p->sleeping, 1);
+        pthread_mutex_unlock(&p->lock);
+    }
+    wpool_self = NULL;
+    return NULL;
+}
+
+/* wpool_stop(): wpool * and thread count parameters, no return value; tell the workers to stop,
+   wake up any that are asleep, and wait for the first 'started' of them to finish */
+static void wpool_stop(wpool_t *p, int started){
+    pthread_mutex_lock(&p->lock);
+    atomic_store(&p->stopping, true);
+    pthread_cond_broadcast(&p->work_ready);
+    pthread_mutex_unlock(&p->lock);
+    for(int i = 0; i < started; i++){
+        pthread_join(p->workers[i].thread, NULL);
+    }
+}
+
+/* wpool_new(): thread count, callback and callback argument parameters, return a pointer to a new
+   pool with its threads already started, or NULL if something can't be allocated */
+wpool_t *wpool_new(int nworkers, wpool_fn fn, void *arg){
+    if(nworkers < 1 || fn == NULL){
+        return NULL;
+    }
+    wpool_t *p = malloc(sizeof(wpool_t));
+    if(p == NULL){
+        return NULL;
+    }
+    p->fn = fn;
+    p->arg = arg;
+    p->nworkers = nworkers;
+    p->workers = calloc(nworkers, sizeof(wpool_worker_t));
+    p->inbox = list_new();
+    if(p->workers == NULL || p->inbox == NULL){
+        free(p->workers);
+        list_free(p->inbox);
+        free(p);
+        return NULL;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_ready, NULL);
+    pthread_cond_init(&p->all_done, NULL);
+    atomic_init(&p->pending, 0);
+    atomic_init(&p->sleeping, 0);
+    atomic_init(&p->stopping, false);
+
+    /* every deque has to exist before any thread starts stealing from it */
+    for(int i = 0; i < nworkers; i++){
+        wpool_worker_t *w = &p->workers[i];
+        w->pool = p;
+        w->deque = wsd_new();
+        w->seed = 2166136261u + i;
+        atomic_init(&w->ran, 0);
+        atomic_init(&w->stolen, 0);
+        if(w->deque == NULL){
+            for(int j = 0; j <= i; j++){
+                wsd_free(p->workers[j].deque);
+            }
+            list_free(p->inbox);
+            free(p->workers);
+            free(p);
+            return NULL;
+        }
+    }
+    for(int i = 0; i < nworkers; i++){
+        if(pthread_create(&p->workers[i].thread, NULL, wpool_worker, &p->workers[i]) != 0){
+            /* a pool short of threads could wait forever, so stop the ones that did start (none
+               of them has any work yet) and give up */
+            wpool_stop(p, i);
+            for(int j = 0; j < nworkers; j++){
+                wsd_free(p->workers[j].deque);
+            }
+            list_free(p->inbox);
+            pthread_mutex_destroy(&p->lock);
+            pthread_cond_destroy(&p->work_ready);
+            pthread_cond_destroy(&p->all_done);
+            free(p->workers);
+            free(p);
+            return NULL;
+        }
+    }
+    return p;
+}
+
+/* wpool_submit(): value, value type, and wpool * parameters, return true if the value was queued
+   up for the callback */
+bool wpool_submit(value_t v, value_type_t t, wpool_t *p){
+    if(p == NULL){
+        return false;
+    }
+    wpool_worker_t *w = wpool_self;
+    if(w == NULL || w->pool != p){
+        /* from outside the pool: into the inbox (the list copies strings for us, and unlike
+           list_append, list_append_array tells us whether that worked) */
+        pthread_mutex_lock(&p->lock);
+        bool added = list_append_array(&v, &t, 1, p->inbox) == 1;
+        if(added){
+            atomic_fetch_add(&p->pending, 1);
+            pthread_cond_broadcast(&p->work_ready);
+        }
+        pthread_mutex_unlock(&p->lock);
+        return added;
+    }
+
+    /* from a callback: onto this worker's own deque, no locks needed */
+    if(t == VAL_STR){
+        v.sval = strdup(v.sval);
+        if(v.sval == NULL){
+            return false;
+        }
+    }
+    atomic_fetch_add(&p->pending, 1);
+    if(!wsd_push(v, t, w->deque)){
+        wpool_finish(p, v, t);
+        return false;
+    }
+    /* a worker may have gone to sleep before this value existed */
+    if(atomic_load(&p->sleeping) > 0){
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->work_ready);
+        pthread_mutex_unlock(&p->lock);
+    }
+    return true;
+}
+
+/* wpool_wait(): wpool * parameter, no return value; wait until every submitted value has been run */
+void wpool_wait(wpool_t *p){
+    if(p == NULL){
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    while(atomic_load(&p->pending) > 0){
+        pthread_cond_wait(&p->all_done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/* wpool_free(): wpool * parameter, no return value; stop the threads and free the pool */
+void wpool_free(wpool_t *p){
+    if(p == NULL){
+        return;
+    }
+    wpool_stop(p, p->nworkers);
+
+    /* the threads are gone, so this thread may act as every deque's owner */
+    for(int i = 0; i < p->nworkers; i++){
+        value_t v;
+        value_type_t t;
+        while(wsd_pop(p->workers[i].deque, &v, &t)){
+            if(t == VAL_STR){
+                free(v.sval);
+            }
+        }
+        wsd_free(p->workers[i].deque);
+    }
+    list_free(p->inbox);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->work_ready);
+    pthread_cond_destroy(&p->all_done);
+    free(p->workers);
+    free(p);
+}
@@ -0,0 +1,127 @@
+/*
+ *  This file (wsdeque.h) is the header file for the work-stealing deque and thread pool in the
+ *  linked list demo.
+ *
+ *  A wsdeque_t belongs to one thread (its "owner"), which uses it like a stack with wsd_push and
+ *  wsd_pop. Any other thread may take values from the opposite end with wsd_remove_last; that's
+ *  called stealing. A wpool_t is a thread pool built out of them: each worker thread keeps its own
+ *  deque of values to run a callback on, and a worker that runs out steals from the others.
+ *
+ *  Contents:
+ *      - ws_array_t and wsdeque_t structs
+ *      - function prototypes for work-stealing deques
+ *      - wpool_worker_t and wpool_t structs
+ *      - function prototypes for thread pools
+ *
+ */
+
+#ifndef WSDEQUE_H
+#define WSDEQUE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "list.h"
+
+/* DEFINITION OF WS_ARRAY_T STRUCT */
+/* The deque is a circular array (its size is always a power of 2) rather than a chain of nodes,
+   so the owner never has to allocate to push unless the array is full. A thief may read a slot at
+   the same moment the owner writes it (it finds out afterwards that the read didn't count), so
+   the slots are atomics: a value_t's bits and a type. 'prev' keeps the arrays we've outgrown,
+   which a slow thief may still be reading, until the deque is freed */
+typedef struct WS_ARRAY{
+    long size;
+    struct WS_ARRAY *prev;
+    _Atomic(uint64_t) *vals;
+    _Atomic(int8_t) *types;
+} ws_array_t;
+
+/* DEFINITION OF WSDEQUE_T STRUCT */
+/* The values are at positions top .. bottom-1. The owner moves 'bottom', thieves move 'top'. The
+   two counters only ever grow, and position i lives in slot i % size */
+typedef struct{
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    _Atomic(ws_array_t *) array;
+} wsdeque_t;
+
+/* FUNCTION PROTOTYPES FOR WORK-STEALING DEQUES */
+
+/* wsd_new(): no parameters, return a pointer to a new empty deque or NULL if space can't be
+   allocated */
+wsdeque_t *wsd_new();
+
+/* wsd_free(): wsdeque * parameter, no return value; free the deque. No other thread may be using
+   it anymore. Strings aren't copied into a deque, so it never frees them either */
+void wsd_free(wsdeque_t *);
+
+/* wsd_push(): value, value type, and wsdeque * parameters, return true if the value was added to
+   the owner's end. Only the owner may call this */
+bool wsd_push(value_t, value_type_t, wsdeque_t *);
+
+/* wsd_pop(): wsdeque *, value * and value type * parameters, return false if the deque was empty;
+   otherwise take the newest value from the owner's end. Only the owner may call this */
+bool wsd_pop(wsdeque_t *, value_t *, value_type_t *);
+
+/* wsd_remove_last(): wsdeque *, value * and value type * parameters, return false if the deque was
+   empty (or another thread took that value first); otherwise steal the oldest value, from the far
+   end. Any thread may call this */
+bool wsd_remove_last(wsdeque_t *, value_t *, value_type_t *);
+
+/* wsd_size(): wsdeque * parameter, return about how many values it holds right now */
+int wsd_size(wsdeque_t *);
+
+/* DEFINITION OF WPOOL_WORKER_T AND WPOOL_T STRUCTS */
+
+struct WPOOL;
+
+/* The callback the pool runs on every value. It may submit more values to the same pool */
+typedef void (*wpool_fn)(value_t, value_type_t, struct WPOOL *, void *);
+
+/* One worker thread and its deque. 'ran' and 'stolen' count what it did, for load balance */
+typedef struct{
+    struct WPOOL *pool;
+    pthread_t thread;
+    wsdeque_t *deque;
+    unsigned int seed;      /* for picking a random worker to steal from */
+    atomic_long ran;
+    atomic_long stolen;
+} wpool_worker_t;
+
+/* Values submitted from outside the pool wait in 'inbox' (a plain list_t, behind 'lock') until a
+   worker picks them up. 'pending' counts values submitted but not finished yet */
+typedef struct WPOOL{
+    wpool_fn fn;
+    void *arg;
+    int nworkers;
+    wpool_worker_t *workers;
+    list_t *inbox;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;  /* signalled when there's something to do (or time to stop) */
+    pthread_cond_t all_done;    /* signalled when 'pending' drops to 0 */
+    atomic_long pending;
+    atomic_int sleeping;
+    atomic_bool stopping;
+} wpool_t;
+
+/* FUNCTION PROTOTYPES FOR THREAD POOLS */
+
+/* wpool_new(): thread count, callback and callback argument parameters, return a pointer to a new
+   pool with its threads already started, or NULL if something can't be allocated */
+wpool_t *wpool_new(int, wpool_fn, void *);
+
+/* wpool_submit(): value, value type, and wpool * parameters, return true if the value was queued
+   up for the callback. From inside a callback it goes on that worker's own deque; from anywhere
+   else it goes in the inbox. The pool keeps its own copy of a string until the callback for it
+   has returned */
+bool wpool_submit(value_t, value_type_t, wpool_t *);
+
+/* wpool_wait(): wpool * parameter, no return value; wait until every submitted value (including
+   those submitted by callbacks) has been run */
+void wpool_wait(wpool_t *);
+
+/* wpool_free(): wpool * parameter, no return value; stop the threads and free the pool. Values
+   that haven't run yet are dropped */
+void wpool_free(wpool_t *);
+
+#endif /* WSDEQUE_H */